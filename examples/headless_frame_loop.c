@@ -0,0 +1,202 @@
+// Runs the full frame loop (wgpuSurfaceGetCurrentTexture, a clearing render pass, wgpuSurfacePresent) on headless
+// surfaces, once on the virtual offscreen ring and once through VK_EXT_headless_surface where the instance exposes it.
+// Each run reconfigures twice while frames are in flight, which hands the previous swapchain over as oldSwapchain
+// (or retires the previous ring) instead of idling the device.
+// Exits with 77 (skipped) without a Vulkan adapter.
+#include <wgvk.h>
+#include <wgvk_structs_impl.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef STRVIEW
+    #define STRVIEW(X) (WGPUStringView){X, sizeof(X) - 1}
+#endif
+
+#define FRAME_COUNT 12
+#define SKIP_RETURN_CODE 77
+
+void adapterCallbackFunction(
+        enum WGPURequestAdapterStatus status,
+        WGPUAdapter adapter,
+        struct WGPUStringView label,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUAdapter*)userdata1) = adapter;
+}
+void deviceCallbackFunction(
+        WGPURequestDeviceStatus status,
+        WGPUDevice device,
+        WGPUStringView message,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUDevice*)userdata1) = device;
+}
+void errorCallbackFunction(const WGPUDevice* device, WGPUErrorType type, WGPUStringView message, void* userdata1, void* userdata2){
+    fprintf(stderr, "Device error: %.*s\n", (int)message.length, message.data);
+    ++*((int*)userdata1);
+}
+
+static void configure(WGPUSurface surface, WGPUDevice device, WGPUTextureFormat format, uint32_t width, uint32_t height, uint32_t maxQueuedFrames){
+    WGPUSurfaceFrameLatency frameLatency = {
+        .chain = {
+            .sType = WGPUSType_SurfaceFrameLatency
+        },
+        .maxQueuedFrames = maxQueuedFrames,
+    };
+    wgpuSurfaceConfigure(surface, &(const WGPUSurfaceConfiguration){
+        .nextInChain = &frameLatency.chain,
+        .device = device,
+        .format = format,
+        .usage = WGPUTextureUsage_RenderAttachment,
+        .width = width,
+        .height = height,
+        .alphaMode = WGPUCompositeAlphaMode_Opaque,
+        .presentMode = WGPUPresentMode_Fifo,
+    });
+}
+
+static int runFrameLoop(WGPUInstance instance, WGPUAdapter adapter, WGPUDevice device, WGPUBool useHeadlessSurfaceExtension){
+    WGPUSurfaceSourceHeadless headlessSource = {
+        .chain = {
+            .sType = WGPUSType_SurfaceSourceHeadless
+        },
+        .useHeadlessSurfaceExtension = useHeadlessSurfaceExtension,
+    };
+    WGPUSurface surface = wgpuInstanceCreateSurface(instance, &(const WGPUSurfaceDescriptor){
+        .nextInChain = &headlessSource.chain,
+        .label = STRVIEW("Headless Surface"),
+    });
+    if(useHeadlessSurfaceExtension && surface->surfaceType != SurfaceImplType_HeadlessSurface){
+        printf("VK_EXT_headless_surface is unavailable, the virtual surface was already tested\n");
+        wgpuSurfaceRelease(surface);
+        return 1;
+    }
+    WGPUSurfaceCapabilities capabilities = {0};
+    wgpuSurfaceGetCapabilities(surface, adapter, &capabilities);
+    if(capabilities.formatCount == 0){
+        fprintf(stderr, "Surface reports no formats\n");
+        wgpuSurfaceRelease(surface);
+        return 0;
+    }
+    const WGPUTextureFormat format = capabilities.formats[0];
+    WGPUQueue queue = wgpuDeviceGetQueue(device);
+
+    int success = 1;
+    uint32_t width = 64, height = 48;
+    configure(surface, device, format, width, height, 0);
+    for(uint32_t frame = 0;frame < FRAME_COUNT && success;frame++){
+        // Reconfigure with frames still in flight, the second time also shrinking the frame latency
+        if(frame == FRAME_COUNT / 3){
+            width = 96, height = 80;
+            configure(surface, device, format, width, height, 0);
+        }
+        else if(frame == 2 * FRAME_COUNT / 3){
+            width = 32, height = 32;
+            configure(surface, device, format, width, height, 1);
+        }
+        WGPUSurfaceTexture surfaceTexture = {0};
+        wgpuSurfaceGetCurrentTexture(surface, &surfaceTexture);
+        if(surfaceTexture.status != WGPUSurfaceGetCurrentTextureStatus_SuccessOptimal && surfaceTexture.status != WGPUSurfaceGetCurrentTextureStatus_SuccessSuboptimal){
+            fprintf(stderr, "Frame %u: wgpuSurfaceGetCurrentTexture failed with status %d\n", frame, (int)surfaceTexture.status);
+            success = 0;
+            break;
+        }
+        if(wgpuTextureGetWidth(surfaceTexture.texture) != width || wgpuTextureGetHeight(surfaceTexture.texture) != height){
+            fprintf(stderr, "Frame %u: surface texture is %ux%u instead of %ux%u\n", frame, wgpuTextureGetWidth(surfaceTexture.texture), wgpuTextureGetHeight(surfaceTexture.texture), width, height);
+            success = 0;
+        }
+        WGPUTextureView view = wgpuTextureCreateView(surfaceTexture.texture, NULL);
+        WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, NULL);
+        WGPURenderPassColorAttachment colorAttachment = {
+            .view = view,
+            .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
+            .loadOp = WGPULoadOp_Clear,
+            .storeOp = WGPUStoreOp_Store,
+            .clearValue = {frame / (double)FRAME_COUNT, 0.25, 0.5, 1.0},
+        };
+        WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &(const WGPURenderPassDescriptor){
+            .colorAttachmentCount = 1,
+            .colorAttachments = &colorAttachment,
+        });
+        wgpuRenderPassEncoderEnd(pass);
+        wgpuRenderPassEncoderRelease(pass);
+        WGPUCommandBuffer commandBuffer = wgpuCommandEncoderFinish(encoder, NULL);
+        wgpuCommandEncoderRelease(encoder);
+        wgpuQueueSubmit(queue, 1, &commandBuffer);
+        wgpuCommandBufferRelease(commandBuffer);
+        wgpuTextureViewRelease(view);
+        wgpuSurfacePresent(surface);
+    }
+    // Lets the frames holding retired swapchains come around so they are destroyed before the surface
+    for(uint32_t i = 0;i < framesInFlight;i++){
+        wgpuDeviceTick(device);
+    }
+    wgpuSurfaceUnconfigure(surface);
+    wgpuSurfaceRelease(surface);
+    wgpuQueueRelease(queue);
+    printf("%s surface: %s\n", useHeadlessSurfaceExtension ? "VK_EXT_headless_surface" : "Virtual", success ? "passed" : "failed");
+    return success;
+}
+
+int main(){
+    WGPUInstanceFeatureName instanceFeatures[1] = {
+        WGPUInstanceFeatureName_TimedWaitAny,
+    };
+    WGPUInstance instance = wgpuCreateInstance(&(const WGPUInstanceDescriptor){
+        .requiredFeatures = instanceFeatures,
+        .requiredFeatureCount = 1,
+    });
+    if(instance == NULL){
+        printf("No Vulkan instance, skipping\n");
+        return SKIP_RETURN_CODE;
+    }
+
+    WGPUAdapter adapter = NULL;
+    WGPURequestAdapterOptions adapterOptions = {0};
+    adapterOptions.featureLevel = WGPUFeatureLevel_Core;
+    WGPURequestAdapterCallbackInfo adapterCallback = {0};
+    adapterCallback.callback = adapterCallbackFunction;
+    adapterCallback.userdata1 = (void*)&adapter;
+    WGPUFutureWaitInfo adapterWaitInfo = {
+        .future = wgpuInstanceRequestAdapter(instance, &adapterOptions, adapterCallback),
+    };
+    wgpuInstanceWaitAny(instance, 1, &adapterWaitInfo, ~0ull);
+    if(adapter == NULL){
+        printf("No adapter, skipping\n");
+        wgpuInstanceRelease(instance);
+        return SKIP_RETURN_CODE;
+    }
+
+    int errorCount = 0;
+    WGPUDeviceDescriptor deviceDescriptor = {
+        .label = STRVIEW("Headless Frame Loop Device"),
+        .uncapturedErrorCallbackInfo = {
+            .callback = errorCallbackFunction,
+            .userdata1 = &errorCount,
+        },
+    };
+    WGPUDevice device = NULL;
+    WGPURequestDeviceCallbackInfo requestDeviceCallbackInfo = {
+        .callback = deviceCallbackFunction,
+        .mode = WGPUCallbackMode_WaitAnyOnly,
+        .userdata1 = &device
+    };
+    WGPUFutureWaitInfo deviceWaitInfo = {
+        .future = wgpuAdapterRequestDevice(adapter, &deviceDescriptor, requestDeviceCallbackInfo),
+    };
+    wgpuInstanceWaitAny(instance, 1, &deviceWaitInfo, ~0ull);
+
+    int success = runFrameLoop(instance, adapter, device, 0);
+    success &= runFrameLoop(instance, adapter, device, 1);
+    if(errorCount){
+        success = 0;
+    }
+
+    wgpuDeviceRelease(device);
+    wgpuAdapterRelease(adapter);
+    wgpuInstanceRelease(instance);
+    printf(success ? "Headless frame loop test passed\n" : "Headless frame loop test failed\n");
+    return success ? 0 : 1;
+}
@@ -0,0 +1,362 @@
+// Measures the CPU cost of encoding and submitting small render passes: an empty pass, a pass with
+// one draw and a pass with 1000 draws that switch bind groups between every draw.
+// Meant to be run on lavapipe or any other device, without validation layers.
+#include <wgvk.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef STRVIEW
+    #define STRVIEW(X) (WGPUStringView){X, sizeof(X) - 1}
+#endif
+
+/* ---------- POSIX / Unix-like ---------- */
+#if defined(__unix__) || defined(__APPLE__)
+  #include <time.h>
+
+  static inline uint64_t nanoTime(void)
+  {
+      struct timespec ts;
+  #if defined(CLOCK_MONOTONIC_RAW)        /* Linux, FreeBSD */
+      clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  #else                                   /* macOS 10.12+, other POSIX */
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+  #endif
+      return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  }
+
+/* ---------- Windows ---------- */
+#elif defined(_WIN32)
+  #include <windows.h>
+
+  static inline uint64_t nanoTime(void)
+  {
+      static LARGE_INTEGER freq = { 0 };
+      if (freq.QuadPart == 0)               /* one-time init */
+          QueryPerformanceFrequency(&freq);
+
+      LARGE_INTEGER counter;
+      QueryPerformanceCounter(&counter);
+      /* scale ticks → ns: (ticks * 1e9) / freq */
+      return (uint64_t)((counter.QuadPart * 1000000000ULL) / freq.QuadPart);
+  }
+
+#else
+  #error "Platform not supported"
+#endif
+
+// resources/simple_shader.spv: vs_main takes a vec2 position at location 0, fs_main writes a constant color
+const uint32_t simple_shader_spv[] = {
+    0x07230203, 0x00010300, 0x00170001, 0x00000032, 0x00000000, 0x00020011, 0x00000001, 0x0003000e,
+    0x00000000, 0x00000001, 0x0008000f, 0x00000000, 0x00000025, 0x6d5f7376, 0x006e6961, 0x00000001,
+    0x00000005, 0x00000008, 0x0007000f, 0x00000004, 0x0000002d, 0x6d5f7366, 0x006e6961, 0x0000000a,
+    0x0000000c, 0x00030010, 0x0000002d, 0x00000007, 0x00070005, 0x00000001, 0x6d5f7376, 0x5f6e6961,
+    0x30636f6c, 0x706e495f, 0x00007475, 0x00080005, 0x00000005, 0x6d5f7376, 0x5f6e6961, 0x69736f70,
+    0x6e6f6974, 0x74754f5f, 0x00747570, 0x00090005, 0x00000008, 0x6d5f7376, 0x5f6e6961, 0x6f705f5f,
+    0x5f746e69, 0x657a6973, 0x74754f5f, 0x00747570, 0x00080005, 0x0000000a, 0x6d5f7366, 0x5f6e6961,
+    0x69736f70, 0x6e6f6974, 0x706e495f, 0x00007475, 0x00070005, 0x0000000c, 0x6d5f7366, 0x5f6e6961,
+    0x30636f6c, 0x74754f5f, 0x00747570, 0x00060005, 0x0000000d, 0x6d5f7376, 0x5f6e6961, 0x656e6e69,
+    0x00000072, 0x00060006, 0x0000000e, 0x00000000, 0x69736f70, 0x6e6f6974, 0x00000000, 0x00060005,
+    0x0000000e, 0x74726556, 0x754f7865, 0x74757074, 0x00000000, 0x00060006, 0x0000000f, 0x00000000,
+    0x69736f70, 0x6e6f6974, 0x00000000, 0x00050005, 0x0000000f, 0x74726556, 0x6e497865, 0x00747570,
+    0x00030005, 0x00000010, 0x00006e69, 0x00030005, 0x00000013, 0x0074756f, 0x00060005, 0x00000020,
+    0x6d5f7366, 0x5f6e6961, 0x656e6e69, 0x00000072, 0x00030005, 0x00000021, 0x00006e69, 0x00040005,
+    0x00000025, 0x6d5f7376, 0x006e6961, 0x00040005, 0x0000002d, 0x6d5f7366, 0x006e6961, 0x00040047,
+    0x00000001, 0x0000001e, 0x00000000, 0x00040047, 0x00000005, 0x0000000b, 0x00000000, 0x00040047,
+    0x00000008, 0x0000000b, 0x00000001, 0x00040047, 0x0000000a, 0x0000000b, 0x0000000f, 0x00040047,
+    0x0000000c, 0x0000001e, 0x00000000, 0x00030016, 0x00000004, 0x00000020, 0x00040017, 0x00000003,
+    0x00000004, 0x00000002, 0x00040020, 0x00000002, 0x00000001, 0x00000003, 0x0004003b, 0x00000002,
+    0x00000001, 0x00000001, 0x00040017, 0x00000007, 0x00000004, 0x00000004, 0x00040020, 0x00000006,
+    0x00000003, 0x00000007, 0x0004003b, 0x00000006, 0x00000005, 0x00000003, 0x00040020, 0x00000009,
+    0x00000003, 0x00000004, 0x0004003b, 0x00000009, 0x00000008, 0x00000003, 0x00040020, 0x0000000b,
+    0x00000001, 0x00000007, 0x0004003b, 0x0000000b, 0x0000000a, 0x00000001, 0x0004003b, 0x00000006,
+    0x0000000c, 0x00000003, 0x0003001e, 0x0000000e, 0x00000007, 0x0003001e, 0x0000000f, 0x00000003,
+    0x00040021, 0x00000011, 0x0000000e, 0x0000000f, 0x00040020, 0x00000014, 0x00000007, 0x0000000e,
+    0x0003002e, 0x0000000e, 0x00000015, 0x00040020, 0x00000017, 0x00000007, 0x00000007, 0x00040015,
+    0x00000019, 0x00000020, 0x00000000, 0x0004002b, 0x00000019, 0x00000018, 0x00000000, 0x0004002b,
+    0x00000004, 0x0000001d, 0x00000000, 0x0004002b, 0x00000004, 0x0000001e, 0x3f800000, 0x00040021,
+    0x00000022, 0x00000007, 0x0000000e, 0x0007002c, 0x00000007, 0x00000024, 0x0000001e, 0x0000001d,
+    0x0000001d, 0x0000001e, 0x00020013, 0x00000026, 0x00030021, 0x00000027, 0x00000026, 0x00050036,
+    0x0000000e, 0x0000000d, 0x00000000, 0x00000011, 0x00030037, 0x0000000f, 0x00000010, 0x000200f8,
+    0x00000012, 0x0005003b, 0x00000014, 0x00000013, 0x00000007, 0x00000015, 0x00050041, 0x00000017,
+    0x00000016, 0x00000013, 0x00000018, 0x00060051, 0x00000004, 0x0000001a, 0x00000010, 0x00000000,
+    0x00000000, 0x00060051, 0x00000004, 0x0000001b, 0x00000010, 0x00000000, 0x00000001, 0x00070050,
+    0x00000007, 0x0000001c, 0x0000001a, 0x0000001b, 0x0000001d, 0x0000001e, 0x0004003e, 0x00000016,
+    0x0000001c, 0x00000000, 0x0005003d, 0x0000000e, 0x0000001f, 0x00000013, 0x00000000, 0x000200fe,
+    0x0000001f, 0x00010038, 0x00050036, 0x00000007, 0x00000020, 0x00000000, 0x00000022, 0x00030037,
+    0x0000000e, 0x00000021, 0x000200f8, 0x00000023, 0x000200fe, 0x00000024, 0x00010038, 0x00050036,
+    0x00000026, 0x00000025, 0x00000000, 0x00000027, 0x000200f8, 0x00000028, 0x0005003d, 0x00000003,
+    0x00000029, 0x00000001, 0x00000000, 0x00040050, 0x0000000f, 0x0000002a, 0x00000029, 0x00050039,
+    0x0000000e, 0x0000002b, 0x0000000d, 0x0000002a, 0x00050051, 0x00000007, 0x0000002c, 0x0000002b,
+    0x00000000, 0x0004003e, 0x00000005, 0x0000002c, 0x00000000, 0x0004003e, 0x00000008, 0x0000001e,
+    0x00000000, 0x000100fd, 0x00010038, 0x00050036, 0x00000026, 0x0000002d, 0x00000000, 0x00000027,
+    0x000200f8, 0x0000002e, 0x0005003d, 0x00000007, 0x0000002f, 0x0000000a, 0x00000000, 0x00040050,
+    0x0000000e, 0x00000030, 0x0000002f, 0x00050039, 0x00000007, 0x00000031, 0x00000020, 0x00000030,
+    0x0004003e, 0x0000000c, 0x00000031, 0x00000000, 0x000100fd, 0x00010038
+};
+
+#define WARMUP_ITERATIONS 16
+#define TIMED_ITERATIONS 256
+
+void adapterCallbackFunction(
+        enum WGPURequestAdapterStatus status,
+        WGPUAdapter adapter,
+        struct WGPUStringView label,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUAdapter*)userdata1) = adapter;
+}
+void deviceCallbackFunction(
+        WGPURequestDeviceStatus status,
+        WGPUDevice device,
+        WGPUStringView message,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUDevice*)userdata1) = device;
+}
+
+typedef struct BenchmarkScene{
+    WGPUDevice device;
+    WGPUQueue queue;
+    WGPUTextureView target;
+    WGPURenderPipeline pipeline;
+    WGPUBuffer vertexBuffer;
+    WGPUBindGroup groups[2];
+}BenchmarkScene;
+
+// Encodes, finishes and submits one pass with drawCount draws, returns the nanoseconds spent doing so
+static uint64_t encodePass(const BenchmarkScene* scene, uint32_t drawCount){
+    const uint64_t start = nanoTime();
+    WGPUCommandEncoder cenc = wgpuDeviceCreateCommandEncoder(scene->device, NULL);
+    WGPURenderPassColorAttachment colorAttachment = {
+        .clearValue = (WGPUColor){0, 0, 0, 1},
+        .loadOp = WGPULoadOp_Clear,
+        .storeOp = WGPUStoreOp_Store,
+        .view = scene->target
+    };
+    WGPURenderPassEncoder rpenc = wgpuCommandEncoderBeginRenderPass(cenc, &(const WGPURenderPassDescriptor){
+        .colorAttachmentCount = 1,
+        .colorAttachments = &colorAttachment,
+    });
+    if(drawCount){
+        wgpuRenderPassEncoderSetPipeline(rpenc, scene->pipeline);
+        wgpuRenderPassEncoderSetVertexBuffer(rpenc, 0, scene->vertexBuffer, 0, WGPU_WHOLE_SIZE);
+    }
+    for(uint32_t i = 0;i < drawCount;i++){
+        wgpuRenderPassEncoderSetBindGroup(rpenc, 0, scene->groups[i & 1], 0, NULL);
+        wgpuRenderPassEncoderDraw(rpenc, 3, 1, 0, 0);
+    }
+    wgpuRenderPassEncoderEnd(rpenc);
+    WGPUCommandBuffer cmdBuffer = wgpuCommandEncoderFinish(cenc, NULL);
+    wgpuQueueSubmit(scene->queue, 1, &cmdBuffer);
+    wgpuCommandBufferRelease(cmdBuffer);
+    wgpuRenderPassEncoderRelease(rpenc);
+    wgpuCommandEncoderRelease(cenc);
+    const uint64_t end = nanoTime();
+    // Retiring frames waits for the GPU, which is not what is measured here
+    wgpuDeviceTick(scene->device);
+    return end - start;
+}
+
+int main(){
+    WGPUInstanceFeatureName instanceFeatures[2] = {
+        WGPUInstanceFeatureName_TimedWaitAny,
+        WGPUInstanceFeatureName_ShaderSourceSPIRV,
+    };
+    WGPUInstanceDescriptor instanceDescriptor = {
+        .nextInChain = NULL,
+        .requiredFeatures = instanceFeatures,
+        .requiredFeatureCount = 2,
+    };
+    WGPUInstance instance = wgpuCreateInstance(&instanceDescriptor);
+
+    WGPURequestAdapterOptions adapterOptions = {0};
+    adapterOptions.featureLevel = WGPUFeatureLevel_Core;
+    WGPUAdapter requestedAdapter = NULL;
+    WGPURequestAdapterCallbackInfo adapterCallback = {0};
+    adapterCallback.callback = adapterCallbackFunction;
+    adapterCallback.userdata1 = (void*)&requestedAdapter;
+    WGPUFutureWaitInfo adapterWaitInfo = {
+        .future = wgpuInstanceRequestAdapter(instance, &adapterOptions, adapterCallback),
+        .completed = 0
+    };
+    wgpuInstanceWaitAny(instance, 1, &adapterWaitInfo, ~0ull);
+
+    WGPUDeviceDescriptor deviceDescriptor = {
+        .label = STRVIEW("Benchmark Device"),
+    };
+    WGPUDevice device = NULL;
+    WGPURequestDeviceCallbackInfo requestDeviceCallbackInfo = {
+        .callback = deviceCallbackFunction,
+        .mode = WGPUCallbackMode_WaitAnyOnly,
+        .userdata1 = &device
+    };
+    WGPUFutureWaitInfo deviceWaitInfo = {
+        .future = wgpuAdapterRequestDevice(requestedAdapter, &deviceDescriptor, requestDeviceCallbackInfo),
+        .completed = 0
+    };
+    wgpuInstanceWaitAny(instance, 1, &deviceWaitInfo, ~0ull);
+    WGPUQueue queue = wgpuDeviceGetQueue(device);
+
+    const WGPUTextureFormat targetFormat = WGPUTextureFormat_BGRA8Unorm;
+    WGPUTexture targetTexture = wgpuDeviceCreateTexture(device, &(const WGPUTextureDescriptor){
+        .usage = WGPUTextureUsage_RenderAttachment,
+        .dimension = WGPUTextureDimension_2D,
+        .size = {256, 256, 1},
+        .format = targetFormat,
+        .mipLevelCount = 1,
+        .sampleCount = 1,
+        .viewFormatCount = 1,
+        .viewFormats = &targetFormat,
+    });
+    WGPUTextureView targetView = wgpuTextureCreateView(targetTexture, NULL);
+
+    WGPUShaderSourceSPIRV shaderSourceSpirv = {
+        .chain = {
+            .sType = WGPUSType_ShaderSourceSPIRV
+        },
+        .code = simple_shader_spv,
+        .codeSize = sizeof(simple_shader_spv) / sizeof(uint32_t),
+    };
+    WGPUShaderModule shaderModule = wgpuDeviceCreateShaderModule(device, &(const WGPUShaderModuleDescriptor){
+        .nextInChain = &shaderSourceSpirv.chain
+    });
+
+    // The shader doesn't read the group, it only exists to measure SetBindGroup
+    WGPUBindGroupLayoutEntry bglEntry = {
+        .binding = 0,
+        .visibility = WGPUShaderStage_Vertex,
+        .buffer = {
+            .type = WGPUBufferBindingType_Uniform,
+            .minBindingSize = 16
+        }
+    };
+    WGPUBindGroupLayout bgl = wgpuDeviceCreateBindGroupLayout(device, &(const WGPUBindGroupLayoutDescriptor){
+        .entries = &bglEntry,
+        .entryCount = 1
+    });
+    WGPUPipelineLayout pllayout = wgpuDeviceCreatePipelineLayout(device, &(const WGPUPipelineLayoutDescriptor){
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts = &bgl,
+    });
+
+    WGPUVertexAttribute vbAttribute = {
+        .shaderLocation = 0,
+        .format = WGPUVertexFormat_Float32x2,
+        .offset = 0
+    };
+    WGPUVertexBufferLayout vbLayout = {
+        .arrayStride = sizeof(float) * 2,
+        .attributeCount = 1,
+        .attributes = &vbAttribute,
+        .stepMode = WGPUVertexStepMode_Vertex
+    };
+    WGPUColorTargetState colorTargetState = {
+        .writeMask = WGPUColorWriteMask_All,
+        .format = targetFormat,
+    };
+    WGPUFragmentState fragmentState = {
+        .entryPoint = STRVIEW("fs_main"),
+        .module = shaderModule,
+        .targetCount = 1,
+        .targets = &colorTargetState
+    };
+    WGPURenderPipeline pipeline = wgpuDeviceCreateRenderPipeline(device, &(const WGPURenderPipelineDescriptor){
+        .vertex = {
+            .bufferCount = 1,
+            .buffers = &vbLayout,
+            .module = shaderModule,
+            .entryPoint = STRVIEW("vs_main")
+        },
+        .fragment = &fragmentState,
+        .primitive = {
+            .cullMode = WGPUCullMode_None,
+            .frontFace = WGPUFrontFace_CCW,
+            .topology = WGPUPrimitiveTopology_TriangleList
+        },
+        .layout = pllayout,
+        .multisample = {
+            .count = 1,
+            .mask = 0xffffffff
+        },
+    });
+
+    const float vertices[6] = {-0.2f, -0.2f, -0.2f, 0.2f, 0.2f, 0.2f};
+    WGPUBuffer vertexBuffer = wgpuDeviceCreateBuffer(device, &(const WGPUBufferDescriptor){
+        .size = sizeof(vertices),
+        .usage = WGPUBufferUsage_Vertex | WGPUBufferUsage_CopyDst
+    });
+    wgpuQueueWriteBuffer(queue, vertexBuffer, 0, vertices, sizeof(vertices));
+
+    WGPUBuffer uniformBuffers[2];
+    WGPUBindGroup groups[2];
+    for(int i = 0;i < 2;i++){
+        uniformBuffers[i] = wgpuDeviceCreateBuffer(device, &(const WGPUBufferDescriptor){
+            .size = 256,
+            .usage = WGPUBufferUsage_Uniform | WGPUBufferUsage_CopyDst
+        });
+        WGPUBindGroupEntry entry = {
+            .binding = 0,
+            .buffer = uniformBuffers[i],
+            .size = 256,
+        };
+        groups[i] = wgpuDeviceCreateBindGroup(device, &(const WGPUBindGroupDescriptor){
+            .layout = bgl,
+            .entries = &entry,
+            .entryCount = 1
+        });
+    }
+
+    const BenchmarkScene scene = {
+        .device = device,
+        .queue = queue,
+        .target = targetView,
+        .pipeline = pipeline,
+        .vertexBuffer = vertexBuffer,
+        .groups = {groups[0], groups[1]},
+    };
+    const struct{
+        const char* name;
+        uint32_t drawCount;
+    }cases[3] = {
+        {"empty pass", 0},
+        {"1 draw", 1},
+        {"1000 draws", 1000},
+    };
+    printf("%-12s %14s %14s\n", "case", "us / pass", "ns / draw");
+    for(int c = 0;c < 3;c++){
+        for(int i = 0;i < WARMUP_ITERATIONS;i++){
+            encodePass(&scene, cases[c].drawCount);
+        }
+        uint64_t total = 0;
+        for(int i = 0;i < TIMED_ITERATIONS;i++){
+            total += encodePass(&scene, cases[c].drawCount);
+        }
+        const double nsPerPass = (double)total / TIMED_ITERATIONS;
+        if(cases[c].drawCount){
+            printf("%-12s %14.2f %14.1f\n", cases[c].name, nsPerPass / 1000.0, nsPerPass / cases[c].drawCount);
+        }
+        else{
+            printf("%-12s %14.2f %14s\n", cases[c].name, nsPerPass / 1000.0, "-");
+        }
+    }
+
+    for(int i = 0;i < 2;i++){
+        wgpuBindGroupRelease(groups[i]);
+        wgpuBufferRelease(uniformBuffers[i]);
+    }
+    wgpuBufferRelease(vertexBuffer);
+    wgpuRenderPipelineRelease(pipeline);
+    wgpuPipelineLayoutRelease(pllayout);
+    wgpuBindGroupLayoutRelease(bgl);
+    wgpuShaderModuleRelease(shaderModule);
+    wgpuTextureViewRelease(targetView);
+    wgpuTextureRelease(targetTexture);
+    wgpuQueueRelease(queue);
+    wgpuDeviceRelease(device);
+    wgpuAdapterRelease(requestedAdapter);
+    wgpuInstanceRelease(instance);
+    return 0;
+}
@@ -0,0 +1,279 @@
+// Compares uploading textures whose source data doesn't match the texture format, either converting on the
+// CPU into a temporary array followed by wgpuQueueWriteTexture, or letting wgpuQueueWriteTextureConverted
+// convert while it copies into staging memory. Throughput is reported in destination megabytes per second.
+#include <wgvk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef STRVIEW
+    #define STRVIEW(X) (WGPUStringView){X, sizeof(X) - 1}
+#endif
+
+/* ---------- POSIX / Unix-like ---------- */
+#if defined(__unix__) || defined(__APPLE__)
+  #include <time.h>
+
+  static inline uint64_t nanoTime(void)
+  {
+      struct timespec ts;
+  #if defined(CLOCK_MONOTONIC_RAW)        /* Linux, FreeBSD */
+      clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  #else                                   /* macOS 10.12+, other POSIX */
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+  #endif
+      return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+  }
+
+/* ---------- Windows ---------- */
+#elif defined(_WIN32)
+  #include <windows.h>
+
+  static inline uint64_t nanoTime(void)
+  {
+      static LARGE_INTEGER freq = { 0 };
+      if (freq.QuadPart == 0)               /* one-time init */
+          QueryPerformanceFrequency(&freq);
+
+      LARGE_INTEGER counter;
+      QueryPerformanceCounter(&counter);
+      /* scale ticks → ns: (ticks * 1e9) / freq */
+      return (uint64_t)((counter.QuadPart * 1000000000ULL) / freq.QuadPart);
+  }
+
+#else
+  #error "Platform not supported"
+#endif
+
+#define TEXTURE_EXTENT 1024
+#define WARMUP_ITERATIONS 4
+#define TIMED_ITERATIONS 32
+
+void adapterCallbackFunction(
+        enum WGPURequestAdapterStatus status,
+        WGPUAdapter adapter,
+        struct WGPUStringView label,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUAdapter*)userdata1) = adapter;
+}
+void deviceCallbackFunction(
+        WGPURequestDeviceStatus status,
+        WGPUDevice device,
+        WGPUStringView message,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUDevice*)userdata1) = device;
+}
+
+static uint16_t floatToHalf(float value){
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t exponent = (bits >> 23) & 0xFFu;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    if(exponent == 0xFFu){
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    }
+    const int32_t halfExponent = (int32_t)exponent - 127 + 15;
+    if(halfExponent >= 0x1F){
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    if(halfExponent <= 0){
+        if(halfExponent < -10){
+            return (uint16_t)sign;
+        }
+        mantissa |= 0x800000u;
+        const uint32_t shift = (uint32_t)(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1u);
+        const uint32_t halfway = 1u << (shift - 1u);
+        if(remainder > halfway || (remainder == halfway && (half & 1u))){
+            half++;
+        }
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1FFFu;
+    if(remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))){
+        half++;
+    }
+    return (uint16_t)(sign | half);
+}
+
+static void convertOnCpu(WGPUTexelConversion conversion, const void* src, void* dst, size_t texelCount){
+    switch(conversion){
+        case WGPUTexelConversion_RGB8ToRGBA8:{
+            const uint8_t* s = (const uint8_t*)src;
+            uint8_t* d = (uint8_t*)dst;
+            for(size_t i = 0;i < texelCount;i++){
+                d[i * 4 + 0] = s[i * 3 + 0];
+                d[i * 4 + 1] = s[i * 3 + 1];
+                d[i * 4 + 2] = s[i * 3 + 2];
+                d[i * 4 + 3] = 0xFF;
+            }
+        }break;
+        case WGPUTexelConversion_SwapRB8:{
+            const uint8_t* s = (const uint8_t*)src;
+            uint8_t* d = (uint8_t*)dst;
+            for(size_t i = 0;i < texelCount;i++){
+                d[i * 4 + 0] = s[i * 4 + 2];
+                d[i * 4 + 1] = s[i * 4 + 1];
+                d[i * 4 + 2] = s[i * 4 + 0];
+                d[i * 4 + 3] = s[i * 4 + 3];
+            }
+        }break;
+        case WGPUTexelConversion_Float32ToFloat16:{
+            const float* s = (const float*)src;
+            uint16_t* d = (uint16_t*)dst;
+            for(size_t i = 0;i < texelCount * 4;i++){
+                d[i] = floatToHalf(s[i]);
+            }
+        }break;
+        default: break;
+    }
+}
+
+// Flushes the queued uploads and waits for them, so staging memory doesn't pile up between iterations
+static void flushUploads(WGPUDevice device, WGPUQueue queue){
+    WGPUCommandEncoder cenc = wgpuDeviceCreateCommandEncoder(device, NULL);
+    WGPUCommandBuffer cmdBuffer = wgpuCommandEncoderFinish(cenc, NULL);
+    wgpuQueueSubmit(queue, 1, &cmdBuffer);
+    wgpuCommandBufferRelease(cmdBuffer);
+    wgpuCommandEncoderRelease(cenc);
+    wgpuDeviceTick(device);
+}
+
+// Returns the nanoseconds spent converting and staging one full upload of the texture
+static uint64_t upload(WGPUDevice device, WGPUQueue queue, WGPUTexture texture, WGPUTexelConversion conversion, uint32_t srcTexelSize, uint32_t dstTexelSize, const void* src, void* scratch, int converted){
+    const size_t texelCount = (size_t)TEXTURE_EXTENT * TEXTURE_EXTENT;
+    const WGPUTexelCopyTextureInfo destination = {
+        .texture = texture,
+        .aspect = WGPUTextureAspect_All,
+    };
+    const WGPUExtent3D writeSize = {TEXTURE_EXTENT, TEXTURE_EXTENT, 1};
+    const uint64_t start = nanoTime();
+    if(converted){
+        const WGPUTexelCopyBufferLayout layout = {
+            .bytesPerRow = TEXTURE_EXTENT * srcTexelSize,
+            .rowsPerImage = TEXTURE_EXTENT,
+        };
+        wgpuQueueWriteTextureConverted(queue, &destination, src, texelCount * srcTexelSize, &layout, &writeSize, conversion);
+    }
+    else{
+        const WGPUTexelCopyBufferLayout layout = {
+            .bytesPerRow = TEXTURE_EXTENT * dstTexelSize,
+            .rowsPerImage = TEXTURE_EXTENT,
+        };
+        convertOnCpu(conversion, src, scratch, texelCount);
+        wgpuQueueWriteTexture(queue, &destination, scratch, texelCount * dstTexelSize, &layout, &writeSize);
+    }
+    const uint64_t end = nanoTime();
+    flushUploads(device, queue);
+    return end - start;
+}
+
+int main(){
+    WGPUInstanceFeatureName instanceFeatures[1] = {
+        WGPUInstanceFeatureName_TimedWaitAny,
+    };
+    WGPUInstanceDescriptor instanceDescriptor = {
+        .nextInChain = NULL,
+        .requiredFeatures = instanceFeatures,
+        .requiredFeatureCount = 1,
+    };
+    WGPUInstance instance = wgpuCreateInstance(&instanceDescriptor);
+
+    WGPURequestAdapterOptions adapterOptions = {0};
+    adapterOptions.featureLevel = WGPUFeatureLevel_Core;
+    WGPUAdapter requestedAdapter = NULL;
+    WGPURequestAdapterCallbackInfo adapterCallback = {0};
+    adapterCallback.callback = adapterCallbackFunction;
+    adapterCallback.userdata1 = (void*)&requestedAdapter;
+    WGPUFutureWaitInfo adapterWaitInfo = {
+        .future = wgpuInstanceRequestAdapter(instance, &adapterOptions, adapterCallback),
+        .completed = 0
+    };
+    wgpuInstanceWaitAny(instance, 1, &adapterWaitInfo, ~0ull);
+
+    WGPUDeviceDescriptor deviceDescriptor = {
+        .label = STRVIEW("Benchmark Device"),
+    };
+    WGPUDevice device = NULL;
+    WGPURequestDeviceCallbackInfo requestDeviceCallbackInfo = {
+        .callback = deviceCallbackFunction,
+        .mode = WGPUCallbackMode_WaitAnyOnly,
+        .userdata1 = &device
+    };
+    WGPUFutureWaitInfo deviceWaitInfo = {
+        .future = wgpuAdapterRequestDevice(requestedAdapter, &deviceDescriptor, requestDeviceCallbackInfo),
+        .completed = 0
+    };
+    wgpuInstanceWaitAny(instance, 1, &deviceWaitInfo, ~0ull);
+    WGPUQueue queue = wgpuDeviceGetQueue(device);
+
+    const struct{
+        const char* name;
+        WGPUTexelConversion conversion;
+        WGPUTextureFormat format;
+        uint32_t srcTexelSize;
+        uint32_t dstTexelSize;
+    }cases[3] = {
+        {"RGB8 -> RGBA8", WGPUTexelConversion_RGB8ToRGBA8, WGPUTextureFormat_RGBA8Unorm, 3, 4},
+        {"BGRA8 -> RGBA8", WGPUTexelConversion_SwapRB8, WGPUTextureFormat_RGBA8Unorm, 4, 4},
+        {"RGBA32F -> RGBA16F", WGPUTexelConversion_Float32ToFloat16, WGPUTextureFormat_RGBA16Float, 16, 8},
+    };
+    const size_t texelCount = (size_t)TEXTURE_EXTENT * TEXTURE_EXTENT;
+    printf("%-20s %18s %18s\n", "conversion", "cpu + write MB/s", "converted MB/s");
+    for(int c = 0;c < 3;c++){
+        WGPUTexture texture = wgpuDeviceCreateTexture(device, &(const WGPUTextureDescriptor){
+            .usage = WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+            .dimension = WGPUTextureDimension_2D,
+            .size = {TEXTURE_EXTENT, TEXTURE_EXTENT, 1},
+            .format = cases[c].format,
+            .mipLevelCount = 1,
+            .sampleCount = 1,
+        });
+        const size_t srcSize = texelCount * cases[c].srcTexelSize;
+        uint8_t* src = (uint8_t*)malloc(srcSize);
+        void* scratch = malloc(texelCount * cases[c].dstTexelSize);
+        if(cases[c].conversion == WGPUTexelConversion_Float32ToFloat16){
+            float* values = (float*)src;
+            for(size_t i = 0;i < texelCount * 4;i++){
+                values[i] = (float)(i % 1024) / 1023.0f;
+            }
+        }
+        else{
+            for(size_t i = 0;i < srcSize;i++){
+                src[i] = (uint8_t)(i * 31);
+            }
+        }
+
+        double megabytesPerSecond[2];
+        for(int converted = 0;converted < 2;converted++){
+            for(int i = 0;i < WARMUP_ITERATIONS;i++){
+                upload(device, queue, texture, cases[c].conversion, cases[c].srcTexelSize, cases[c].dstTexelSize, src, scratch, converted);
+            }
+            uint64_t total = 0;
+            for(int i = 0;i < TIMED_ITERATIONS;i++){
+                total += upload(device, queue, texture, cases[c].conversion, cases[c].srcTexelSize, cases[c].dstTexelSize, src, scratch, converted);
+            }
+            const double bytes = (double)texelCount * cases[c].dstTexelSize * TIMED_ITERATIONS;
+            megabytesPerSecond[converted] = bytes / ((double)total / 1e9) / (1024.0 * 1024.0);
+        }
+        printf("%-20s %18.1f %18.1f\n", cases[c].name, megabytesPerSecond[0], megabytesPerSecond[1]);
+
+        free(scratch);
+        free(src);
+        wgpuTextureRelease(texture);
+    }
+
+    wgpuQueueRelease(queue);
+    wgpuDeviceRelease(device);
+    wgpuAdapterRelease(requestedAdapter);
+    wgpuInstanceRelease(instance);
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Records a labeled compute pass and a labeled debug group per frame with timestamp profiling enabled and checks
+// that wgpuDeviceGetTimestampStatistics reports both labels once the frames retired.
+// Exits with 77 (skipped) without a Vulkan adapter or on devices that can't time scopes on the graphics queue.
+#include <wgvk.h>
+#include <wgvk_structs_impl.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef STRVIEW
+    #define STRVIEW(X) (WGPUStringView){X, sizeof(X) - 1}
+#endif
+
+#define FRAME_COUNT 8
+#define SKIP_RETURN_CODE 77
+
+void adapterCallbackFunction(
+        enum WGPURequestAdapterStatus status,
+        WGPUAdapter adapter,
+        struct WGPUStringView label,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUAdapter*)userdata1) = adapter;
+}
+void deviceCallbackFunction(
+        WGPURequestDeviceStatus status,
+        WGPUDevice device,
+        WGPUStringView message,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUDevice*)userdata1) = device;
+}
+void errorCallbackFunction(const WGPUDevice* device, WGPUErrorType type, WGPUStringView message, void* userdata1, void* userdata2){
+    fprintf(stderr, "Device error: %.*s\n", (int)message.length, message.data);
+    ++*((int*)userdata1);
+}
+
+static const WGPUTimestampStatistics* findLabel(const WGPUTimestampStatistics* statistics, size_t count, const char* label){
+    for(size_t i = 0;i < count;i++){
+        if(statistics[i].label.length == strlen(label) && memcmp(statistics[i].label.data, label, statistics[i].label.length) == 0){
+            return statistics + i;
+        }
+    }
+    return NULL;
+}
+
+static int checkLabel(const WGPUTimestampStatistics* statistics, size_t count, const char* label){
+    const WGPUTimestampStatistics* entry = findLabel(statistics, count, label);
+    if(entry == NULL){
+        fprintf(stderr, "No statistics for scope \"%s\"\n", label);
+        return 0;
+    }
+    printf("%s: %u samples, min %f ms, average %f ms, max %f ms\n", label, entry->sampleCount, entry->minMilliseconds, entry->averageMilliseconds, entry->maxMilliseconds);
+    if(entry->sampleCount == 0 || entry->minMilliseconds < 0.0 || entry->minMilliseconds > entry->averageMilliseconds || entry->averageMilliseconds > entry->maxMilliseconds){
+        fprintf(stderr, "Inconsistent statistics for scope \"%s\"\n", label);
+        return 0;
+    }
+    return 1;
+}
+
+int main(){
+    WGPUInstanceFeatureName instanceFeatures[1] = {
+        WGPUInstanceFeatureName_TimedWaitAny,
+    };
+    WGPUInstance instance = wgpuCreateInstance(&(const WGPUInstanceDescriptor){
+        .requiredFeatures = instanceFeatures,
+        .requiredFeatureCount = 1,
+    });
+    if(instance == NULL){
+        printf("No Vulkan instance, skipping\n");
+        return SKIP_RETURN_CODE;
+    }
+
+    WGPUAdapter adapter = NULL;
+    WGPURequestAdapterOptions adapterOptions = {0};
+    adapterOptions.featureLevel = WGPUFeatureLevel_Core;
+    WGPURequestAdapterCallbackInfo adapterCallback = {0};
+    adapterCallback.callback = adapterCallbackFunction;
+    adapterCallback.userdata1 = (void*)&adapter;
+    WGPUFutureWaitInfo adapterWaitInfo = {
+        .future = wgpuInstanceRequestAdapter(instance, &adapterOptions, adapterCallback),
+    };
+    wgpuInstanceWaitAny(instance, 1, &adapterWaitInfo, ~0ull);
+    if(adapter == NULL){
+        printf("No adapter, skipping\n");
+        wgpuInstanceRelease(instance);
+        return SKIP_RETURN_CODE;
+    }
+
+    int errorCount = 0;
+    WGPUDeviceTimestampProfiling profiling = {
+        .chain = {
+            .sType = WGPUSType_DeviceTimestampProfiling
+        },
+        .enabled = 1,
+        .maxScopesPerFrame = 4,
+    };
+    WGPUDeviceDescriptor deviceDescriptor = {
+        .nextInChain = &profiling.chain,
+        .label = STRVIEW("Timestamp Statistics Device"),
+        .uncapturedErrorCallbackInfo = {
+            .callback = errorCallbackFunction,
+            .userdata1 = &errorCount,
+        },
+    };
+    WGPUDevice device = NULL;
+    WGPURequestDeviceCallbackInfo requestDeviceCallbackInfo = {
+        .callback = deviceCallbackFunction,
+        .mode = WGPUCallbackMode_WaitAnyOnly,
+        .userdata1 = &device
+    };
+    WGPUFutureWaitInfo deviceWaitInfo = {
+        .future = wgpuAdapterRequestDevice(adapter, &deviceDescriptor, requestDeviceCallbackInfo),
+    };
+    wgpuInstanceWaitAny(instance, 1, &deviceWaitInfo, ~0ull);
+
+    if(device->timestampScopeCapacity == 0){
+        printf("Timestamp profiling is unavailable on this device, skipping\n");
+        wgpuDeviceRelease(device);
+        wgpuAdapterRelease(adapter);
+        wgpuInstanceRelease(instance);
+        return SKIP_RETURN_CODE;
+    }
+
+    WGPUQueue queue = wgpuDeviceGetQueue(device);
+    WGPUBuffer buffer = wgpuDeviceCreateBuffer(device, &(const WGPUBufferDescriptor){
+        .size = 1 << 16,
+        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage,
+    });
+
+    for(uint32_t frame = 0;frame < FRAME_COUNT;frame++){
+        WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, NULL);
+        wgpuCommandEncoderPushDebugGroup(encoder, STRVIEW("Clear"));
+        wgpuCommandEncoderClearBuffer(encoder, buffer, 0, 1 << 16);
+        wgpuCommandEncoderPopDebugGroup(encoder);
+        WGPUComputePassEncoder pass = wgpuCommandEncoderBeginComputePass(encoder, &(const WGPUComputePassDescriptor){
+            .label = STRVIEW("Dispatch"),
+        });
+        wgpuComputePassEncoderEnd(pass);
+        wgpuComputePassEncoderRelease(pass);
+        WGPUCommandBuffer commandBuffer = wgpuCommandEncoderFinish(encoder, NULL);
+        wgpuCommandEncoderRelease(encoder);
+        wgpuQueueSubmit(queue, 1, &commandBuffer);
+        wgpuCommandBufferRelease(commandBuffer);
+        wgpuDeviceTick(device);
+    }
+    // The last frames are collected once their caches come around again
+    for(uint32_t i = 0;i < framesInFlight;i++){
+        wgpuDeviceTick(device);
+    }
+
+    int success = 1;
+    WGPUTimestampStatistics statistics[8] = {0};
+    const size_t labelCount = wgpuDeviceGetTimestampStatistics(device, statistics, 8);
+    if(wgpuDeviceGetTimestampStatistics(device, NULL, 0) != labelCount){
+        fprintf(stderr, "Label count depends on the capacity\n");
+        success = 0;
+    }
+    success &= checkLabel(statistics, labelCount < 8 ? labelCount : 8, "Clear");
+    success &= checkLabel(statistics, labelCount < 8 ? labelCount : 8, "Dispatch");
+    if(errorCount){
+        success = 0;
+    }
+
+    wgpuBufferRelease(buffer);
+    wgpuQueueRelease(queue);
+    wgpuDeviceRelease(device);
+    wgpuAdapterRelease(adapter);
+    wgpuInstanceRelease(instance);
+    printf(success ? "Timestamp statistics test passed\n" : "Timestamp statistics test failed\n");
+    return success ? 0 : 1;
+}
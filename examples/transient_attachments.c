@@ -0,0 +1,232 @@
+// Checks that attachment-only MSAA color and depth textures are created with VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT
+// (see WGVK_IMPLICIT_TRANSIENT_ATTACHMENTS) while textures with other usages are not, then renders with them:
+// the MSAA target is cleared, resolved and discarded, and the resolved texels are read back. On devices without a
+// lazily allocated memory type this runs on the DEVICE_LOCAL fallback memory.
+// Exits with 77 (skipped) without a Vulkan adapter.
+#include <wgvk.h>
+#include <wgvk_structs_impl.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef STRVIEW
+    #define STRVIEW(X) (WGPUStringView){X, sizeof(X) - 1}
+#endif
+
+#define EXTENT 64
+#define SKIP_RETURN_CODE 77
+
+void adapterCallbackFunction(
+        enum WGPURequestAdapterStatus status,
+        WGPUAdapter adapter,
+        struct WGPUStringView label,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUAdapter*)userdata1) = adapter;
+}
+void deviceCallbackFunction(
+        WGPURequestDeviceStatus status,
+        WGPUDevice device,
+        WGPUStringView message,
+        void* userdata1,
+        void* userdata2
+    ){
+    *((WGPUDevice*)userdata1) = device;
+}
+void errorCallbackFunction(const WGPUDevice* device, WGPUErrorType type, WGPUStringView message, void* userdata1, void* userdata2){
+    fprintf(stderr, "Device error: %.*s\n", (int)message.length, message.data);
+    ++*((int*)userdata1);
+}
+
+static WGPUTexture createTexture(WGPUDevice device, WGPUTextureFormat format, WGPUTextureUsage usage, uint32_t sampleCount, uint32_t mipLevelCount){
+    return wgpuDeviceCreateTexture(device, &(const WGPUTextureDescriptor){
+        .usage = usage,
+        .dimension = WGPUTextureDimension_2D,
+        .size = {EXTENT, EXTENT, 1},
+        .format = format,
+        .mipLevelCount = mipLevelCount,
+        .sampleCount = sampleCount,
+        .viewFormatCount = 1,
+        .viewFormats = &format,
+    });
+}
+
+/**
+ * @brief Reports whether the texture is transient as expected and whether its memory type could have been lazily allocated
+ */
+static int checkTransient(WGPUDevice device, WGPUTexture texture, const char* name, int expectTransient){
+    const int transient = (texture->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+    VkMemoryRequirements requirements;
+    device->functions.vkGetImageMemoryRequirements(device->device, texture->image, &requirements);
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device->adapter->physicalDevice, &memoryProperties);
+    int lazilyAllocatable = 0;
+    for(uint32_t i = 0;i < memoryProperties.memoryTypeCount;i++){
+        if((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)){
+            lazilyAllocatable = 1;
+        }
+    }
+    printf("%s: %s, %s\n", name, transient ? "transient" : "not transient",
+        !transient ? "regular memory" : (lazilyAllocatable ? "lazily allocated memory" : "DEVICE_LOCAL fallback memory"));
+    if(transient != expectTransient){
+        fprintf(stderr, "%s: expected the texture to be %s\n", name, expectTransient ? "transient" : "not transient");
+        return 0;
+    }
+    if(texture->memory == VK_NULL_HANDLE){
+        fprintf(stderr, "%s: no memory was allocated\n", name);
+        return 0;
+    }
+    return 1;
+}
+
+int main(){
+    WGPUInstanceFeatureName instanceFeatures[1] = {
+        WGPUInstanceFeatureName_TimedWaitAny,
+    };
+    WGPUInstance instance = wgpuCreateInstance(&(const WGPUInstanceDescriptor){
+        .requiredFeatures = instanceFeatures,
+        .requiredFeatureCount = 1,
+    });
+    if(instance == NULL){
+        printf("No Vulkan instance, skipping\n");
+        return SKIP_RETURN_CODE;
+    }
+
+    WGPUAdapter adapter = NULL;
+    WGPURequestAdapterOptions adapterOptions = {0};
+    adapterOptions.featureLevel = WGPUFeatureLevel_Core;
+    WGPURequestAdapterCallbackInfo adapterCallback = {0};
+    adapterCallback.callback = adapterCallbackFunction;
+    adapterCallback.userdata1 = (void*)&adapter;
+    WGPUFutureWaitInfo adapterWaitInfo = {
+        .future = wgpuInstanceRequestAdapter(instance, &adapterOptions, adapterCallback),
+    };
+    wgpuInstanceWaitAny(instance, 1, &adapterWaitInfo, ~0ull);
+    if(adapter == NULL){
+        printf("No adapter, skipping\n");
+        wgpuInstanceRelease(instance);
+        return SKIP_RETURN_CODE;
+    }
+
+    int errorCount = 0;
+    WGPUDeviceDescriptor deviceDescriptor = {
+        .label = STRVIEW("Transient Attachment Device"),
+        .uncapturedErrorCallbackInfo = {
+            .callback = errorCallbackFunction,
+            .userdata1 = &errorCount,
+        },
+    };
+    WGPUDevice device = NULL;
+    WGPURequestDeviceCallbackInfo requestDeviceCallbackInfo = {
+        .callback = deviceCallbackFunction,
+        .mode = WGPUCallbackMode_WaitAnyOnly,
+        .userdata1 = &device
+    };
+    WGPUFutureWaitInfo deviceWaitInfo = {
+        .future = wgpuAdapterRequestDevice(adapter, &deviceDescriptor, requestDeviceCallbackInfo),
+    };
+    wgpuInstanceWaitAny(instance, 1, &deviceWaitInfo, ~0ull);
+    WGPUQueue queue = wgpuDeviceGetQueue(device);
+
+    WGPUTexture msaaColor    = createTexture(device, WGPUTextureFormat_RGBA8Unorm, WGPUTextureUsage_RenderAttachment, 4, 1);
+    WGPUTexture depth        = createTexture(device, WGPUTextureFormat_Depth24Plus, WGPUTextureUsage_RenderAttachment, 1, 1);
+    WGPUTexture resolve      = createTexture(device, WGPUTextureFormat_RGBA8Unorm, WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc, 1, 1);
+    WGPUTexture sampledMsaa  = createTexture(device, WGPUTextureFormat_RGBA8Unorm, WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_TextureBinding, 4, 1);
+    WGPUTexture mippedDepth  = createTexture(device, WGPUTextureFormat_Depth24Plus, WGPUTextureUsage_RenderAttachment, 1, 2);
+
+    int success = 1;
+    success &= checkTransient(device, msaaColor, "Attachment-only MSAA color", WGVK_IMPLICIT_TRANSIENT_ATTACHMENTS);
+    success &= checkTransient(device, depth, "Attachment-only depth", WGVK_IMPLICIT_TRANSIENT_ATTACHMENTS);
+    success &= checkTransient(device, resolve, "Single sampled color", 0);
+    success &= checkTransient(device, sampledMsaa, "Sampled MSAA color", 0);
+    success &= checkTransient(device, mippedDepth, "Mipmapped depth", 0);
+
+    WGPUTextureView msaaView = wgpuTextureCreateView(msaaColor, NULL);
+    WGPUTextureView depthView = wgpuTextureCreateView(depth, NULL);
+    WGPUTextureView resolveView = wgpuTextureCreateView(resolve, NULL);
+    WGPUBuffer readback = wgpuDeviceCreateBuffer(device, &(const WGPUBufferDescriptor){
+        .size = EXTENT * EXTENT * 4,
+        .usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead,
+    });
+
+    // Two frames, so the second pass reuses attachments whose contents were discarded by the first
+    for(uint32_t frame = 0;frame < 2;frame++){
+        WGPUCommandEncoder encoder = wgpuDeviceCreateCommandEncoder(device, NULL);
+        const WGPURenderPassColorAttachment colorAttachment = {
+            .view = msaaView,
+            .resolveTarget = resolveView,
+            .depthSlice = WGPU_DEPTH_SLICE_UNDEFINED,
+            .loadOp = WGPULoadOp_Clear,
+            .storeOp = WGPUStoreOp_Discard,
+            .clearValue = {1.0, 0.0, frame ? 1.0 : 0.0, 1.0},
+        };
+        const WGPURenderPassDepthStencilAttachment depthAttachment = {
+            .view = depthView,
+            .depthLoadOp = WGPULoadOp_Clear,
+            .depthStoreOp = WGPUStoreOp_Discard,
+            .depthClearValue = 1.0f,
+        };
+        WGPURenderPassEncoder pass = wgpuCommandEncoderBeginRenderPass(encoder, &(const WGPURenderPassDescriptor){
+            .colorAttachmentCount = 1,
+            .colorAttachments = &colorAttachment,
+            .depthStencilAttachment = &depthAttachment,
+        });
+        wgpuRenderPassEncoderEnd(pass);
+        wgpuRenderPassEncoderRelease(pass);
+        wgpuCommandEncoderCopyTextureToBuffer(encoder,
+            &(const WGPUTexelCopyTextureInfo){
+                .texture = resolve,
+                .aspect = WGPUTextureAspect_All,
+            },
+            &(const WGPUTexelCopyBufferInfo){
+                .buffer = readback,
+                .layout = {
+                    .bytesPerRow = EXTENT * 4,
+                    .rowsPerImage = EXTENT,
+                }
+            },
+            &(const WGPUExtent3D){EXTENT, EXTENT, 1}
+        );
+        WGPUCommandBuffer commandBuffer = wgpuCommandEncoderFinish(encoder, NULL);
+        wgpuCommandEncoderRelease(encoder);
+        wgpuQueueSubmit(queue, 1, &commandBuffer);
+        wgpuCommandBufferRelease(commandBuffer);
+
+        const uint8_t* texels = NULL;
+        wgpuBufferMap(readback, WGPUMapMode_Read, 0, EXTENT * EXTENT * 4, (void**)&texels);
+        const uint8_t expected[4] = {0xFF, 0x00, frame ? 0xFF : 0x00, 0xFF};
+        for(uint32_t i = 0;texels != NULL && i < EXTENT * EXTENT;i++){
+            if(memcmp(texels + i * 4, expected, 4) != 0){
+                fprintf(stderr, "Frame %u: resolved texel %u is (%u, %u, %u, %u)\n", frame, i, texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3]);
+                success = 0;
+                break;
+            }
+        }
+        if(texels == NULL){
+            fprintf(stderr, "Frame %u: mapping the readback buffer failed\n", frame);
+            success = 0;
+        }
+        else{
+            wgpuBufferUnmap(readback);
+        }
+    }
+    if(errorCount){
+        success = 0;
+    }
+
+    wgpuBufferRelease(readback);
+    wgpuTextureViewRelease(resolveView);
+    wgpuTextureViewRelease(depthView);
+    wgpuTextureViewRelease(msaaView);
+    wgpuTextureRelease(mippedDepth);
+    wgpuTextureRelease(sampledMsaa);
+    wgpuTextureRelease(resolve);
+    wgpuTextureRelease(depth);
+    wgpuTextureRelease(msaaColor);
+    wgpuQueueRelease(queue);
+    wgpuDeviceRelease(device);
+    wgpuAdapterRelease(adapter);
+    wgpuInstanceRelease(instance);
+    printf(success ? "Transient attachment test passed\n" : "Transient attachment test failed\n");
+    return success ? 0 : 1;
+}
@@ -289,6 +289,11 @@ typedef enum WGPUSType {
     WGPUSType_ShaderSourceGLSL = 0x10000003,
     WGPUSType_PrimitiveLineWidthInfo = 0x10000004,
     WGPUSType_SurfaceSourceDrmPlane = 0x10000005,
+    WGPUSType_DeviceParallelRecording = 0x10000006,
+    WGPUSType_BindGroupLayoutEntryArraySize = 0x10000007,
+    WGPUSType_DeviceTimestampProfiling = 0x10000008,
+    WGPUSType_SurfaceFrameLatency = 0x10000009,
+    WGPUSType_SurfaceSourceHeadless = 0x1000000A,
 }WGPUSType WGPU_ENUM_ATTRIBUTE;
 
 typedef enum WGPUCallbackMode {
@@ -314,6 +319,10 @@ typedef struct WGPUStringView{
 #define WGPU_STRLEN (SIZE_MAX)
 #define WGPU_WHOLE_MAP_SIZE (SIZE_MAX)
 #define WGPU_WHOLE_SIZE (UINT64_MAX)
+// Upper bound of WGPUPipelineLayoutDescriptor::immediateDataRangeByteSize, the push constant size every Vulkan device supports
+#define WGVK_MAX_IMMEDIATE_DATA_SIZE 128
+// Returned by wgpuBindGroupAllocateSlot when the binding array has no free element left
+#define WGVK_INVALID_SLOT (UINT32_MAX)
 
 typedef struct WGPUTexelCopyBufferLayout {
     uint64_t offset;
@@ -321,6 +330,15 @@ typedef struct WGPUTexelCopyBufferLayout {
     uint32_t rowsPerImage;
 } WGPUTexelCopyBufferLayout;
 
+// Conversions wgpuQueueWriteTextureConverted applies while copying texels into staging memory
+typedef enum WGPUTexelConversion {
+    WGPUTexelConversion_None             = 0x00000000,
+    WGPUTexelConversion_RGB8ToRGBA8      = 0x00000001, // 3 byte texels into 4 byte formats, alpha set to 0xFF
+    WGPUTexelConversion_SwapRB8          = 0x00000002, // BGRA8 <-> RGBA8
+    WGPUTexelConversion_Float32ToFloat16 = 0x00000003, // Into R16Float, RG16Float or RGBA16Float, rounding to nearest even
+    WGPUTexelConversion_Force32          = 0x7FFFFFFF
+} WGPUTexelConversion;
+
 typedef enum WGPUCompareFunction {
     WGPUCompareFunction_Undefined = 0x00000000,
     WGPUCompareFunction_Never = 0x00000001,
@@ -944,6 +962,12 @@ typedef struct WGPUAdapterPropertiesSubgroups {
     uint32_t subgroupMaxSize;
 } WGPUAdapterPropertiesSubgroups WGPU_STRUCTURE_ATTRIBUTE;
 
+/**
+ * @brief Chained into WGPUBindGroupLayoutEntry to make the binding an array of arraySize descriptors
+ * @details On devices with descriptor indexing (Vulkan 1.2), arrays are partially bound and, where the descriptor 
+ * type allows it, update-after-bind: shaders index them directly (e.g. SPIR-V runtime arrays) and 
+ * elements that are never accessed need not be written. Elements are managed with wgpuBindGroupAllocateSlot.
+ */
 typedef struct WGPUBindGroupLayoutEntryArraySize {
     WGPUChainedStruct chain;
     uint32_t arraySize;
@@ -1127,6 +1151,19 @@ typedef struct WGPUSurfaceSourceDrmPlane {
     WGPUBool acquireExclusive;
 } WGPUSurfaceSourceDrmPlane;
 
+/**
+ * @brief Surface source without a window system, to run and benchmark the full frame loop on headless machines
+ * @details With useHeadlessSurfaceExtension on instances exposing VK_EXT_headless_surface, a VkSurfaceKHR is created and
+ * the regular swapchain path is taken. Otherwise the surface is virtual: wgpuSurfaceConfigure creates a ring of
+ * maxQueuedFrames + 1 offscreen textures (see WGPUSurfaceFrameLatency), wgpuSurfaceGetCurrentTexture hands them out in
+ * order and wgpuSurfacePresent transitions the presented one to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, submits and ticks
+ * the device. Nothing paces a virtual surface besides the frame latency bound, every present mode behaves like Immediate.
+ */
+typedef struct WGPUSurfaceSourceHeadless{
+    WGPUChainedStruct chain;
+    WGPUBool useHeadlessSurfaceExtension;
+}WGPUSurfaceSourceHeadless;
+
 
 
 typedef struct WGPUSurfaceDescriptor{
@@ -1322,6 +1359,40 @@ typedef struct WGPUDeviceDescriptor {
     WGPUUncapturedErrorCallbackInfo uncapturedErrorCallbackInfo;
 } WGPUDeviceDescriptor WGPU_STRUCT_ATTRIBUTE;
 
+/**
+ * @brief Chained into WGPUDeviceDescriptor to replay render passes on the device's worker threads
+ * @details When enabled, wgpuRenderPassEncoderEnd hands the replay of passes with at least
+ * minCommandCount buffered commands to a worker, and wgpuCommandEncoderFinish waits for them.
+ * minCommandCount = 0 selects a default.
+ */
+typedef struct WGPUDeviceParallelRecording{
+    WGPUChainedStruct chain;
+    WGPUBool parallelPassRecording;
+    uint32_t minCommandCount;
+}WGPUDeviceParallelRecording;
+
+/**
+ * @brief Chained into WGPUDeviceDescriptor to time every render pass, compute pass and command encoder debug group on the GPU
+ * @details Each command encoder that opens a scope gets a timestamp query pool for maxScopesPerFrame scopes (0 selects 
+ * WGVK_TIMESTAMP_DEFAULT_SCOPES), further scopes of that encoder are not timed. The pool belongs to the frame the command 
+ * buffer is submitted in: wgpuDeviceTick collects the results of the frame it recycles without waiting 
+ * and folds them into rolling statistics per scope label, see wgpuDeviceGetTimestampStatistics. 
+ * Ignored on devices without timestamp support on the graphics queue or without hostQueryReset.
+ */
+typedef struct WGPUDeviceTimestampProfiling{
+    WGPUChainedStruct chain;
+    WGPUBool enabled;
+    uint32_t maxScopesPerFrame;
+}WGPUDeviceTimestampProfiling;
+
+typedef struct WGPUTimestampStatistics{
+    WGPUStringView label;
+    double minMilliseconds;
+    double averageMilliseconds;
+    double maxMilliseconds;
+    uint32_t sampleCount; // At most WGVK_TIMESTAMP_STATISTICS_WINDOW
+}WGPUTimestampStatistics;
+
 typedef struct WGPUColor {
     double r;
     double g;
@@ -1329,6 +1400,24 @@ typedef struct WGPUColor {
     double a;
 } WGPUColor;
 
+/**
+ * @brief Subresources and value for wgpuCommandEncoderClearTexture
+ * @details Counts of WGPU_MIP_LEVEL_COUNT_UNDEFINED / WGPU_ARRAY_LAYER_COUNT_UNDEFINED clear the remaining levels or layers.
+ * color is used for color formats (converted to integers for integer formats), depthClearValue and stencilClearValue for the
+ * aspects of depth stencil formats selected by aspect.
+ */
+typedef struct WGPUTextureClearDescriptor{
+    WGPUChainedStruct* nextInChain;
+    WGPUTextureAspect aspect;
+    uint32_t baseMipLevel;
+    uint32_t mipLevelCount;
+    uint32_t baseArrayLayer;
+    uint32_t arrayLayerCount;
+    WGPUColor color;
+    float depthClearValue;
+    uint32_t stencilClearValue;
+}WGPUTextureClearDescriptor;
+
 typedef struct WGPURenderPassColorAttachment{
     WGPUChainedStruct* nextInChain;
     WGPUTextureView view;
@@ -1799,6 +1888,36 @@ typedef struct WGPUSurfaceConfiguration {
     WGPUPresentMode presentMode;
 } WGPUSurfaceConfiguration WGPU_STRUCT_ATTRIBUTE;
 
+/**
+ * @brief Chained into WGPUSurfaceConfiguration to bound how many presented frames may be queued ahead of the display
+ * @details maxQueuedFrames is clamped to [1, framesInFlight], 0 keeps the default of framesInFlight. The swapchain is sized
+ * to hold maxQueuedFrames images besides the one being rendered. wgpuSurfaceGetCurrentTexture blocks until at most 
+ * maxQueuedFrames - 1 earlier presents are outstanding: with waitForPresent on devices supporting VK_KHR_present_wait 
+ * until they reached the display, otherwise until their GPU work has retired.
+ */
+typedef struct WGPUSurfaceFrameLatency{
+    WGPUChainedStruct chain;
+    uint32_t maxQueuedFrames;
+    WGPUBool waitForPresent;
+}WGPUSurfaceFrameLatency;
+
+// CPU-side frame pacing of a surface over its most recent WGVK_PACING_STATISTICS_WINDOW frames
+typedef struct WGPUSurfacePacingStatistics{
+    uint32_t sampleCount;
+    double averageAcquireWaitMilliseconds; // Latency wait plus vkAcquireNextImageKHR in wgpuSurfaceGetCurrentTexture
+    double maxAcquireWaitMilliseconds;
+    double averagePresentIntervalMilliseconds; // Between consecutive wgpuSurfacePresent calls
+    double maxPresentIntervalMilliseconds;
+    WGPUBool presentWait; // Whether the latency bound is enforced with VK_KHR_present_wait
+}WGPUSurfacePacingStatistics;
+
+// Lookups of wgpuTextureCreateView in the per-texture view caches of a device, the hit rate is hits / (hits + misses)
+typedef struct WGPUTextureViewCacheStatistics{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions; // Unreferenced views destroyed to keep a texture within WGVK_TEXTURE_VIEW_CACHE_SIZE
+}WGPUTextureViewCacheStatistics;
+
 typedef void (*WGPURequestAdapterCallback)(WGPURequestAdapterStatus status, WGPUAdapter adapter, struct WGPUStringView message, void* userdata1, void* userdata2);
 typedef void (*WGPURequestDeviceCallback) (WGPURequestDeviceStatus status, WGPUDevice device, WGPUStringView message, WGPU_NULLABLE void* userdata1, WGPU_NULLABLE void* userdata2) WGPU_FUNCTION_ATTRIBUTE;
 
@@ -1949,6 +2068,13 @@ WGVK_EXPORT void wgpuBufferUnmap(WGPUBuffer buffer);
 WGVK_EXPORT WGPUFuture wgpuBufferMapAsync(WGPUBuffer buffer, WGPUMapMode mode, size_t offset, size_t size, WGPUBufferMapCallbackInfo callbackInfo);
 WGVK_EXPORT size_t wgpuBufferGetSize(WGPUBuffer buffer);
 WGVK_EXPORT void wgpuQueueWriteTexture(WGPUQueue queue, WGPUTexelCopyTextureInfo const * destination, const void* data, size_t dataSize, WGPUTexelCopyBufferLayout const * dataLayout, WGPUExtent3D const * writeSize);
+/**
+ * @brief wgpuQueueWriteTexture with the texels converted as they are written into staging memory
+ * @details dataLayout describes data in the source format (3 byte texels for RGB8ToRGBA8, floats for Float32ToFloat16).
+ * Rows are repacked tightly while converting, any row or image padding in data is skipped. Vectorized with
+ * SSE2 / SSSE3 / AVX2 / F16C / NEON where the compiler targets them and WGVK_SIMD_TEXEL_CONVERSION is on.
+ */
+WGVK_EXPORT void wgpuQueueWriteTextureConverted(WGPUQueue queue, WGPUTexelCopyTextureInfo const * destination, const void* data, size_t dataSize, WGPUTexelCopyBufferLayout const * dataLayout, WGPUExtent3D const * writeSize, WGPUTexelConversion conversion);
 
 WGVK_EXPORT WGPUFence wgpuDeviceCreateFence                      (WGPUDevice device);
 WGVK_EXPORT void wgpuFenceWait                                   (WGPUFence fence, uint64_t timeoutNS);
@@ -2020,6 +2146,54 @@ WGVK_EXPORT void wgpuRenderBundleEncoderAddRef(WGPURenderBundleEncoder renderBun
 WGVK_EXPORT void wgpuRenderBundleEncoderRelease(WGPURenderBundleEncoder renderBundleEncoder) WGPU_FUNCTION_ATTRIBUTE;
 WGVK_EXPORT void wgpuRenderPassEncoderExecuteBundles(WGPURenderPassEncoder renderPassEncoder, size_t bundleCount, WGPURenderBundle const * bundles) WGPU_FUNCTION_ATTRIBUTE;
 
+/**
+ * @brief Sets size bytes of immediate data (push constants) at offset, visible to all shader stages
+ * @details The pipeline layout declares the range with immediateDataRangeByteSize. offset and size must be multiples 
+ * of 4 and offset + size at most WGVK_MAX_IMMEDIATE_DATA_SIZE. Values persist across pipeline changes within a pass.
+ */
+WGVK_EXPORT void wgpuRenderPassEncoderSetImmediateData(WGPURenderPassEncoder renderPassEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuComputePassEncoderSetImmediateData(WGPUComputePassEncoder computePassEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuRaytracingPassEncoderSetImmediateData(WGPURaytracingPassEncoder raytracingPassEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuRenderBundleEncoderSetImmediateData(WGPURenderBundleEncoder renderBundleEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE;
+
+/**
+ * @brief Stable element allocation in array bindings declared with WGPUBindGroupLayoutEntryArraySize
+ * @details AllocateSlot returns an unused element index of the array at binding, or WGVK_INVALID_SLOT when full. 
+ * Indices stay valid until freed and freed indices are handed out again. WriteSlot writes a single element without 
+ * touching the rest of the group, entry->binding selects the array. On update-after-bind arrays this is allowed while 
+ * the group is bound or in flight, as long as the written element isn't accessed by pending work.
+ * A slot references what was last written to it. Overwriting or freeing it, or rewriting the group with wgpuWriteBindGroup 
+ * (which frees all slots), releases the previous contents once the frames that may still read them have retired.
+ */
+WGVK_EXPORT uint32_t wgpuBindGroupAllocateSlot(WGPUBindGroup bindGroup, uint32_t binding) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuBindGroupWriteSlot(WGPUBindGroup bindGroup, uint32_t slot, WGPUBindGroupEntry const * entry) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuBindGroupFreeSlot(WGPUBindGroup bindGroup, uint32_t binding, uint32_t slot) WGPU_FUNCTION_ATTRIBUTE;
+
+/**
+ * @brief GPU time statistics per scope label over its most recent WGVK_TIMESTAMP_STATISTICS_WINDOW samples
+ * @details Writes up to capacity entries and returns the number of labels, 0 if timestamp profiling is off.
+ * Scopes are labeled with the pass label ("RenderPass" / "ComputePass" if empty) or the debug group label.
+ * The label strings are owned by the device and stay valid until the next wgpuDeviceTick.
+ */
+WGVK_EXPORT size_t wgpuDeviceGetTimestampStatistics(WGPUDevice device, WGPUTimestampStatistics* statistics, size_t capacity) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuSurfaceGetPacingStatistics(WGPUSurface surface, WGPUSurfacePacingStatistics* statistics) WGPU_FUNCTION_ATTRIBUTE;
+WGVK_EXPORT void wgpuDeviceGetTextureViewCacheStatistics(WGPUDevice device, WGPUTextureViewCacheStatistics* statistics) WGPU_FUNCTION_ATTRIBUTE;
+
+/**
+ * @brief Fills mip levels 1.. of every layer of texture from level 0
+ * @details Uses linear vkCmdBlitImage when the format supports it (requires CopySrc | CopyDst usage). 2D formats 
+ * without linear blits fall back to a built-in 2x2 box filter compute shader (requires StorageBinding usage and a 
+ * build with SUPPORT_WGSL), and to nearest blits otherwise. Afterwards the texture is in a transfer source or 
+ * general layout, the next use inserts the transition as with any other command.
+ */
+WGVK_EXPORT void wgpuCommandEncoderGenerateMipmaps(WGPUCommandEncoder commandEncoder, WGPUTexture texture) WGPU_FUNCTION_ATTRIBUTE;
+
+/**
+ * @brief Clears a subresource range of texture on the GPU with vkCmdClearColorImage / vkCmdClearDepthStencilImage
+ * @details Requires CopyDst usage and a single sampled texture. A NULL descriptor clears every level and layer to zero.
+ */
+WGVK_EXPORT void wgpuCommandEncoderClearTexture(WGPUCommandEncoder commandEncoder, WGPUTexture texture, WGPUTextureClearDescriptor const * descriptor) WGPU_FUNCTION_ATTRIBUTE;
+
 WGVK_EXPORT void wgpuAdapterInfoFreeMembers(WGPUAdapterInfo value) WGPU_FUNCTION_ATTRIBUTE;
 WGVK_EXPORT WGPUStatus wgpuGetInstanceCapabilities(WGPUInstanceCapabilities * capabilities) WGPU_FUNCTION_ATTRIBUTE;
 WGVK_EXPORT WGPUProc wgpuGetProcAddress(WGPUStringView procName) WGPU_FUNCTION_ATTRIBUTE;
@@ -37,6 +37,56 @@
 #ifndef VULKAN_ENABLE_RAYTRACING
     #define VULKAN_ENABLE_RAYTRACING 1
 #endif
+// Number of threads that can record command encoders at the same time, at most 64. Every one of them 
+// gets its own command pool per frame in flight, further threads fall back to a pool per command buffer.
+#ifndef WGVK_MAX_RECORDING_THREADS
+    #define WGVK_MAX_RECORDING_THREADS 16
+#endif
+// Number of ResourceUsage and command streams that released encoders and passes leave 
+// behind for reuse, the table capacity above which a ResourceUsage is freed instead,
+// and the size in bytes above which a command stream is freed instead.
+#ifndef WGVK_CONTAINER_CACHE_SIZE
+    #define WGVK_CONTAINER_CACHE_SIZE 64
+#endif
+#ifndef WGVK_CONTAINER_CACHE_MAX_CAPACITY
+    #define WGVK_CONTAINER_CACHE_MAX_CAPACITY 4096
+#endif
+#ifndef WGVK_CONTAINER_CACHE_MAX_STREAM_BYTES
+    #define WGVK_CONTAINER_CACHE_MAX_STREAM_BYTES (1 << 20)
+#endif
+// Render bundles are recorded once into secondary command buffers (one per distinct viewport, scissor,
+// blend constant and stencil reference they are executed with) on devices supporting VK_KHR_maintenance7,
+// and replayed inline otherwise. WGVK_RENDERBUNDLE_CACHE_SIZE bounds the secondaries kept per bundle.
+#ifndef RENDERBUNDLES_AS_SECONDARY_COMMANDBUFFERS
+    #define RENDERBUNDLES_AS_SECONDARY_COMMANDBUFFERS 1
+#endif
+#ifndef WGVK_RENDERBUNDLE_CACHE_SIZE
+    #define WGVK_RENDERBUNDLE_CACHE_SIZE 8
+#endif
+// GPU timestamp profiling (WGPUDeviceTimestampProfiling): scopes per command encoder when the descriptor
+// doesn't ask for a number, and how many recent samples per label the statistics are computed over.
+#ifndef WGVK_TIMESTAMP_DEFAULT_SCOPES
+    #define WGVK_TIMESTAMP_DEFAULT_SCOPES 256
+#endif
+#ifndef WGVK_TIMESTAMP_STATISTICS_WINDOW
+    #define WGVK_TIMESTAMP_STATISTICS_WINDOW 128
+#endif
+// Views a texture keeps cached after their last reference is gone, the least recently used ones are destroyed beyond that
+#ifndef WGVK_TEXTURE_VIEW_CACHE_SIZE
+    #define WGVK_TEXTURE_VIEW_CACHE_SIZE 32
+#endif
+// Textures only usable as multisampled or depth/stencil render attachments are created transient, in lazily allocated memory where available
+#ifndef WGVK_IMPLICIT_TRANSIENT_ATTACHMENTS
+    #define WGVK_IMPLICIT_TRANSIENT_ATTACHMENTS 1
+#endif
+// Vectorized texel conversion and row repacking of texture uploads, x86 kernels are selected by cpuid at runtime
+#ifndef WGVK_SIMD_TEXEL_CONVERSION
+    #define WGVK_SIMD_TEXEL_CONVERSION 1
+#endif
+// Number of recent frames the surface pacing statistics (wgpuSurfaceGetPacingStatistics) are computed over
+#ifndef WGVK_PACING_STATISTICS_WINDOW
+    #define WGVK_PACING_STATISTICS_WINDOW 128
+#endif
 #if !defined(RL_MALLOC) && !defined(RL_CALLOC) && !defined(RL_REALLOC) && !defined(RL_FREE)
 #define RL_MALLOC  malloc
 #define RL_CALLOC  calloc
@@ -116,6 +116,13 @@ int  wgvk_thread_join  (wgvk_thread_t* thread, void** result);
 int  wgvk_thread_detach(wgvk_thread_t* thread);
 void wgvk_thread_yield (void);
 
+/**
+ * @brief Small index of the calling thread, assigned on first use and given back when the thread exits.
+ * @return A value in [0, WGVK_MAX_RECORDING_THREADS), or WGVK_OVERFLOW_THREAD_SLOT while all of them are held by live threads
+ */
+uint32_t wgvk_thread_slot(void);
+#define WGVK_OVERFLOW_THREAD_SLOT WGVK_MAX_RECORDING_THREADS
+
 /* lock backend selection */
 typedef enum wgvk_locktype{
     wgvk_locktype_kernel = 0,
@@ -859,6 +866,16 @@ void wgvk_job_destroy(wgvk_job_t* job);
         Name##_init(set);                                                                                                        \
     }                                                                                                                            \
                                                                                                                                  \
+    SCOPE void Name##_clear(Name *set) {                                                                                         \
+        set->current_size = 0;                                                                                                   \
+        set->has_null_element = false;                                                                                           \
+        if (set->table != NULL && set->current_capacity > 0) {                                                                   \
+            for (uint64_t i = 0; i < set->current_capacity; ++i) {                                                               \
+                set->table[i] = (Type)PHM_EMPTY_SLOT_KEY;                                                                        \
+            }                                                                                                                    \
+        }                                                                                                                        \
+    }                                                                                                                            \
+                                                                                                                                 \
     SCOPE void Name##_move(Name *dest, Name *source) {                                                                           \
         if (dest == source) {                                                                                                    \
             return;                                                                                                              \
@@ -1475,6 +1492,7 @@ typedef enum RCPassCommandType{
     rp_command_type_insert_debug_marker,
     rp_command_type_multi_draw_indexed_indirect,
     rp_command_type_multi_draw_indirect,
+    rp_command_type_set_immediate_data,
     rp_command_type_enum_count,
     rt_command_type_trace_rays,
     rp_command_type_set_force32 = 0x7fffffff
@@ -1527,6 +1545,12 @@ typedef struct RenderPassCommandExecuteRenderbundles{
     WGPURenderBundle renderBundle;
 }RenderPassCommandExecuteRenderbundles;
 
+typedef struct RenderPassCommandSetImmediateData{
+    uint32_t offset;
+    uint32_t size;
+    const void* data;
+}RenderPassCommandSetImmediateData;
+
 typedef struct ComputePassCommandSetPipeline {
     WGPUComputePipeline pipeline;
 } ComputePassCommandSetPipeline;
@@ -1647,6 +1671,7 @@ typedef struct RenderPassCommandGeneric {
         RenderPassCommandEndOcclusionQuery endOcclusionQuery;
         RenderPassCommandInsertDebugMarker insertDebugMarker;
         RenderPassCommandMultiDrawIndirect multiDrawIndirect;
+        RenderPassCommandSetImmediateData setImmediateData;
         ComputePassCommandSetPipeline setComputePipeline;
         ComputePassCommandDispatchWorkgroups dispatchWorkgroups;
         ComputePassCommandDispatchWorkgroupsIndirect dispatchWorkgroupsIndirect;
@@ -1654,6 +1679,160 @@ typedef struct RenderPassCommandGeneric {
     };
 }RenderPassCommandGeneric;
 
+/**
+ * @brief Packed, variable-length storage for buffered pass and bundle commands
+ * @details Each record is a RenderPassCommandHeader followed by only the bytes of its own union member,
+ * padded to 4 bytes, so a draw takes 20 bytes instead of sizeof(RenderPassCommandGeneric).
+ * The dynamic offsets of a set_bind_group and the bytes of a set_immediate_data are stored inline behind them.
+ * Read back with RenderPassCommandStreamReader.
+ */
+typedef struct RenderPassCommandHeader{
+    uint16_t type;
+    uint16_t size; // Of the whole record in bytes, header included
+}RenderPassCommandHeader;
+
+typedef struct RenderPassCommandStream{
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    size_t count;
+}RenderPassCommandStream;
+
+typedef struct RenderPassCommandStreamReader{
+    const uint8_t* cursor;
+    const uint8_t* end;
+    RenderPassCommandGeneric current;
+}RenderPassCommandStreamReader;
+
+static inline size_t RenderPassCommand_payloadSize(RCPassCommandType type){
+    switch(type){
+        case rp_command_type_draw:                          return sizeof(RenderPassCommandDraw);
+        case rp_command_type_draw_indexed:                  return sizeof(RenderPassCommandDrawIndexed);
+        case rp_command_type_draw_indexed_indirect:         return sizeof(RenderPassCommandDrawIndexedIndirect);
+        case rp_command_type_draw_indirect:                 return sizeof(RenderPassCommandDrawIndirect);
+        case rp_command_type_set_stencil_reference:         return sizeof(RenderPassCommandSetStencilReference);
+        case rp_command_type_set_blend_constant:            return sizeof(RenderPassCommandSetBlendConstant);
+        case rp_command_type_set_viewport:                  return sizeof(RenderPassCommandSetViewport);
+        case rp_command_type_set_scissor_rect:              return sizeof(RenderPassCommandSetScissorRect);
+        case rp_command_type_set_vertex_buffer:             return sizeof(RenderPassCommandSetVertexBuffer);
+        case rp_command_type_set_index_buffer:              return sizeof(RenderPassCommandSetIndexBuffer);
+        case rp_command_type_set_bind_group:                return sizeof(RenderPassCommandSetBindGroup);
+        case rp_command_type_set_render_pipeline:           return sizeof(RenderPassCommandSetPipeline);
+        case rp_command_type_execute_renderbundle:          return sizeof(RenderPassCommandExecuteRenderbundles);
+        case cp_command_type_set_compute_pipeline:          return sizeof(ComputePassCommandSetPipeline);
+        case rp_command_type_set_raytracing_pipeline:       return sizeof(RenderPassCommandSetRaytracingPipeline);
+        case cp_command_type_dispatch_workgroups:           return sizeof(ComputePassCommandDispatchWorkgroups);
+        case cp_command_type_dispatch_workgroups_indirect:  return sizeof(ComputePassCommandDispatchWorkgroupsIndirect);
+        case rp_command_type_begin_occlusion_query:         return sizeof(RenderPassCommandBeginOcclusionQuery);
+        case rp_command_type_end_occlusion_query:           return 0;
+        case rp_command_type_insert_debug_marker:           return sizeof(RenderPassCommandInsertDebugMarker);
+        case rp_command_type_multi_draw_indexed_indirect:   return sizeof(RenderPassCommandMultiDrawIndexedIndirect);
+        case rp_command_type_multi_draw_indirect:           return sizeof(RenderPassCommandMultiDrawIndirect);
+        case rp_command_type_set_immediate_data:            return sizeof(RenderPassCommandSetImmediateData);
+        case rt_command_type_trace_rays:                    return sizeof(RaytracingPassCommandTraceRays);
+        default: return sizeof(RenderPassCommandGeneric) - offsetof(RenderPassCommandGeneric, draw);
+    }
+}
+
+static inline void RenderPassCommandStream_init(RenderPassCommandStream* stream){
+    stream->data = NULL;
+    stream->size = 0;
+    stream->capacity = 0;
+    stream->count = 0;
+}
+
+static inline void RenderPassCommandStream_free(RenderPassCommandStream* stream){
+    RL_FREE(stream->data);
+    RenderPassCommandStream_init(stream);
+}
+
+static inline void RenderPassCommandStream_clear(RenderPassCommandStream* stream){
+    stream->size = 0;
+    stream->count = 0;
+}
+
+static inline void RenderPassCommandStream_move(RenderPassCommandStream* dest, RenderPassCommandStream* source){
+    if(dest == source)return;
+    RL_FREE(dest->data);
+    *dest = *source;
+    RenderPassCommandStream_init(source);
+}
+
+#define RENDER_PASS_COMMAND_STREAM_OUT_OF_MEMORY -1
+#define RENDER_PASS_COMMAND_STREAM_RECORD_TOO_LARGE -2
+
+/**
+ * @brief Appends cmd to the stream. The dynamic offsets of set_bind_group and the data of set_immediate_data are copied as well
+ * @return 0 on success, RENDER_PASS_COMMAND_STREAM_OUT_OF_MEMORY if growing the stream failed or 
+ * RENDER_PASS_COMMAND_STREAM_RECORD_TOO_LARGE if the record doesn't fit its 16 bit size field
+ */
+static inline int RenderPassCommandStream_push(RenderPassCommandStream* stream, const RenderPassCommandGeneric* cmd){
+    const size_t payloadSize = RenderPassCommand_payloadSize(cmd->type);
+    size_t offsetBytes = 0;
+    const void* inlineData = NULL;
+    if(cmd->type == rp_command_type_set_bind_group){
+        offsetBytes = cmd->setBindGroup.dynamicOffsetCount * sizeof(uint32_t);
+        inlineData = cmd->setBindGroup.dynamicOffsets;
+    }
+    else if(cmd->type == rp_command_type_set_immediate_data){
+        offsetBytes = cmd->setImmediateData.size;
+        inlineData = cmd->setImmediateData.data;
+    }
+    const size_t recordSize = (sizeof(RenderPassCommandHeader) + payloadSize + offsetBytes + 3) & ~(size_t)3;
+    if(recordSize > UINT16_MAX)return RENDER_PASS_COMMAND_STREAM_RECORD_TOO_LARGE;
+    if(stream->size + recordSize > stream->capacity){
+        size_t newCapacity = stream->capacity ? stream->capacity * 2 : 512;
+        while(newCapacity < stream->size + recordSize)newCapacity *= 2;
+        uint8_t* newData = (uint8_t*)RL_REALLOC(stream->data, newCapacity);
+        if(!newData)return RENDER_PASS_COMMAND_STREAM_OUT_OF_MEMORY;
+        stream->data = newData;
+        stream->capacity = newCapacity;
+    }
+    uint8_t* record = stream->data + stream->size;
+    const RenderPassCommandHeader header = {
+        .type = (uint16_t)cmd->type,
+        .size = (uint16_t)recordSize,
+    };
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), &cmd->draw, payloadSize);
+    if(offsetBytes){
+        memcpy(record + sizeof(header) + payloadSize, inlineData, offsetBytes);
+    }
+    stream->size += recordSize;
+    stream->count++;
+    return 0;
+}
+
+static inline RenderPassCommandStreamReader RenderPassCommandStream_read(const RenderPassCommandStream* stream){
+    RenderPassCommandStreamReader reader = {
+        .cursor = stream->data,
+        .end = stream->data + stream->size,
+    };
+    return reader;
+}
+
+/**
+ * @brief Decodes the next command of the stream
+ * @return Pointer to the decoded command, valid until the next call, or NULL at the end of the stream.
+ * Dynamic offsets of a decoded set_bind_group and the data of a set_immediate_data point into the stream itself.
+ */
+static inline const RenderPassCommandGeneric* RenderPassCommandStreamReader_next(RenderPassCommandStreamReader* reader){
+    if(reader->cursor >= reader->end)return NULL;
+    RenderPassCommandHeader header;
+    memcpy(&header, reader->cursor, sizeof(header));
+    const size_t payloadSize = RenderPassCommand_payloadSize((RCPassCommandType)header.type);
+    reader->current.type = (RCPassCommandType)header.type;
+    memcpy(&reader->current.draw, reader->cursor + sizeof(header), payloadSize);
+    if(reader->current.type == rp_command_type_set_bind_group){
+        reader->current.setBindGroup.dynamicOffsets = reader->current.setBindGroup.dynamicOffsetCount ? (const uint32_t*)(reader->cursor + sizeof(header) + payloadSize) : NULL;
+    }
+    else if(reader->current.type == rp_command_type_set_immediate_data){
+        reader->current.setImmediateData.data = reader->cursor + sizeof(header) + payloadSize;
+    }
+    reader->cursor += header.size;
+    return &reader->current;
+}
+
 #define CONTAINERAPI static inline
 DEFINE_PTR_HASH_MAP (CONTAINERAPI, BufferUsageRecordMap, BufferUsageRecord)
 //DEFINE_PTR_HASH_MAP (CONTAINERAPI, ImageViewUsageRecordMap, ImageViewUsageRecord)
@@ -1678,7 +1857,6 @@ DEFINE_VECTOR (CONTAINERAPI, VkWriteDescriptorSet, VkWriteDescriptorSetVector)
 DEFINE_VECTOR (CONTAINERAPI, WGPUFence, WGPUFenceVector)
 DEFINE_VECTOR (CONTAINERAPI, VkFence, VkFenceVector)
 DEFINE_VECTOR (CONTAINERAPI, VkCommandBuffer, VkCommandBufferVector)
-DEFINE_VECTOR (CONTAINERAPI, RenderPassCommandGeneric, RenderPassCommandGenericVector)
 DEFINE_VECTOR (CONTAINERAPI, VkSemaphore, VkSemaphoreVector)
 DEFINE_VECTOR (CONTAINERAPI, WGPUCommandBuffer, WGPUCommandBufferVector)
 DEFINE_VECTOR (CONTAINERAPI, WGPUCommandEncoder, WGPUCommandEncoderVector)
@@ -1689,6 +1867,23 @@ DEFINE_VECTOR (CONTAINERAPI, VkDescriptorSetLayoutBinding, VkDescriptorSetLayout
 
 DEFINE_PTR_HASH_MAP(CONTAINERAPI, PendingCommandBufferMap, WGPUCommandBufferVector);
 
+// Lazy zero-initialization of one buffer as seen by one command encoder, applied to the buffer when submitted.
+// wgpuQueueSubmit replaces written by the chunks it marked initialized, which are unmarked again if the submit fails
+typedef struct BufferChunkInit{
+    uint64_t zero;    // Chunks read before the encoder wrote them, zeroed ahead of the command buffer unless initialized by then
+    uint64_t written; // Chunks the encoder overwrites entirely
+}BufferChunkInit;
+DEFINE_PTR_HASH_MAP(CONTAINERAPI, BufferChunkInitMap, BufferChunkInit);
+
+// The same for the subresources of one texture, each member is a bitset laid out like WGPUTextureImpl::initializedSubresources.
+// wgpuQueueSubmit replaces written and discarded by the bits it actually set and cleared, to revert them if the submit fails
+typedef struct TextureSubresourceInit{
+    uint64_t* zero;      // Read before the encoder wrote them
+    uint64_t* written;   // Left initialized by the encoder
+    uint64_t* discarded; // Left uninitialized by the encoder, by render passes storing with WGPUStoreOp_Discard
+}TextureSubresourceInit;
+DEFINE_PTR_HASH_MAP(CONTAINERAPI, TextureSubresourceInitMap, TextureSubresourceInit);
+
 typedef struct DescriptorSetAndPool{
     VkDescriptorPool pool;
     VkDescriptorSet set;
@@ -1734,6 +1929,8 @@ static inline void ResourceUsage_free(ResourceUsage* ru){
     BindGroupUsageSet_free(&ru->referencedBindGroups);
     BindGroupLayoutUsageSet_free(&ru->referencedBindGroupLayouts);
     SamplerUsageSet_free(&ru->referencedSamplers);
+    RenderPipelineUsageSet_free(&ru->referencedRenderPipelines);
+    ComputePipelineUsageSet_free(&ru->referencedComputePipelines);
     QuerySetUsageSet_free(&ru->referencedQuerySets);
     RenderBundleUsageSet_free(&ru->referencedRenderBundles);
 }
@@ -1745,8 +1942,10 @@ static inline void ResourceUsage_move(ResourceUsage* dest, ResourceUsage* source
     BindGroupUsageSet_move(&dest->referencedBindGroups, &source->referencedBindGroups);
     BindGroupLayoutUsageSet_move(&dest->referencedBindGroupLayouts, &source->referencedBindGroupLayouts);
     SamplerUsageSet_move(&dest->referencedSamplers, &source->referencedSamplers);
-    QuerySetUsageSet_free(&dest->referencedQuerySets);
-    RenderBundleUsageSet_free(&dest->referencedRenderBundles);
+    RenderPipelineUsageSet_move(&dest->referencedRenderPipelines, &source->referencedRenderPipelines);
+    ComputePipelineUsageSet_move(&dest->referencedComputePipelines, &source->referencedComputePipelines);
+    QuerySetUsageSet_move(&dest->referencedQuerySets, &source->referencedQuerySets);
+    RenderBundleUsageSet_move(&dest->referencedRenderBundles, &source->referencedRenderBundles);
     //LayoutAssumptions_move(&dest->entryAndFinalLayouts, &source->entryAndFinalLayouts);
 }
 
@@ -1762,6 +1961,22 @@ static inline void ResourceUsage_init(ResourceUsage* ru){
     //LayoutAssumptions_init(&ru->entryAndFinalLayouts);
 }
 
+/**
+ * @brief Empties every container of ru but keeps their tables allocated for reuse
+ */
+static inline void ResourceUsage_clear(ResourceUsage* ru){
+    BufferUsageRecordMap_clear(&ru->referencedBuffers);
+    ImageUsageRecordMap_clear(&ru->referencedTextures);
+    ImageViewUsageSet_clear(&ru->referencedTextureViews);
+    BindGroupUsageSet_clear(&ru->referencedBindGroups);
+    BindGroupLayoutUsageSet_clear(&ru->referencedBindGroupLayouts);
+    SamplerUsageSet_clear(&ru->referencedSamplers);
+    RenderPipelineUsageSet_clear(&ru->referencedRenderPipelines);
+    ComputePipelineUsageSet_clear(&ru->referencedComputePipelines);
+    RenderBundleUsageSet_clear(&ru->referencedRenderBundles);
+    QuerySetUsageSet_clear(&ru->referencedQuerySets);
+}
+
 RGAPI void ru_registerTransition        (ResourceUsage* resourceUsage, WGPUTexture tex, VkImageLayout from, VkImageLayout to);
 RGAPI void ru_trackBuffer               (ResourceUsage* resourceUsage, WGPUBuffer buffer, BufferUsageRecord brecord);
 RGAPI void ru_trackTexture              (ResourceUsage* resourceUsage, WGPUTexture texture, ImageUsageRecord newRecord);
@@ -1779,6 +1994,26 @@ RGAPI void ce_trackBuffer               (WGPUCommandEncoder encoder, WGPUBuffer
 RGAPI void ce_trackTexture              (WGPUCommandEncoder encoder, WGPUTexture texture, ImageUsageSnap usage);
 RGAPI void ce_trackTextureView          (WGPUCommandEncoder encoder, WGPUTextureView view, ImageUsageSnap usage);
 
+#define BARRIER_BATCH_CAPACITY 16
+/**
+ * @brief Barriers of several ce_track*Batched calls, recorded with a single vkCmdPipelineBarrier by ce_flushBarriers
+ * @details Stages of all barriers are merged, which is only a good trade for resources used at the same point (e.g. the attachments of a pass).
+ */
+typedef struct BarrierBatch{
+    VkPipelineStageFlags srcStage;
+    VkPipelineStageFlags dstStage;
+    VkMemoryBarrier memoryBarrier;
+    uint32_t memoryBarrierCount;
+    uint32_t bufferBarrierCount;
+    uint32_t imageBarrierCount;
+    VkBufferMemoryBarrier bufferBarriers[BARRIER_BATCH_CAPACITY];
+    VkImageMemoryBarrier imageBarriers[BARRIER_BATCH_CAPACITY];
+}BarrierBatch;
+
+RGAPI void ce_trackBufferBatched        (WGPUCommandEncoder encoder, BarrierBatch* batch, WGPUBuffer buffer, BufferUsageSnap usage);
+RGAPI void ce_trackTextureViewBatched   (WGPUCommandEncoder encoder, BarrierBatch* batch, WGPUTextureView view, ImageUsageSnap usage);
+RGAPI void ce_flushBarriers             (WGPUCommandEncoder encoder, BarrierBatch* batch);
+
 RGAPI WGPUBool32 ru_containsBuffer          (const ResourceUsage* resourceUsage, WGPUBuffer buffer);
 RGAPI WGPUBool32 ru_containsTexture         (const ResourceUsage* resourceUsage, WGPUTexture texture);
 RGAPI WGPUBool32 ru_containsTextureView     (const ResourceUsage* resourceUsage, WGPUTextureView view);
@@ -1786,10 +2021,10 @@ RGAPI WGPUBool32 ru_containsBindGroup       (const ResourceUsage* resourceUsage,
 RGAPI WGPUBool32 ru_containsBindGroupLayout (const ResourceUsage* resourceUsage, WGPUBindGroupLayout bindGroupLayout);
 RGAPI WGPUBool32 ru_containsSampler         (const ResourceUsage* resourceUsage, WGPUSampler bindGroup);
 
+RGAPI void releaseAllReferences(ResourceUsage* resourceUsage);
 RGAPI void releaseAllAndClear(ResourceUsage* resourceUsage);
 
 typedef struct SyncState{
-    VkSemaphoreVector semaphores;
     VkSemaphore acquireImageSemaphore;
     bool acquireImageSemaphoreSignalled;
     uint32_t submits;
@@ -1942,14 +2177,96 @@ static size_t renderPassLayoutHash(RenderPassLayout layout){
 }
 
 
+/**
+ * @brief Command pool of one recording thread within one frame in flight
+ * @details The pool is pinned to the buffer that is being recorded from it, which may then be recorded on any thread. 
+ * While pinned, every other recording (even one of the owning thread) takes a buffer of the overflow pool instead, 
+ * so no locks are needed. Buffers are never freed individually: the whole pool is reset once its frame 
+ * retired and every buffer handed out from it has been released again.
+ */
+typedef struct ThreadCommandPool{
+    VkCommandPool pool;
+    VkCommandBufferVector buffers; // Every buffer ever allocated from pool
+    uint32_t nextFree;             // buffers[0, nextFree) were handed out since the last reset
+    Atomar(uint32_t) outstanding;  // Handed out and not released yet, plus THREAD_COMMAND_POOL_RESETTING while a reset runs
+    Atomar(uint32_t) pinned;       // Nonzero while a buffer of the pool is being recorded
+}ThreadCommandPool;
+#define THREAD_COMMAND_POOL_RESETTING 0x80000000u
+
+typedef struct PooledCommandBuffer{
+    VkCommandPool pool; // Holds buffer and nothing else
+    VkCommandBuffer buffer;
+}PooledCommandBuffer;
+DEFINE_VECTOR(static inline, PooledCommandBuffer, PooledCommandBufferVector)
+
+/**
+ * @brief Command buffers of the threads that got WGVK_OVERFLOW_THREAD_SLOT, or whose pool was pinned already
+ * @details Several threads share it, so every buffer comes with a pool of its own and recording into it needs no 
+ * synchronization. The mutex only guards handing buffers out and resetting them.
+ */
+typedef struct OverflowCommandPool{
+    wgvk_mutex_t* mutex;
+    PooledCommandBufferVector buffers;
+    uint32_t nextFree;
+    uint32_t outstanding;
+}OverflowCommandPool;
+
+#define WGVK_TIMESTAMP_LABEL_LENGTH 48
+#define WGVK_MAX_DEBUG_GROUP_DEPTH 16
+#define WGVK_NO_TIMESTAMP_SCOPE UINT32_MAX
+
+/**
+ * @brief Profiled GPU scopes of one command encoder, see WGPUDeviceTimestampProfiling
+ * @details Scope i owns queries 2i (begin) and 2i + 1 (end). scopeCount counts handed out scopes and may 
+ * exceed the capacity, the excess is simply not timed. The encoder takes a query pool from the device with its 
+ * first scope, wgpuQueueSubmit attaches it to the frame it submits in, which collects and returns it once retired.
+ */
+typedef struct TimestampScopes{
+    VkQueryPool queryPool; // VK_NULL_HANDLE until the first scope
+    uint32_t scopeCount;
+    char (*labels)[WGVK_TIMESTAMP_LABEL_LENGTH];
+}TimestampScopes;
+DEFINE_VECTOR(static inline, TimestampScopes, TimestampScopesVector)
+
+// What wgpuBindGroupWriteSlot last wrote to one array element and holds a reference to, all NULL while the element is empty
+typedef struct BindGroupSlotContent{
+    WGPUBuffer buffer;
+    uint64_t offset;
+    uint64_t size;
+    WGPUTextureView textureView;
+    WGPUSampler sampler;
+}BindGroupSlotContent;
+DEFINE_VECTOR(static inline, BindGroupSlotContent, BindGroupSlotContentVector)
+
+/**
+ * @brief A swapchain replaced by wgpuSurfaceConfigure, waiting for the frame that last used it to retire
+ * @details The swapchain was passed as oldSwapchain to its successor. It is destroyed together with its 
+ * present semaphores and surface textures once the fences of the owning PerframeCache have been waited on.
+ * Virtual surfaces retire their offscreen textures the same way with a null swapchain and no semaphores.
+ */
+typedef struct RetiredSwapchain{
+    VkSwapchainKHR swapchain;
+    uint32_t imageCount;
+    WGPUTexture* images;
+    VkSemaphore* presentSemaphores;
+}RetiredSwapchain;
+DEFINE_VECTOR(static inline, RetiredSwapchain, RetiredSwapchainVector)
+
 typedef struct PerframeCache{
+    // Pool for the buffers recorded by the queue itself (barriers, final transitions)
     VkCommandPool commandPool;
-    VkCommandBufferVector commandBuffers;
+    ThreadCommandPool threadPools[WGVK_MAX_RECORDING_THREADS];
+    OverflowCommandPool overflowPool;
     VkCommandBufferVector secondaryCommandBuffers;
 
     WGPUBufferVector unusedBatchBuffers;
     WGPUBufferVector usedBatchBuffers;
     
+    // Primary command buffers holding the compatibility barriers recorded by wgpuQueueSubmit.
+    // They are handed out in order and rewound once the frame has retired.
+    VkCommandBufferVector transitionBuffers;
+    uint32_t transitionBuffersUsed;
+
     VkCommandBuffer finalTransitionBuffer;
     VkSemaphore finalTransitionSemaphore;
     WGPUFence finalTransitionFence;
@@ -1959,6 +2276,9 @@ typedef struct PerframeCache{
     //std::unordered_map<WGPUBindGroupLayout, std::vector<std::pair<VkDescriptorPool, VkDescriptorSet>>> bindGroupCache;
     BindGroupCacheMap bindGroupCache;
     VkFenceVector reusableFences;
+    TimestampScopesVector timestamps; // Of the command buffers submitted in this frame
+    RetiredSwapchainVector retiredSwapchains;
+    BindGroupSlotContentVector retiredSlotContents; // Overwritten or freed bind group slots this frame may still read
 }PerframeCache;
 
 typedef struct QueueIndices{
@@ -2018,6 +2338,23 @@ typedef struct PendingCommandBufferListRef{
     PendingCommandBufferMap* map;
 }PendingCommandBufferListRef;
 
+typedef struct BindGroupBufferUsage{
+    WGPUBuffer buffer;
+    BufferUsageSnap usage;
+}BindGroupBufferUsage;
+
+// Stable element allocator of one array binding of a bind group, see wgpuBindGroupAllocateSlot
+typedef struct BindGroupSlotAllocator{
+    uint32_t binding;
+    uint32_t layoutIndex;
+    uint32_t arraySize;
+    uint32_t highWater;  // Elements [highWater, arraySize) were never handed out
+    uint32_t freeCount;
+    uint32_t* freeSlots; // LIFO of freed elements, allocated on the first free
+    BindGroupSlotContent* contents; // One per element, allocated on the first write
+    uint32_t contentEnd;            // Elements [contentEnd, arraySize) were never written
+}BindGroupSlotAllocator;
+
 typedef struct WGPUBindGroupImpl{
     VkDescriptorSet set;
     VkDescriptorPool pool;
@@ -2028,6 +2365,16 @@ typedef struct WGPUBindGroupImpl{
     uint32_t cacheIndex;
     WGPUBindGroupEntry* entries;
     uint32_t entryCount;
+
+    // Buffer usages of this group as seen by a dispatch, computed once when the group is written.
+    // Elements written with wgpuBindGroupWriteSlot live in slotAllocators instead
+    BindGroupBufferUsage* bufferUsages;
+    uint32_t bufferUsageCount;
+    WGPUBool writesBuffers;
+
+    // One per array binding of the layout, NULL if there are none
+    BindGroupSlotAllocator* slotAllocators;
+    uint32_t slotAllocatorCount;
 }WGPUBindGroupImpl;
 
 typedef struct WGPUBindGroupLayoutImpl{
@@ -2035,6 +2382,8 @@ typedef struct WGPUBindGroupLayoutImpl{
     WGPUDevice device;
     WGPUBindGroupLayoutEntry* entries;
     uint32_t entryCount;
+    uint32_t* arraySizes;     // Descriptor count per entry, 1 unless a WGPUBindGroupLayoutEntryArraySize was chained
+    WGPUBool updateAfterBind; // Layout and pools need the UPDATE_AFTER_BIND flags
 
     refcount_type refCount;
 }WGPUBindGroupLayoutImpl;
@@ -2044,6 +2393,7 @@ typedef struct WGPUPipelineLayoutImpl{
     WGPUDevice device;
     WGPUBindGroupLayout* bindGroupLayouts;
     uint32_t bindGroupLayoutCount;
+    uint32_t immediateDataSize; // Push constant range [0, immediateDataSize) for VK_SHADER_STAGE_ALL
     refcount_type refCount;
 }WGPUPipelineLayoutImpl;
 
@@ -2072,6 +2422,10 @@ typedef struct WGPUBufferImpl{
     VkDeviceAddress address; //uint64_t, if applicable (BufferUsage_ShaderDeviceAddress)
     refcount_type refCount;
     WGPUFence latestFence;
+    // Lazy zero-initialization: bit i of initializedChunks covers bytes [i * zeroInitChunkSize, (i + 1) * zeroInitChunkSize)
+    // and is set once the chunk was written or zeroed on the host, or by a submitted command buffer
+    uint64_t zeroInitChunkSize;
+    Atomar(uint64_t) initializedChunks;
 }WGPUBufferImpl;
 
 typedef struct WGPURayTracingShaderBindingTableImpl{
@@ -2167,6 +2521,18 @@ typedef struct WGVKCapabilities{
     WGPUBool dynamicRendering;
     WGPUBool depthClipEnable;
     WGPUBool depthClipControl;
+    WGPUBool synchronization2;
+    WGPUBool multiDrawIndirect;
+    WGPUBool drawIndirectCount;
+    uint32_t maxDrawIndirectCount; // VkPhysicalDeviceLimits::maxDrawIndirectCount, bounds every multi draw call
+    WGPUBool secondaryRenderBundles;
+    WGPUBool inheritedQueries; // Render bundle secondaries may execute inside an occlusion query
+    WGPUBool bindless; // Partially bound runtime descriptor arrays
+    WGPUBool updateAfterBindSampledImage;
+    WGPUBool updateAfterBindStorageImage;
+    WGPUBool updateAfterBindUniformBuffer;
+    WGPUBool updateAfterBindStorageBuffer;
+    WGPUBool presentWait; // VK_KHR_present_id and VK_KHR_present_wait
 }WGVKCapabilities;
 
 typedef struct FIFCache{
@@ -2175,6 +2541,36 @@ typedef struct FIFCache{
     WGPUFence topFence;
 }FIFCache;
 
+DEFINE_VECTOR(static inline, ResourceUsage, ResourceUsageVector)
+DEFINE_VECTOR(static inline, RenderPassCommandStream, RenderPassCommandStreamVector)
+
+/**
+ * @brief Containers of finished encoders and passes, kept with their storage so the next ones don't allocate
+ * @details Encoders, passes and command buffers are released from arbitrary threads, hence the lock.
+ */
+typedef struct ContainerCache{
+    wgvk_mutex_t* mutex;
+    ResourceUsageVector resourceUsages;
+    RenderPassCommandStreamVector commandStreams;
+}ContainerCache;
+
+// Most recent GPU times of one scope label, a ring of WGVK_TIMESTAMP_STATISTICS_WINDOW samples
+typedef struct TimestampLabelStatistics{
+    char label[WGVK_TIMESTAMP_LABEL_LENGTH];
+    double milliseconds[WGVK_TIMESTAMP_STATISTICS_WINDOW];
+    uint32_t nextSample;
+    uint32_t sampleCount;
+}TimestampLabelStatistics;
+DEFINE_VECTOR(static inline, TimestampLabelStatistics, TimestampLabelStatisticsVector)
+
+// Compute downsample of wgpuCommandEncoderGenerateMipmaps for one storage format that can't be blitted linearly
+typedef struct MipmapPipeline{
+    WGPUTextureFormat format;
+    WGPUBindGroupLayout bindGroupLayout;
+    WGPUComputePipeline pipeline;
+}MipmapPipeline;
+DEFINE_VECTOR(static inline, MipmapPipeline, MipmapPipelineVector)
+
 typedef struct WGPUDeviceImpl{
     VkDevice device;
     refcount_type refCount;
@@ -2192,10 +2588,25 @@ typedef struct WGPUDeviceImpl{
     VmaPool aligned_hostVisiblePool;
     FIFCache fifCache;
     VkCommandPool secondaryCommandPool;
+    wgvk_mutex_t* secondaryCommandPoolMutex; // Guards secondaryCommandPool and the render bundles' encodedCommandBuffers
     RenderPassCache renderPassCache;
     WGPUUncapturedErrorCallbackInfo uncapturedErrorCallbackInfo;
     FenceCache fenceCache;
+    ContainerCache containerCache;
     wgvk_thread_pool_t* thread_pool;
+    WGPUBool parallelPassRecording;
+    uint32_t parallelPassMinCommands;
+    uint32_t timestampScopeCapacity; // Per command encoder, 0 if timestamp profiling is off
+    TimestampScopesVector freeTimestampScopes; // Collected query pools, guarded by timestampScopesMutex
+    wgvk_mutex_t* timestampScopesMutex;
+    float timestampPeriod;           // Nanoseconds per timestamp tick
+    TimestampLabelStatisticsVector timestampStatistics;
+    MipmapPipelineVector mipmapPipelines; // Created on first use, guarded by mipmapPipelineMutex
+    wgvk_mutex_t* mipmapPipelineMutex;
+    // Counted by every thread creating views, read by wgpuDeviceGetTextureViewCacheStatistics
+    Atomar(uint64_t) viewCacheHits;
+    Atomar(uint64_t) viewCacheMisses;
+    Atomar(uint64_t) viewCacheEvictions;
     struct VolkDeviceTable functions;
 }WGPUDeviceImpl;
 
@@ -2285,63 +2696,60 @@ typedef struct SlimViewCreateInfo{
     VkImageViewType viewType;
 }SlimViewCreateInfo;
 
+// 4 + 20 + 4 + 4 bytes without padding, so keys can be compared bytewise
+_Static_assert(sizeof(SlimViewCreateInfo) == 32, "SlimViewCreateInfo must not contain padding");
+
 static inline bool Compare_FormatAspectAndSR(SlimViewCreateInfo obj, SlimViewCreateInfo obj2){
-    return obj.format == obj2.format &&
-           obj.subresourceRange.baseMipLevel   == obj2.subresourceRange.baseMipLevel &&
-           obj.subresourceRange.levelCount     == obj2.subresourceRange.levelCount &&
-           obj.subresourceRange.baseArrayLayer == obj2.subresourceRange.baseArrayLayer &&
-           obj.subresourceRange.layerCount     == obj2.subresourceRange.layerCount &&
-           obj.subresourceRange.aspectMask     == obj2.subresourceRange.aspectMask &&
-           obj.viewType     == obj2.viewType &&
-           obj.cmap.r     == obj2.cmap.r &&
-           obj.cmap.g     == obj2.cmap.g &&
-           obj.cmap.b     == obj2.cmap.b &&
-           obj.cmap.a     == obj2.cmap.a;
-}
-
-#define FNV_oFFSET_BASIS 14695981039346656037ULL
-#define FNV_pRIME 1099511628211ULL
+    return memcmp(&obj, &obj2, sizeof(SlimViewCreateInfo)) == 0;
+}
 
+// Packs the key into two words and mixes them with the murmur3 finalizer.
+// Mip and layer fields are truncated to the ranges a texture can have, so distinct views of one texture never share a packed key
 static inline size_t Hash_FormatAspectAndSR(SlimViewCreateInfo obj){
-    size_t hash = FNV_oFFSET_BASIS;
-
-    // Hash the 'format' field
-    hash ^= (size_t)obj.format;
-    hash *= FNV_pRIME;
-
-    // Hash VkImageSubresourceRange members individually
-    hash ^= (size_t)obj.subresourceRange.baseMipLevel;
-    hash *= FNV_pRIME;
-
-    hash ^= (size_t)obj.subresourceRange.levelCount;
-    hash *= FNV_pRIME;
-
-    hash ^= (size_t)obj.subresourceRange.baseArrayLayer;
-    hash *= FNV_pRIME;
-
-    hash ^= (size_t)obj.subresourceRange.layerCount;
-    hash *= FNV_pRIME;
-
-    hash ^= (size_t)obj.subresourceRange.aspectMask; // Add aspectMask, it's in the comparison but was missing from hash
-    hash *= FNV_pRIME;
-
-    hash ^= (size_t)obj.viewType;
-    hash *= FNV_pRIME;
-
-    // Hash SlimComponentMapping members portably and efficiently.
-    // Combine the four uint8_t into a single uint32_t.
-    // This is explicitly defined and consistent across different endian systems.
-    uint32_t cmap_combined = (((uint32_t)obj.cmap.r)) |
-                             (((uint32_t)obj.cmap.g) << 8) |
-                             (((uint32_t)obj.cmap.b) << 16) |
-                             (((uint32_t)obj.cmap.a) << 24);
-    hash ^= (size_t)cmap_combined;
-    hash *= FNV_pRIME;
-
-    return hash;
+    const VkImageSubresourceRange sr = obj.subresourceRange;
+    uint64_t lo = (uint64_t)(uint32_t)obj.format |
+                  ((uint64_t)(obj.viewType & 0xFF) << 32) |
+                  ((uint64_t)(sr.aspectMask & 0xFFFFFF) << 40);
+    uint64_t hi = (uint64_t)(sr.baseMipLevel & 0xFF) |
+                  ((uint64_t)(sr.levelCount & 0xFF) << 8) |
+                  ((uint64_t)(sr.baseArrayLayer & 0xFFF) << 16) |
+                  ((uint64_t)(sr.layerCount & 0xFFF) << 28) |
+                  ((uint64_t)(obj.cmap.r & 0x7) << 40) |
+                  ((uint64_t)(obj.cmap.g & 0x7) << 43) |
+                  ((uint64_t)(obj.cmap.b & 0x7) << 46) |
+                  ((uint64_t)(obj.cmap.a & 0x7) << 49);
+    uint64_t x = (lo * 0x9E3779B97F4A7C15ULL) ^ hi;
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return (size_t)x;
 }
 
 DEFINE_GENERIC_HASH_MAP(static inline, Texture_ViewCache, SlimViewCreateInfo, WGPUTextureView, Hash_FormatAspectAndSR, Compare_FormatAspectAndSR, CLITERAL(SlimViewCreateInfo){VK_FORMAT_UNDEFINED});
+
+// Removes the entry in slot by shifting the rest of its probe sequence back, so lookups never need tombstones
+static inline void Texture_ViewCache_erase(Texture_ViewCache* map, Texture_ViewCache_kv_pair* slot){
+    const uint64_t capMask = map->current_capacity - 1;
+    uint64_t hole = (uint64_t)(slot - map->table);
+    uint64_t index = hole;
+    for(;;){
+        index = (index + 1) & capMask;
+        Texture_ViewCache_kv_pair* entry = map->table + index;
+        if(Compare_FormatAspectAndSR(entry->key, map->empty_key_sentinel)){
+            break;
+        }
+        uint64_t home = Texture_ViewCache_hash_key_internal(entry->key) & capMask;
+        // The entry may fill the hole only if the hole lies cyclically within [home, index)
+        if(((index - home) & capMask) >= ((index - hole) & capMask)){
+            map->table[hole] = *entry;
+            hole = index;
+        }
+    }
+    map->table[hole].key = map->empty_key_sentinel;
+    map->current_size--;
+}
 typedef struct WGPUTextureImpl{
     VkImage image;
     VkFormat format;
@@ -2355,6 +2763,12 @@ typedef struct WGPUTextureImpl{
     uint32_t mipLevels;
     uint32_t sampleCount;
     Texture_ViewCache viewCache;
+    uint64_t viewCacheClock;
+    uint32_t unreferencedViews; // Cached views with a refCount of 0, bounded by WGVK_TEXTURE_VIEW_CACHE_SIZE
+    // Lazy zero-initialization: bit (layer * mipLevels + level) is set once a submitted command buffer wrote or zeroed 
+    // the subresource. NULL for swapchain images, which are not tracked
+    Atomar(uint64_t)* initializedSubresources;
+    Atomar(uint32_t) uninitializedSubresourceCount;
 }WGPUTextureImpl;
 
 typedef struct WGPUShaderModuleSingleEntryPoint{
@@ -2401,6 +2815,7 @@ typedef struct WGPUTextureViewImpl{
     VkImageSubresourceRange subresourceRange;
     uint32_t width, height, depthOrArrayLayers;
     uint32_t sampleCount;
+    uint64_t lastUse; // Texture::viewCacheClock when last created, looked up or released
 }WGPUTextureViewImpl;
 
 typedef struct DefaultDynamicState{
@@ -2410,27 +2825,55 @@ typedef struct DefaultDynamicState{
     float blendConstants[4];
 }DefaultDynamicState;
 
+typedef struct BoundBindGroup{
+    WGPUBindGroup group;
+    VkPipelineBindPoint bindPoint;
+    uint32_t dynamicOffsetCount;
+    const uint32_t* dynamicOffsets; // Points into the replayed command stream
+}BoundBindGroup;
+
+/**
+ * @brief State bound during replay of one command stream, used to drop redundant binds
+ * @details Bind groups are bound lazily: set_bind_group only updates bindGroups and marks the slot in 
+ * dirtyBindGroups, the next draw, dispatch or trace rays binds the dirty slots against lastLayout.
+ */
 typedef struct CommandBufferAndSomeState{
     WGPUCommandEncoder cmdEncoder;
     VkCommandBuffer buffer;
     VkPipelineLayout lastLayout;
+    VkPipeline lastPipeline;
     WGPUDevice device;
     WGPUBuffer vertexBuffers[8];
+    uint64_t vertexBufferOffsets[8];
     WGPUBuffer indexBuffer;
+    uint64_t indexBufferOffset;
+    WGPUIndexFormat indexFormat;
     WGPUBindGroup graphicsBindGroups[8];
     WGPUBindGroup computeBindGroups[8];
+    BoundBindGroup bindGroups[8];
+    uint32_t dirtyBindGroups;
+    uint32_t untrackedComputeBindGroups; // Slots whose buffers the next dispatch has to track
+    WGPUBool viewportSet;
+    WGPUBool scissorSet;
     WGPURaytracingPipeline lastRaytracingPipeline;
     DefaultDynamicState dynamicState;
+    uint32_t lastImmediateDataSize; // Of lastLayout
+    uint32_t immediateDataSet;      // 4-byte words of immediateData set by the stream
+    uint32_t immediateDataPushed;   // Words whose value in immediateData has been pushed for lastLayout
+    uint8_t immediateData[WGVK_MAX_IMMEDIATE_DATA_SIZE];
+    WGPUBool occlusionQueryActive;
+    uint32_t occlusionQueryIndex;
 }CommandBufferAndSomeState;
 
 void recordVkCommand(CommandBufferAndSomeState* destination, const RenderPassCommandGeneric* command, const RenderPassCommandBegin *beginInfo);
-void recordVkCommands(WGPUCommandEncoder destination, WGPUDevice device, const RenderPassCommandGenericVector* commands, const RenderPassCommandBegin *beginInfo);
+void recordVkCommands(WGPUCommandEncoder destination, WGPUDevice device, const RenderPassCommandStream* commands, const RenderPassCommandBegin *beginInfo);
+void recordVkCommandsToBuffer(WGPUCommandEncoder encoder, VkCommandBuffer destination, WGPUDevice device, const RenderPassCommandStream* commands, const RenderPassCommandBegin *beginInfo);
 
 typedef struct WGPURenderPassEncoderImpl{
     VkRenderPass renderPass; //ONLY if !dynamicRendering
 
     RenderPassCommandBegin beginInfo;
-    RenderPassCommandGenericVector bufferedCommands;
+    RenderPassCommandStream bufferedCommands;
     
     WGPUDevice device;
     ResourceUsage resourceUsage;
@@ -2439,10 +2882,12 @@ typedef struct WGPURenderPassEncoderImpl{
     WGPUPipelineLayout lastLayout;
     VkFramebuffer frameBuffer;
     WGPUCommandEncoder cmdEncoder;
+    WGPUBool executesBundles;
+    uint32_t timestampScope; // WGVK_NO_TIMESTAMP_SCOPE unless the device profiles passes
 }WGPURenderPassEncoderImpl;
 
 typedef struct WGPUComputePassEncoderImpl{
-    RenderPassCommandGenericVector bufferedCommands;
+    RenderPassCommandStream bufferedCommands;
     WGPUDevice device;
     ResourceUsage resourceUsage;
     refcount_type refCount;
@@ -2450,48 +2895,56 @@ typedef struct WGPUComputePassEncoderImpl{
     WGPUPipelineLayout lastLayout;
     WGPUCommandEncoder cmdEncoder;
     WGPUBindGroup bindGroups[8];
+    WGPUBool timestampWritesPresent;
+    WGPUPassTimestampWrites timestampWrites;
+    uint32_t timestampScope;
 }WGPUComputePassEncoderImpl;
 
+static inline uint32_t DynamicState_floatBits(float f){
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+// Floats are hashed and compared by bit pattern, so the two always agree (0.5f and 0.7f used to collide, NaN never matched itself)
 static inline size_t hashDynamicState(DefaultDynamicState dst){
-    float accum = dst.viewport.x;
-    accum = accum * 1.79421351f + dst.blendConstants[0];
-    accum = accum * 1.79421351f + dst.blendConstants[1];
-    accum = accum * 1.79421351f + dst.blendConstants[2];
-    accum = accum * 1.79421351f + dst.blendConstants[3];
-    accum = accum * 1.19421351f + dst.viewport.y;
-    accum = accum * 1.19421351f + dst.viewport.width;
-    accum = accum * 1.19421351f + dst.viewport.height;
-    accum = accum * 1.19421351f + dst.viewport.minDepth;
-    accum = accum * 1.19421351f + dst.viewport.maxDepth;
-    size_t ret = dst.scissorRect.extent.width;
+    size_t ret = DynamicState_floatBits(dst.viewport.x);
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ DynamicState_floatBits(dst.viewport.y);
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ DynamicState_floatBits(dst.viewport.width);
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ DynamicState_floatBits(dst.viewport.height);
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ DynamicState_floatBits(dst.viewport.minDepth);
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ DynamicState_floatBits(dst.viewport.maxDepth);
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ (uint32_t)dst.scissorRect.offset.x;
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ (uint32_t)dst.scissorRect.offset.y;
+    ret = (ret * PHM_HASH_MULTIPLIER) ^ dst.scissorRect.extent.width;
     ret = (ret * PHM_HASH_MULTIPLIER) ^ dst.scissorRect.extent.height;
-    ret = (ret * PHM_HASH_MULTIPLIER) ^ dst.scissorRect.offset.x;
-    ret = (ret * PHM_HASH_MULTIPLIER) ^ dst.scissorRect.offset.y;
     ret = (ret * PHM_HASH_MULTIPLIER) ^ dst.stencilReference;
-    return ret ^ ((size_t)accum);
+    for(uint32_t i = 0;i < 4;i++){
+        ret = (ret * PHM_HASH_MULTIPLIER) ^ DynamicState_floatBits(dst.blendConstants[i]);
+    }
+    return ret;
 }
 static inline size_t cmpDynamicState(DefaultDynamicState a, DefaultDynamicState b){
     return 
-    a.viewport.x == b.viewport.x &&
-    a.viewport.y == b.viewport.y &&
-    a.viewport.width == b.viewport.width &&
-    a.viewport.height == b.viewport.height &&
-    a.viewport.minDepth == b.viewport.minDepth &&
-    a.viewport.maxDepth == b.viewport.maxDepth &&
+    DynamicState_floatBits(a.viewport.x) == DynamicState_floatBits(b.viewport.x) &&
+    DynamicState_floatBits(a.viewport.y) == DynamicState_floatBits(b.viewport.y) &&
+    DynamicState_floatBits(a.viewport.width) == DynamicState_floatBits(b.viewport.width) &&
+    DynamicState_floatBits(a.viewport.height) == DynamicState_floatBits(b.viewport.height) &&
+    DynamicState_floatBits(a.viewport.minDepth) == DynamicState_floatBits(b.viewport.minDepth) &&
+    DynamicState_floatBits(a.viewport.maxDepth) == DynamicState_floatBits(b.viewport.maxDepth) &&
     a.scissorRect.offset.x == b.scissorRect.offset.x &&
     a.scissorRect.offset.y == b.scissorRect.offset.y &&
     a.scissorRect.extent.width == b.scissorRect.extent.width &&
     a.scissorRect.extent.height == b.scissorRect.extent.height &&
-    a.blendConstants[0] == b.blendConstants[0] &&
-    a.blendConstants[0] == b.blendConstants[0] &&
-    a.blendConstants[0] == b.blendConstants[0] &&
-    a.blendConstants[0] == b.blendConstants[0] &&
+    DynamicState_floatBits(a.blendConstants[0]) == DynamicState_floatBits(b.blendConstants[0]) &&
+    DynamicState_floatBits(a.blendConstants[1]) == DynamicState_floatBits(b.blendConstants[1]) &&
+    DynamicState_floatBits(a.blendConstants[2]) == DynamicState_floatBits(b.blendConstants[2]) &&
+    DynamicState_floatBits(a.blendConstants[3]) == DynamicState_floatBits(b.blendConstants[3]) &&
     a.stencilReference == b.stencilReference;
 }
 DEFINE_GENERIC_HASH_MAP(static inline, DynamicStateCommandBufferMap, DefaultDynamicState, VkCommandBuffer, hashDynamicState, cmpDynamicState, CLITERAL(DefaultDynamicState){0})
 
 typedef struct WGPURenderBundleImpl{
-    RenderPassCommandGenericVector bufferedCommands;
+    RenderPassCommandStream bufferedCommands;
     DynamicStateCommandBufferMap encodedCommandBuffers;
     WGPUDevice device;
     refcount_type refCount;
@@ -2500,10 +2953,11 @@ typedef struct WGPURenderBundleImpl{
     uint32_t colorAttachmentCount;
     VkFormat depthFormat;
     VkFormat depthStencilFormat;
+    VkSampleCountFlagBits sampleCount;
 }WGPURenderBundleImpl;
 
 typedef struct WGPURenderBundleEncoderImpl{
-    RenderPassCommandGenericVector bufferedCommands;
+    RenderPassCommandStream bufferedCommands;
     WGPUDevice device;
     refcount_type refCount;
     uint32_t cacheIndex;
@@ -2513,13 +2967,43 @@ typedef struct WGPURenderBundleEncoderImpl{
     VkFormat* colorAttachmentFormats;
     uint32_t colorAttachmentCount;
     VkFormat depthStencilFormat;
+    VkSampleCountFlagBits sampleCount;
 }WGPURenderBundleEncoderImpl;
 
 void RenderPassEncoder_PushCommand(WGPURenderPassEncoder, const RenderPassCommandGeneric* cmd);
 void ComputePassEncoder_PushCommand(WGPUComputePassEncoder, const RenderPassCommandGeneric* cmd);
 
+typedef struct ParallelPassRecording ParallelPassRecording;
+
+/**
+ * @brief A primary command buffer that precedes the one a command encoder is currently recording into
+ * @details Encoders are split into segments when a render pass is replayed on a worker thread.
+ * While recording is set, buffer is not known yet.
+ */
+typedef struct EncoderSegment{
+    VkCommandBuffer buffer;
+    uint32_t threadSlot;
+    ParallelPassRecording* recording;
+}EncoderSegment;
+DEFINE_VECTOR (CONTAINERAPI, EncoderSegment, EncoderSegmentVector)
+
+// Queries of querySet written by an encoder, one bit per query. The first write of each is covered by a reset
+// in front of the encoder's first command, rewrites reset inline (see CommandEncoder_markQueryWritten)
+typedef struct QueryWrites{
+    WGPUQuerySet querySet;
+    uint64_t* written;
+}QueryWrites;
+DEFINE_VECTOR (static inline, QueryWrites, QueryWritesVector)
+
 typedef struct WGPUCommandEncoderImpl{
     VkCommandBuffer buffer;
+    EncoderSegmentVector segments; // Submitted in order before buffer
+    QueryWritesVector queryWrites;
+    TimestampScopes timestamps;
+    BufferChunkInitMap bufferChunkInits; // Keys are kept alive by the resources and passes the encoder references
+    TextureSubresourceInitMap textureInits;
+    uint32_t debugGroupScopes[WGVK_MAX_DEBUG_GROUP_DEPTH];
+    uint32_t debugGroupDepth;
     refcount_type refCount;
     uint32_t encodedCommandCount;
     WGPURenderPassEncoderSet referencedRPs;
@@ -2529,12 +3013,14 @@ typedef struct WGPUCommandEncoderImpl{
     ResourceUsage resourceUsage;
     WGPUDevice device;
     uint32_t cacheIndex;
+    uint32_t threadSlot;
     uint32_t movedFrom;
     
     
 }WGPUCommandEncoderImpl;
 typedef struct WGPUCommandBufferImpl{
     VkCommandBuffer buffer;
+    EncoderSegmentVector segments; // Submitted in order before buffer
     refcount_type refCount;
     WGPURenderPassEncoderSet referencedRPs;
     WGPUComputePassEncoderSet referencedCPs;
@@ -2544,6 +3030,10 @@ typedef struct WGPUCommandBufferImpl{
     WGPUString label;
     WGPUDevice device;
     uint32_t cacheIndex;
+    uint32_t threadSlot;
+    TimestampScopes timestamps; // Moved to the frame cache by wgpuQueueSubmit
+    BufferChunkInitMap bufferChunkInits;
+    TextureSubresourceInitMap textureInits;
 }WGPUCommandBufferImpl;
 
 
@@ -2551,7 +3041,7 @@ typedef struct WGPURaytracingPassEncoderImpl{
     VkCommandBuffer cmdBuffer;
     WGPUDevice device;
     WGPURaytracingPipeline lastPipeline;
-    RenderPassCommandGenericVector bufferedCommands;
+    RenderPassCommandStream bufferedCommands;
     ResourceUsage resourceUsage;
     refcount_type refCount;
     WGPUPipelineLayout lastLayout;
@@ -2568,9 +3058,20 @@ typedef enum SurfaceImplType{
     SurfaceImplType_AndroidNativeWindow,
     SurfaceImplType_XCBWindow,
     SurfaceImplType_DrmPlane,
+    SurfaceImplType_HeadlessSurface, // VK_EXT_headless_surface
+    SurfaceImplType_Virtual, // No VkSurfaceKHR, images is a ring of offscreen textures
     SurfaceImplType_Force32 = 0x7FFFFFFF,
 }SurfaceImplType;
 
+// Most recent CPU times of the frame loop of a surface, rings of WGVK_PACING_STATISTICS_WINDOW samples
+typedef struct SurfacePacing{
+    double acquireWaitMilliseconds[WGVK_PACING_STATISTICS_WINDOW];
+    double presentIntervalMilliseconds[WGVK_PACING_STATISTICS_WINDOW];
+    uint32_t nextAcquireSample, acquireSampleCount;
+    uint32_t nextPresentSample, presentSampleCount;
+    uint64_t lastPresentTime; // wgvkNanoTime, 0 before the first present
+}SurfacePacing;
+
 typedef struct WGPUSurfaceImpl{
     
     VkSurfaceKHR surface;
@@ -2597,6 +3098,11 @@ typedef struct WGPUSurfaceImpl{
     WGPUTexture* images;
     VkSemaphore* presentSemaphores;
     WGPUSurfaceCapabilities capabilityCache;
+
+    uint32_t maxQueuedFrames; // See WGPUSurfaceFrameLatency
+    WGPUBool presentWait;
+    uint64_t presentId; // Last present id of the current swapchain, ids restart at 1 per swapchain
+    SurfacePacing pacing;
 }WGPUSurfaceImpl;
 
 typedef struct WGPUQueueImpl{
@@ -2623,6 +3129,7 @@ typedef struct WGPUQueueImpl{
 typedef struct WGPUQuerySetImpl{
     VkQueryPool queryPool;
     WGPUQueryType type;
+    uint32_t count;
     refcount_type refCount;
     WGPUDevice device;
 }WGPUQuerySetImpl;
@@ -3191,7 +3698,12 @@ static inline VkImageViewType toVulkanTextureViewDimension(WGPUTextureViewDimens
         case WGPUTextureViewDimension_2DArray:{
             return VK_IMAGE_VIEW_TYPE_2D_ARRAY;
         }
-
+        case WGPUTextureViewDimension_Cube:{
+            return VK_IMAGE_VIEW_TYPE_CUBE;
+        }
+        case WGPUTextureViewDimension_CubeArray:{
+            return VK_IMAGE_VIEW_TYPE_CUBE_ARRAY;
+        }
     }
 }
 static inline VkImageType toVulkanTextureDimension(WGPUTextureDimension dim){
@@ -27,6 +27,20 @@
 #include "wgvk_config.h"
 #include <stdatomic.h>
 #include <stdint.h>
+#if WGVK_SIMD_TEXEL_CONVERSION == 1
+    #if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+        #define WGVK_X86_TEXEL_CONVERSION 1
+        #include <immintrin.h>
+        #if defined(_MSC_VER) && !defined(__clang__)
+            #include <intrin.h>
+        #else
+            #include <cpuid.h>
+        #endif
+    #endif
+    #if defined(__ARM_NEON)
+        #include <arm_neon.h>
+    #endif
+#endif
 #define VK_NO_PROTOTYPES
 #include "vulkan/vulkan_core.h"
 #define VOLK_IMPLEMENTATION
@@ -176,7 +190,8 @@ const char* vkErrorString(int code);
 #define WGPU_LOG_FATAL 6
 
 
-static inline uint32_t findMemoryType(WGPUAdapter adapter, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+// Returns ~0u if no memory type in typeFilter has all of properties
+static inline uint32_t findMemoryTypeIfPresent(WGPUAdapter adapter, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
     
     if(adapter->memProperties.memoryTypeCount == 0){
         vkGetPhysicalDeviceMemoryProperties(adapter->physicalDevice, &adapter->memProperties);
@@ -187,10 +202,15 @@ static inline uint32_t findMemoryType(WGPUAdapter adapter, uint32_t typeFilter,
             return i;
         }
     }
-    assert(false && "failed to find suitable memory type!");
     return ~0u;
 }
 
+static inline uint32_t findMemoryType(WGPUAdapter adapter, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    const uint32_t index = findMemoryTypeIfPresent(adapter, typeFilter, properties);
+    assert(index != ~0u && "failed to find suitable memory type!");
+    return index;
+}
+
 static void doSurfaceCreation(WGPUInstance instance, WGPUSurface ret, WGPUChainedStruct* descriptor){
     switch(descriptor->sType){
         default: return;
@@ -300,6 +320,22 @@ static void doSurfaceCreation(WGPUInstance instance, WGPUSurface ret, WGPUChaine
             ret->surfaceType = SurfaceImplType_XCBWindow;
         }break;
         #endif
+        case WGPUSType_SurfaceSourceHeadless:{
+            const WGPUSurfaceSourceHeadless* headlessSource = (const WGPUSurfaceSourceHeadless*)descriptor;
+            ret->surfaceType = SurfaceImplType_Virtual;
+            // Available whenever the instance exposes VK_EXT_headless_surface, all *_surface extensions are enabled
+            if(headlessSource->useHeadlessSurfaceExtension && vkCreateHeadlessSurfaceEXT != NULL){
+                const VkHeadlessSurfaceCreateInfoEXT sci = {
+                    .sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT,
+                };
+                if(vkCreateHeadlessSurfaceEXT(instance->instance, &sci, NULL, &ret->surface) == VK_SUCCESS){
+                    ret->surfaceType = SurfaceImplType_HeadlessSurface;
+                }
+                else{
+                    ret->surface = VK_NULL_HANDLE;
+                }
+            }
+        }break;
         #if SUPPORT_DRM_SURFACE == 1
         case WGPUSType_SurfaceSourceDrmPlane:{
             WGPUSurfaceSourceDrmPlane* drm = (WGPUSurfaceSourceDrmPlane*)descriptor;
@@ -490,6 +526,7 @@ WGPUSurface wgpuInstanceCreateSurface(WGPUInstance instance, const WGPUSurfaceDe
             case WGPUSType_SurfaceSourceWindowsHWND:                  // [[fallthrough]];
             case WGPUSType_SurfaceSourceMetalLayer:                   // [[fallthrough]];
             case WGPUSType_SurfaceSourceAndroidNativeWindow:          // [[fallthrough]];
+            case WGPUSType_SurfaceSourceHeadless:                     // [[fallthrough]];
             case WGPUSType_EmscriptenSurfaceSourceCanvasHTMLSelector:
                 doSurfaceCreation(instance, ret, head);
                 surfaceCreated = 1;
@@ -854,22 +891,163 @@ void FIFCache_init(FIFCache* fifCache, WGPUDevice device, uint32_t queueFamily){
         };
         device->functions.vkAllocateCommandBuffers(device->device, &cbai, ftb);
         fifCache->frameCaches[i].finalTransitionFence = wgpuDeviceCreateFence(device);
-        VkSemaphoreVector* semvec = &fifCache->frameCaches[i].syncState.semaphores;
-        VkSemaphoreVector_reserve(semvec, 100);
-        semvec->size = 100;
-        for(uint32_t j = 0;j < semvec->size;j++){
-            device->functions.vkCreateSemaphore(device->device, &sci, NULL, semvec->data + j);
-        }
         device->functions.vkCreateSemaphore(device->device, &sci, NULL, &fifCache->frameCaches[i].syncState.acquireImageSemaphore);
+        fifCache->frameCaches[i].overflowPool.mutex = wgvk_mutex_create(wgvk_locktype_kernel);
+        PooledCommandBufferVector_init(&fifCache->frameCaches[i].overflowPool.buffers);
     }
 }
 
 void SyncState_destroy(WGPUDevice device, SyncState* syncState){
     device->functions.vkDestroySemaphore(device->device, syncState->acquireImageSemaphore, NULL);
-    for(uint32_t s = 0;s < syncState->semaphores.size;s++){
-        device->functions.vkDestroySemaphore(device->device, syncState->semaphores.data[s], NULL);
+}
+
+static void ContainerCache_init(ContainerCache* cache){
+    cache->mutex = wgvk_mutex_create(wgvk_locktype_spin);
+    ResourceUsageVector_init(&cache->resourceUsages);
+    RenderPassCommandStreamVector_init(&cache->commandStreams);
+}
+
+static void ContainerCache_destroy(ContainerCache* cache){
+    for(size_t i = 0;i < cache->resourceUsages.size;i++){
+        ResourceUsage_free(cache->resourceUsages.data + i);
+    }
+    for(size_t i = 0;i < cache->commandStreams.size;i++){
+        RenderPassCommandStream_free(cache->commandStreams.data + i);
+    }
+    ResourceUsageVector_free(&cache->resourceUsages);
+    RenderPassCommandStreamVector_free(&cache->commandStreams);
+    wgvk_mutex_destroy(cache->mutex);
+}
+
+static uint64_t ResourceUsage_capacity(const ResourceUsage* ru){
+    return ru->referencedBuffers.current_capacity + ru->referencedTextures.current_capacity +
+           ru->referencedTextureViews.current_capacity + ru->referencedBindGroups.current_capacity;
+}
+
+/**
+ * @brief Hands out an empty ResourceUsage, reusing the tables of a released one if available
+ * @details dest must not own any tables
+ */
+static void ContainerCache_acquireResourceUsage(ContainerCache* cache, ResourceUsage* dest){
+    wgvk_mutex_lock(cache->mutex);
+    if(cache->resourceUsages.size){
+        *dest = cache->resourceUsages.data[--cache->resourceUsages.size];
+    }
+    else{
+        ResourceUsage_init(dest);
+    }
+    wgvk_mutex_unlock(cache->mutex);
+}
+
+/**
+ * @brief Releases every resource referenced by ru and takes ownership of its tables
+ * @details ru is left empty. Oversized tables and anything beyond WGVK_CONTAINER_CACHE_SIZE are freed instead.
+ */
+static void ContainerCache_recycleResourceUsage(ContainerCache* cache, ResourceUsage* ru){
+    releaseAllReferences(ru);
+    if(ResourceUsage_capacity(ru) <= WGVK_CONTAINER_CACHE_MAX_CAPACITY){
+        ResourceUsage_clear(ru);
+        wgvk_mutex_lock(cache->mutex);
+        if(cache->resourceUsages.size < WGVK_CONTAINER_CACHE_SIZE){
+            ResourceUsageVector_push_back(&cache->resourceUsages, *ru);
+            ResourceUsage_init(ru);
+        }
+        wgvk_mutex_unlock(cache->mutex);
+    }
+    ResourceUsage_free(ru);
+}
+
+/**
+ * @brief Buffers cmd in stream and reports to device if that failed, so a dropped command never goes unnoticed
+ */
+static void Device_pushCommand(WGPUDevice device, RenderPassCommandStream* stream, const RenderPassCommandGeneric* cmd){
+    switch(RenderPassCommandStream_push(stream, cmd)){
+        case RENDER_PASS_COMMAND_STREAM_OUT_OF_MEMORY:
+            DeviceCallback(device, WGPUErrorType_OutOfMemory, STRVIEW("Out of memory while buffering a pass command, the command was dropped"));
+            break;
+        case RENDER_PASS_COMMAND_STREAM_RECORD_TOO_LARGE:
+            DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("Pass command dropped: its dynamic offsets or immediate data exceed the 64 KiB a buffered command can hold"));
+            break;
+        default: break;
+    }
+}
+
+static void ContainerCache_acquireCommandStream(ContainerCache* cache, RenderPassCommandStream* dest){
+    wgvk_mutex_lock(cache->mutex);
+    if(cache->commandStreams.size){
+        *dest = cache->commandStreams.data[--cache->commandStreams.size];
+    }
+    else{
+        RenderPassCommandStream_init(dest);
+    }
+    wgvk_mutex_unlock(cache->mutex);
+}
+
+/**
+ * @brief Takes ownership of the storage of a released command stream
+ * @details Streams above WGVK_CONTAINER_CACHE_MAX_STREAM_BYTES and anything beyond WGVK_CONTAINER_CACHE_SIZE are 
+ * freed instead, so a single huge pass doesn't pin its memory for the lifetime of the device.
+ */
+static void ContainerCache_recycleCommandStream(ContainerCache* cache, RenderPassCommandStream* commands){
+    if(commands->capacity && commands->capacity <= WGVK_CONTAINER_CACHE_MAX_STREAM_BYTES){
+        RenderPassCommandStream_clear(commands);
+        wgvk_mutex_lock(cache->mutex);
+        if(cache->commandStreams.size < WGVK_CONTAINER_CACHE_SIZE){
+            RenderPassCommandStreamVector_push_back(&cache->commandStreams, *commands);
+            RenderPassCommandStream_init(commands);
+        }
+        wgvk_mutex_unlock(cache->mutex);
+    }
+    RenderPassCommandStream_free(commands);
+}
+
+static void RetiredSwapchain_destroy(WGPUDevice device, RetiredSwapchain* retired){
+    for(uint32_t i = 0;i < retired->imageCount;i++){
+        if(retired->swapchain == VK_NULL_HANDLE){
+            // Offscreen texture of a virtual surface, it owns its image and memory
+            wgpuTextureRelease(retired->images[i]);
+            continue;
+        }
+        device->functions.vkDestroySemaphore(device->device, retired->presentSemaphores[i], NULL);
+        WGPUTexture swapchainTexture = retired->images[i];
+        // The VkImage is owned by the swapchain, only the surface's reference and the cached views go away here
+        if(--swapchainTexture->refCount == 0){
+            for(size_t j = 0;j < swapchainTexture->viewCache.current_capacity;j++){
+                if(swapchainTexture->viewCache.table[j].key.format != VK_FORMAT_UNDEFINED){
+                    device->functions.vkDestroyImageView(device->device, swapchainTexture->viewCache.table[j].value->view, NULL);
+                    RL_FREE(swapchainTexture->viewCache.table[j].value);
+                }
+            }
+            Texture_ViewCache_free(&swapchainTexture->viewCache);
+            RL_FREE(swapchainTexture);
+        }
+    }
+    RL_FREE((void*)retired->presentSemaphores);
+    RL_FREE((void*)retired->images);
+    if(retired->swapchain != VK_NULL_HANDLE){
+        device->functions.vkDestroySwapchainKHR(device->device, retired->swapchain, NULL);
+    }
+}
+
+static void PerframeCache_destroyRetiredSwapchains(WGPUDevice device, PerframeCache* pfcache){
+    for(size_t i = 0;i < pfcache->retiredSwapchains.size;i++){
+        RetiredSwapchain_destroy(device, pfcache->retiredSwapchains.data + i);
+    }
+    RetiredSwapchainVector_clear(&pfcache->retiredSwapchains);
+}
+
+static void BindGroupSlotContent_release(BindGroupSlotContent* content){
+    if(content->buffer)wgpuBufferRelease(content->buffer);
+    if(content->textureView)wgpuTextureViewRelease(content->textureView);
+    if(content->sampler)wgpuSamplerRelease(content->sampler);
+    *content = (BindGroupSlotContent){0};
+}
+
+static void PerframeCache_releaseRetiredSlotContents(PerframeCache* pfcache){
+    for(size_t i = 0;i < pfcache->retiredSlotContents.size;i++){
+        BindGroupSlotContent_release(pfcache->retiredSlotContents.data + i);
     }
-    VkSemaphoreVector_free(&syncState->semaphores);
+    BindGroupSlotContentVector_clear(&pfcache->retiredSlotContents);
 }
 
 void FIFCache_destroy(FIFCache* fcache){
@@ -897,12 +1075,35 @@ void FIFCache_destroy(FIFCache* fcache){
 
         device->functions.vkFreeCommandBuffers(device->device, cache->commandPool, 1, &cache->finalTransitionBuffer);
         device->functions.vkDestroySemaphore(device->device, cache->finalTransitionSemaphore, NULL);
+        // Query pools of this frame's submits, their fences were waited on above
+        for(size_t t = 0;t < cache->timestamps.size;t++){
+            device->functions.vkDestroyQueryPool(device->device, cache->timestamps.data[t].queryPool, NULL);
+            RL_FREE(cache->timestamps.data[t].labels);
+        }
+        TimestampScopesVector_free(&cache->timestamps);
+        // The pending command buffer fences were waited on above
+        PerframeCache_destroyRetiredSwapchains(device, cache);
+        RetiredSwapchainVector_free(&cache->retiredSwapchains);
+        PerframeCache_releaseRetiredSlotContents(cache);
+        BindGroupSlotContentVector_free(&cache->retiredSlotContents);
         SyncState_destroy(fcache->device, &fcache->frameCaches[i].syncState);
         wgpuFenceRelease(cache->finalTransitionFence);
         
-        if(cache->commandBuffers.size){
-            device->functions.vkFreeCommandBuffers(device->device, cache->commandPool, cache->commandBuffers.size, cache->commandBuffers.data);
-            VkCommandBufferVector_free(&cache->commandBuffers);
+        for(uint32_t t = 0;t < WGVK_MAX_RECORDING_THREADS;t++){
+            ThreadCommandPool* tpool = cache->threadPools + t;
+            if(tpool->pool == VK_NULL_HANDLE)continue;
+            // Destroying the pool frees all of its command buffers
+            device->functions.vkDestroyCommandPool(device->device, tpool->pool, NULL);
+            VkCommandBufferVector_free(&tpool->buffers);
+        }
+        for(size_t b = 0;b < cache->overflowPool.buffers.size;b++){
+            device->functions.vkDestroyCommandPool(device->device, cache->overflowPool.buffers.data[b].pool, NULL);
+        }
+        PooledCommandBufferVector_free(&cache->overflowPool.buffers);
+        wgvk_mutex_destroy(cache->overflowPool.mutex);
+        if(cache->transitionBuffers.size){
+            device->functions.vkFreeCommandBuffers(device->device, cache->commandPool, cache->transitionBuffers.size, cache->transitionBuffers.data);
+            VkCommandBufferVector_free(&cache->transitionBuffers);
         }
         for(size_t bgc = 0;bgc < cache->bindGroupCache.current_capacity;bgc++){
             if(cache->bindGroupCache.table[bgc].key != PHM_EMPTY_SLOT_KEY && cache->bindGroupCache.table[bgc].key != PHM_DELETED_SLOT_KEY){
@@ -1670,6 +1871,7 @@ typedef struct userdataforcreatedevice{
     WGPURequestDeviceCallbackInfo callbackInfo;
 }userdataforcreatedevice;
 
+static WGPUCommandEncoder CommandEncoder_create(WGPUDevice device, uint32_t threadSlot);
 
 WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescriptor* descriptor){
     ENTRY();
@@ -1720,6 +1922,9 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
         VK_KHR_MAINTENANCE_7_EXTENSION_NAME,
         #endif
         //#endif
+        VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME,
+        VK_KHR_PRESENT_ID_EXTENSION_NAME,
+        VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
         #if VULKAN_ENABLE_RAYTRACING == 1
         VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,      // "VK_KHR_acceleration_structure"
         VK_KHR_RAY_TRACING_PIPELINE_EXTENSION_NAME,        // "VK_KHR_ray_tracing_pipeline"
@@ -1734,6 +1939,10 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
     
     int depthClipControl_Found = 0;
     int depthClipEnable_Found = 0;
+    int drawIndirectCount_Found = 0;
+    int maintenance7_Found = 0;
+    int presentId_Found = 0;
+    int presentWait_Found = 0;
 
     const char* deviceExtensionsFound[deviceExtensionsToLookForCount + 4];
     uint32_t extInsertIndex = 0;
@@ -1746,6 +1955,20 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
             if(strcmp(deprops[j].extensionName, VK_EXT_DEPTH_CLIP_ENABLE_EXTENSION_NAME) == 0){
                 depthClipEnable_Found = 1;
             }
+            if(strcmp(deprops[j].extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0){
+                drawIndirectCount_Found = 1;
+            }
+            if(strcmp(deprops[j].extensionName, VK_KHR_PRESENT_ID_EXTENSION_NAME) == 0){
+                presentId_Found = 1;
+            }
+            if(strcmp(deprops[j].extensionName, VK_KHR_PRESENT_WAIT_EXTENSION_NAME) == 0){
+                presentWait_Found = 1;
+            }
+            #if RENDERBUNDLES_AS_SECONDARY_COMMANDBUFFERS == 1
+            if(strcmp(deprops[j].extensionName, VK_KHR_MAINTENANCE_7_EXTENSION_NAME) == 0){
+                maintenance7_Found = 1;
+            }
+            #endif
 
             if(strcmp(deviceExtensionsToLookFor[i], deprops[j].extensionName) == 0){
                 deviceExtensionsFound[extInsertIndex++] = deviceExtensionsToLookFor[i];
@@ -1760,12 +1983,13 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
         
     }
 
-    VkPhysicalDeviceBufferDeviceAddressFeaturesKHR deviceFeaturesAddressKhr = {
-        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR,
+    // Also carries bufferDeviceAddress: VkPhysicalDeviceBufferDeviceAddressFeatures may not be chained next to it
+    VkPhysicalDeviceVulkan12Features v12features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
     };
     VkPhysicalDeviceRayTracingPipelineFeaturesKHR pipelineFeatures = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR,
-        .pNext = &deviceFeaturesAddressKhr,
+        .pNext = &v12features,
     };
     VkPhysicalDeviceAccelerationStructureFeaturesKHR accelerationStructureFeatures = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR,
@@ -1777,9 +2001,25 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
         .pNext = &accelerationStructureFeatures,
     };
     
+    // Allows mixing inline draws and executed render bundles in one dynamic rendering instance
+    VkPhysicalDeviceMaintenance7FeaturesKHR maintenance7Features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_7_FEATURES_KHR,
+        .pNext = &v13features,
+    };
+    
+    // Frame latency control (WGPUSurfaceFrameLatency), only chained when both extensions are enabled
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = maintenance7_Found ? (void*)&maintenance7Features : (void*)&v13features
+    };
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+        .pNext = &presentIdFeatures
+    };
+    
     VkPhysicalDeviceFeatures2 deviceFeatures = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
-        .pNext =  &v13features
+        .pNext = (presentId_Found && presentWait_Found) ? (void*)&presentWaitFeatures : presentIdFeatures.pNext
     };
     vkGetPhysicalDeviceFeatures2(adapter->physicalDevice, &deviceFeatures);
     if(pipelineFeatures.rayTracingPipeline == VK_TRUE){
@@ -1815,6 +2055,7 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
     WGPUDevice retDevice = RL_CALLOC(1, sizeof(WGPUDeviceImpl));
 
     retDevice->refCount = 1;
+    ContainerCache_init(&retDevice->containerCache);
     WGPUQueue retQueue = RL_CALLOC(1, sizeof(WGPUQueueImpl));
     retQueue->refCount = 0;
     VkResult dcresult = vkCreateDevice(adapter->physicalDevice, &createInfo, NULL, &(retDevice->device));
@@ -1832,8 +2073,32 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
         retDevice->capabilities.depthClipControl = depthClipControl_Found;    
     }
     retDevice->capabilities.dynamicRendering = v13features.dynamicRendering;
+    retDevice->capabilities.synchronization2 = v13features.synchronization2;
     retDevice->capabilities.raytracing = pipelineFeatures.rayTracingPipeline && accelerationStructureFeatures.accelerationStructure;
-    retDevice->capabilities.shaderDeviceAddress = deviceFeaturesAddressKhr.bufferDeviceAddress;
+    retDevice->capabilities.shaderDeviceAddress = v12features.bufferDeviceAddress;
+    retDevice->capabilities.multiDrawIndirect = deviceFeatures.features.multiDrawIndirect;
+    retDevice->capabilities.inheritedQueries = deviceFeatures.features.inheritedQueries;
+    retDevice->capabilities.presentWait = presentId_Found && presentWait_Found && presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    if(retDevice->functions.vkCmdDrawIndirectCount == NULL && drawIndirectCount_Found){
+        retDevice->functions.vkCmdDrawIndirectCount = retDevice->functions.vkCmdDrawIndirectCountKHR;
+        retDevice->functions.vkCmdDrawIndexedIndirectCount = retDevice->functions.vkCmdDrawIndexedIndirectCountKHR;
+    }
+    retDevice->capabilities.drawIndirectCount = (v12features.drawIndirectCount || drawIndirectCount_Found) && retDevice->functions.vkCmdDrawIndirectCount && retDevice->functions.vkCmdDrawIndexedIndirectCount;
+    {
+        VkPhysicalDeviceProperties properties zeroinit;
+        vkGetPhysicalDeviceProperties(adapter->physicalDevice, &properties);
+        retDevice->capabilities.maxDrawIndirectCount = properties.limits.maxDrawIndirectCount;
+    }
+    #if RENDERBUNDLES_AS_SECONDARY_COMMANDBUFFERS == 1 && VULKAN_USE_DYNAMIC_RENDERING == 1
+    retDevice->capabilities.secondaryRenderBundles = maintenance7_Found && maintenance7Features.maintenance7 && v13features.dynamicRendering;
+    #endif
+    retDevice->capabilities.bindless = v12features.descriptorIndexing && v12features.runtimeDescriptorArray && v12features.descriptorBindingPartiallyBound;
+    // Slots get written while their group is in flight, so update-after-bind is only used together with unused-while-pending
+    const WGPUBool updateAfterBind = retDevice->capabilities.bindless && v12features.descriptorBindingUpdateUnusedWhilePending;
+    retDevice->capabilities.updateAfterBindSampledImage  = updateAfterBind && v12features.descriptorBindingSampledImageUpdateAfterBind;
+    retDevice->capabilities.updateAfterBindStorageImage  = updateAfterBind && v12features.descriptorBindingStorageImageUpdateAfterBind;
+    retDevice->capabilities.updateAfterBindUniformBuffer = updateAfterBind && v12features.descriptorBindingUniformBufferUpdateAfterBind;
+    retDevice->capabilities.updateAfterBindStorageBuffer = updateAfterBind && v12features.descriptorBindingStorageBufferUpdateAfterBind;
     retDevice->uncapturedErrorCallbackInfo = descriptor->uncapturedErrorCallbackInfo;
 
     // Retrieve and assign queues
@@ -1858,16 +2123,17 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
     }
     const VkCommandPoolCreateInfo pci = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = adapter->queueIndices.graphicsIndex,
     };
     retDevice->functions.vkCreateCommandPool(retDevice->device, &pci, NULL, &retDevice->secondaryCommandPool);
-    
-    WGPUCommandEncoderDescriptor cedesc = {0};
+    retDevice->secondaryCommandPoolMutex = wgvk_mutex_create(wgvk_locktype_kernel);
+    retDevice->mipmapPipelineMutex = wgvk_mutex_create(wgvk_locktype_kernel);
 
     FenceCache_Init(retDevice, &retDevice->fenceCache);
     FIFCache_init(&retDevice->fifCache, retDevice, adapter->queueIndices.graphicsIndex);
     
-    retQueue->presubmitCache = wgpuDeviceCreateCommandEncoder(retDevice, &cedesc);
+    retQueue->presubmitCache = CommandEncoder_create(retDevice, WGVK_OVERFLOW_THREAD_SLOT);
     VkDeviceSize limit = (((uint64_t)1) << 30);
 
     VkPhysicalDeviceMemoryProperties2 memoryProperties = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2};
@@ -1921,6 +2187,25 @@ WGPUDevice wgpuAdapterCreateDevice(WGPUAdapter adapter, const WGPUDeviceDescript
     vmaCreatePool(retDevice->allocator, &vpci, &retDevice->aligned_hostVisiblePool);
     #endif
     retDevice->thread_pool = wgvk_thread_pool_create(4);
+    for(const WGPUChainedStruct* chain = descriptor->nextInChain;chain;chain = chain->next){
+        if(chain->sType == WGPUSType_DeviceParallelRecording){
+            const WGPUDeviceParallelRecording* parallelRecording = (const WGPUDeviceParallelRecording*)chain;
+            retDevice->parallelPassRecording = parallelRecording->parallelPassRecording;
+            retDevice->parallelPassMinCommands = parallelRecording->minCommandCount ? parallelRecording->minCommandCount : 64;
+        }
+        if(chain->sType == WGPUSType_DeviceTimestampProfiling){
+            const WGPUDeviceTimestampProfiling* profiling = (const WGPUDeviceTimestampProfiling*)chain;
+            VkPhysicalDeviceProperties properties zeroinit;
+            vkGetPhysicalDeviceProperties(adapter->physicalDevice, &properties);
+            if(profiling->enabled && properties.limits.timestampComputeAndGraphics && v12features.hostQueryReset){
+                retDevice->timestampScopeCapacity = profiling->maxScopesPerFrame ? profiling->maxScopesPerFrame : WGVK_TIMESTAMP_DEFAULT_SCOPES;
+                retDevice->timestampPeriod = properties.limits.timestampPeriod;
+                TimestampLabelStatisticsVector_init(&retDevice->timestampStatistics);
+                TimestampScopesVector_init(&retDevice->freeTimestampScopes);
+                retDevice->timestampScopesMutex = wgvk_mutex_create(wgvk_locktype_kernel);
+            }
+        }
+    }
     wgvkAllocator_init(&retDevice->builtinAllocator, adapter->physicalDevice, retDevice, &retDevice->functions);
     {
 
@@ -2004,102 +2289,613 @@ void wgpuBufferMapSync(void* data){
 }
 void wgpuBufferMap(WGPUBuffer buffer, WGPUMapMode mapmode, size_t offset, size_t size, void** data);
 
-WGPUBuffer wgpuDeviceCreateBuffer(WGPUDevice device, const WGPUBufferDescriptor* desc){
-    ENTRY();
-    //vmaCreateAllocator(const VmaAllocatorCreateInfo * _Nonnull pCreateInfo, VmaAllocator  _Nullable * _Nonnull pAllocator)
-    
-    if(desc->usage & WGPUBufferUsage_MapRead){
-        if(desc->usage & ~(WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead)){
-            DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("WGPUBufferUsage_MapRead used with something other than WGPUBufferUsage_CopyDst"));
-        }
+/*
+ * Lazy zero-initialization
+ * WebGPU requires reads of never written memory to observe zeros. Instead of clearing every resource at creation,
+ * buffers track which of up to 64 chunks and textures which subresources were written or zeroed. Commands reading
+ * a resource zero what is still uninitialized first, commands overwriting whole chunks or subresources only mark them.
+ * Both are collected per encoder and resolved when the command buffer is submitted (see Queue_initializeResources), 
+ * so encoders recorded in parallel or submitted out of order can't skip or repeat a zero fill.
+ */
+static inline uint64_t Buffer_chunkMask(WGPUBuffer buffer, uint64_t offset, uint64_t size, WGPUBool coveredOnly){
+    if(size == WGPU_WHOLE_SIZE || offset > buffer->capacity || size > buffer->capacity - offset){
+        size = offset < buffer->capacity ? buffer->capacity - offset : 0;
     }
-    if(desc->usage & WGPUBufferUsage_MapWrite){
-        if(desc->usage & ~(WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite)){
-            DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("WGPUBufferUsage_MapWrite used with something other than WGPUBufferUsage_CopySrc"));
+    if(size == 0 || buffer->zeroInitChunkSize == 0){
+        return 0;
+    }
+    const uint64_t chunkSize = buffer->zeroInitChunkSize;
+    const uint64_t end = offset + size;
+    uint64_t first = offset / chunkSize;
+    uint64_t last = (end - 1) / chunkSize;
+    if(coveredOnly){
+        // Chunks only partially inside the range don't count, the last chunk ends at the buffer's end
+        if(offset % chunkSize != 0)++first;
+        if(end != buffer->capacity && end % chunkSize != 0){
+            if(last == 0)return 0;
+            --last;
         }
+        if(first > last)return 0;
     }
-    WGPUBuffer wgpuBuffer = RL_CALLOC(1, sizeof(WGPUBufferImpl));
+    const uint64_t upTo = last == 63 ? ~(uint64_t)0 : (((uint64_t)1 << (last + 1)) - 1);
+    return upTo & ~(((uint64_t)1 << first) - 1);
+}
 
-    uint32_t cacheIndex = device->submittedFrames % framesInFlight;
+// For writes done on the host right away
+static inline void Buffer_markInitialized(WGPUBuffer buffer, uint64_t offset, uint64_t size){
+    atomic_fetch_or_explicit(&buffer->initializedChunks, Buffer_chunkMask(buffer, offset, size, 1), memory_order_relaxed);
+}
 
-    wgpuBuffer->device = device;
-    wgpuBuffer->cacheIndex = cacheIndex;
-    wgpuBuffer->refCount = 1;
-    wgpuBuffer->usage = desc->usage;
-    
-    
-    const VkBufferCreateInfo bufferDesc = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .size = desc->size,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
-        .usage = toVulkanBufferUsage(desc->usage),
-    };
-    
-    VkMemoryPropertyFlags propertyToFind = 0;
-    if(desc->usage & (WGPUBufferUsage_MapRead | WGPUBufferUsage_MapWrite)){
-        propertyToFind = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+/**
+ * @brief Calls zero(buffer, userdata, begin, end) for every run of consecutive chunks in mask
+ */
+static void Buffer_forEachChunkRun(WGPUBuffer buffer, uint64_t mask, void(*zero)(WGPUBuffer, void*, uint64_t, uint64_t), void* userdata){
+    for(uint32_t i = 0;i < 64;){
+        if(((mask >> i) & 1) == 0){
+            ++i;
+            continue;
+        }
+        uint32_t runEnd = i;
+        while(runEnd < 64 && ((mask >> runEnd) & 1))++runEnd;
+        const uint64_t begin = i * buffer->zeroInitChunkSize;
+        const uint64_t end = runEnd * buffer->zeroInitChunkSize;
+        zero(buffer, userdata, begin, end < buffer->capacity ? end : buffer->capacity);
+        i = runEnd;
     }
-    else{
-        // propertyToFind = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-        propertyToFind = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+}
+
+static void Buffer_zeroRunOnHost(WGPUBuffer buffer, void* base, uint64_t begin, uint64_t end){
+    memset((uint8_t*)base + begin, 0, end - begin);
+}
+
+/**
+ * @brief Zeroes the never written chunks of buffer overlapping [offset, offset + size), base points to byte 0 of the mapped buffer
+ */
+static void Buffer_zeroUninitializedOnHost(WGPUBuffer buffer, void* base, uint64_t offset, uint64_t size){
+    const uint64_t mask = Buffer_chunkMask(buffer, offset, size, 0);
+    const uint64_t uninitialized = mask & ~atomic_fetch_or_explicit(&buffer->initializedChunks, mask, memory_order_relaxed);
+    if(uninitialized == 0)return;
+    Buffer_forEachChunkRun(buffer, uninitialized, Buffer_zeroRunOnHost, base);
+}
+
+static void Buffer_zeroRunOnDevice(WGPUBuffer buffer, void* commandBuffer, uint64_t begin, uint64_t end){
+    const VkDeviceSize size = end == buffer->capacity ? VK_WHOLE_SIZE : end - begin;
+    buffer->device->functions.vkCmdFillBuffer(*(VkCommandBuffer*)commandBuffer, buffer->buffer, begin, size, 0);
+}
+
+/**
+ * @brief Notes chunks of buffer the encoder reads (zero) or overwrites entirely (written), nothing is recorded yet
+ * @details Chunks already initialized when the encoder gets here stay so, only the rest has to be resolved on submit.
+ */
+static void CommandEncoder_noteBufferChunks(WGPUCommandEncoder encoder, WGPUBuffer buffer, uint64_t zero, uint64_t written){
+    const uint64_t initialized = atomic_load_explicit(&buffer->initializedChunks, memory_order_relaxed);
+    zero &= ~initialized;
+    written &= ~initialized;
+    if((zero | written) == 0)return;
+    BufferChunkInit* init = BufferChunkInitMap_get(&encoder->bufferChunkInits, buffer);
+    if(init == NULL){
+        BufferChunkInitMap_put(&encoder->bufferChunkInits, buffer, (BufferChunkInit){0});
+        init = BufferChunkInitMap_get(&encoder->bufferChunkInits, buffer);
     }
+    // Chunks this encoder overwrote before reading them need no zeroing
+    init->zero |= zero & ~init->written;
+    init->written |= written;
+}
 
-    #if USE_VMA_ALLOCATOR == 1
-    VmaAllocationCreateInfo vallocInfo = {
-        .preferredFlags = propertyToFind,
-    };
-    VmaAllocation allocation zeroinit;
-    VmaAllocationInfo allocationInfo zeroinit;
-    VkResult vmabufferCreateResult = vmaCreateBuffer(device->allocator, &bufferDesc, &vallocInfo, &wgpuBuffer->buffer, &allocation, &allocationInfo);
+/**
+ * @brief Before commands that may read [offset, offset + size) of buffer
+ */
+static void CommandEncoder_initializeBufferRead(WGPUCommandEncoder encoder, WGPUBuffer buffer, uint64_t offset, uint64_t size){
+    CommandEncoder_noteBufferChunks(encoder, buffer, Buffer_chunkMask(buffer, offset, size, 0), 0);
+}
 
-    if(vmabufferCreateResult != VK_SUCCESS){
-        DeviceCallback(device, WGPUErrorType_OutOfMemory, STRVIEW("Failed to create allocator"));
-        TRACELOG(WGPU_LOG_ERROR, "Could not allocate buffer: %s", vkErrorString(vmabufferCreateResult));
-        RL_FREE(wgpuBuffer);
-        return NULL;
+/**
+ * @brief Before commands that overwrite [offset, offset + size) of buffer: covered chunks are only marked, partially covered ones zeroed first
+ */
+static void CommandEncoder_initializeBufferWrite(WGPUCommandEncoder encoder, WGPUBuffer buffer, uint64_t offset, uint64_t size){
+    const uint64_t covered = Buffer_chunkMask(buffer, offset, size, 1);
+    CommandEncoder_noteBufferChunks(encoder, buffer, Buffer_chunkMask(buffer, offset, size, 0) & ~covered, covered);
+}
+
+typedef struct ZeroFillState{
+    VkCommandBuffer commandBuffer;
+    WGPUDevice device;
+    WGPUCommandBuffer submitted;
+    VkImageLayout layout; // Of the texture being resolved, in front of submitted
+    WGPUBool filled;
+}ZeroFillState;
+
+static void Buffer_resolveChunkInit(void* buffer_, BufferChunkInit* init, void* state_){
+    WGPUBuffer buffer = (WGPUBuffer)buffer_;
+    ZeroFillState* state = (ZeroFillState*)state_;
+    if(buffer == NULL)return; // The map's null key slot, never used
+    // Whoever sets a bit first zeroes it, concurrent submits never fill the same chunk twice
+    const uint64_t initialized = atomic_fetch_or_explicit(&buffer->initializedChunks, init->zero | init->written, memory_order_relaxed);
+    const uint64_t fill = init->zero & ~initialized;
+    init->written = (init->zero | init->written) & ~initialized;
+    if(fill == 0)return;
+    Buffer_forEachChunkRun(buffer, fill, Buffer_zeroRunOnDevice, &state->commandBuffer);
+    state->filled = 1;
+}
+
+static void Buffer_revertChunkInit(void* buffer_, BufferChunkInit* init, void* unused){
+    if(buffer_ == NULL)return;
+    atomic_fetch_and_explicit(&((WGPUBuffer)buffer_)->initializedChunks, ~init->written, memory_order_relaxed);
+}
+
+static inline WGPUBool isCompressedFormatVk(VkFormat format){
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+}
+
+/**
+ * @brief Resolves VK_REMAINING_* and the array layers of 3D textures, which are tracked per mip level
+ */
+static inline VkImageSubresourceRange Texture_trackedRange(WGPUTexture texture, VkImageSubresourceRange range){
+    const uint32_t layers = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : texture->depthOrArrayLayers;
+    if(texture->dimension == VK_IMAGE_TYPE_3D){
+        range.baseArrayLayer = 0;
+        range.layerCount = 1;
     }
-    wgpuBuffer->vmaAllocation = allocation;
-    wgpuBuffer->allocationType = AllocationTypeVMA;
-    #else
-    device->functions.vkCreateBuffer(device->device, &bufferDesc, NULL, &wgpuBuffer->buffer);
-    wgvkAllocation allocation = {0};
-    VkMemoryRequirements requirements = {0};
-    device->functions.vkGetBufferMemoryRequirements(device->device, wgpuBuffer->buffer, &requirements);
-    if(desc->usage & WGPUBufferUsage_Raytracing){
-        requirements.alignment = 256;
+    if(range.levelCount == VK_REMAINING_MIP_LEVELS)range.levelCount = texture->mipLevels - range.baseMipLevel;
+    if(range.layerCount == VK_REMAINING_ARRAY_LAYERS)range.layerCount = layers - range.baseArrayLayer;
+    return range;
+}
+
+// Words of the initialization bitsets of texture
+static inline uint32_t Texture_subresourceWords(WGPUTexture texture){
+    const uint32_t layers = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : texture->depthOrArrayLayers;
+    return (texture->mipLevels * layers + 63) / 64;
+}
+
+static inline WGPUBool subresourceBitSet(const uint64_t* bits, WGPUTexture texture, uint32_t level, uint32_t layer){
+    const uint32_t bit = layer * texture->mipLevels + level;
+    return (bits[bit / 64] >> (bit % 64)) & 1;
+}
+
+static inline void subresourceBitAssign(uint64_t* bits, WGPUTexture texture, uint32_t level, uint32_t layer, WGPUBool value){
+    const uint32_t bit = layer * texture->mipLevels + level;
+    if(value){
+        bits[bit / 64] |= (uint64_t)1 << (bit % 64);
+    }else{
+        bits[bit / 64] &= ~((uint64_t)1 << (bit % 64));
     }
-    bool ret = wgvkAllocator_alloc(&device->builtinAllocator, &requirements, propertyToFind, &allocation);
-    wgpuBuffer->allocationType = AllocationTypeBuiltin;
-    wgpuBuffer->builtinAllocation = allocation;
-    device->functions.vkBindBufferMemory(device->device, wgpuBuffer->buffer, allocation.pool->chunks[allocation.chunk_index].memory, allocation.offset);
-    #endif
-    wgpuBuffer->memoryProperties = propertyToFind;
+}
 
-    if(desc->usage & WGPUBufferUsage_ShaderDeviceAddress){
-        const VkBufferDeviceAddressInfo bdai = {
-            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR,
-            .buffer = wgpuBuffer->buffer
-        };
-        wgpuBuffer->address = device->functions.vkGetBufferDeviceAddress(device->device, &bdai);
+static inline uint32_t bitCount64(uint64_t x){
+    x = x - ((x >> 1) & 0x5555555555555555ull);
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (uint32_t)((x * 0x0101010101010101ull) >> 56);
+}
+
+// As of the last submit, which only matters for the encoder if no other submit can discard the subresource before its own
+static inline WGPUBool Texture_isInitialized(WGPUTexture texture, uint32_t level, uint32_t layer){
+    if(texture->initializedSubresources == NULL)return 1;
+    const uint32_t bit = layer * texture->mipLevels + level;
+    return (atomic_load_explicit(&texture->initializedSubresources[bit / 64], memory_order_relaxed) >> (bit % 64)) & 1;
+}
+
+// Only render passes storing with WGPUStoreOp_Discard make subresources uninitialized again
+static inline WGPUBool Texture_isDiscardable(WGPUTexture texture){
+    return (texture->usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+}
+
+// Compressed formats and transient attachments can't be cleared by transfer commands, they're marked only
+static inline WGPUBool Texture_isZeroable(WGPUTexture texture){
+    return !isCompressedFormatVk(texture->format) && !(texture->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+}
+
+/**
+ * @brief Calls zero(texture, userdata, run) for every run of consecutive array layers of one mip level in range whose bit is set in bits
+ */
+static void Texture_forEachSubresourceRun(WGPUTexture texture, VkImageSubresourceRange range, const uint64_t* bits, void(*zero)(WGPUTexture, void*, VkImageSubresourceRange), void* userdata){
+    const VkImageAspectFlags aspect = toVulkanAspectMaskVk(WGPUTextureAspect_All, texture->format);
+    for(uint32_t level = range.baseMipLevel;level < range.baseMipLevel + range.levelCount;level++){
+        for(uint32_t layer = range.baseArrayLayer;layer < range.baseArrayLayer + range.layerCount;){
+            if(!subresourceBitSet(bits, texture, level, layer)){
+                ++layer;
+                continue;
+            }
+            uint32_t runEnd = layer;
+            while(runEnd < range.baseArrayLayer + range.layerCount && subresourceBitSet(bits, texture, level, runEnd))++runEnd;
+            zero(texture, userdata, (VkImageSubresourceRange){aspect, level, 1, layer, runEnd - layer});
+            layer = runEnd;
+        }
     }
-    if(desc->mappedAtCreation){
-        // TODO
-        void* mapData = NULL;
-        wgpuBufferMap(wgpuBuffer, (desc->usage & WGPUBufferUsage_MapWrite) ? WGPUMapMode_Write : WGPUMapMode_Read, 0, desc->size, &mapData);
+}
 
+// Records the clear of run, which has to be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+static void Texture_recordZero(WGPUDevice device, VkCommandBuffer commandBuffer, WGPUTexture texture, VkImageSubresourceRange run){
+    if(run.aspectMask & (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)){
+        const VkClearDepthStencilValue zeroDepthStencil zeroinit;
+        device->functions.vkCmdClearDepthStencilImage(commandBuffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zeroDepthStencil, 1, &run);
+    }else{
+        const VkClearColorValue zeroColor zeroinit;
+        device->functions.vkCmdClearColorImage(commandBuffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &zeroColor, 1, &run);
     }
-    return wgpuBuffer;
-    EXIT();
 }
 
-void wgpuBufferMap(WGPUBuffer buffer, WGPUMapMode mapmode, size_t offset, size_t size, void** data){
-    ENTRY();
-    WGPUDevice device = buffer->device;
-    if(size == WGPU_WHOLE_SIZE){
-        size = wgpuBufferGetSize(buffer);
+static void Texture_zeroRunInEncoder(WGPUTexture texture, void* encoder_, VkImageSubresourceRange run){
+    WGPUCommandEncoder encoder = (WGPUCommandEncoder)encoder_;
+    ce_trackTexture(encoder, texture, (ImageUsageSnap){
+        .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .access = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .subresource = run,
+    });
+    Texture_recordZero(encoder->device, encoder->buffer, texture, run);
+}
+
+/**
+ * @brief Zeroes run in front of a submitted command buffer, leaving it in the layout the command buffer expects
+ */
+static void Texture_zeroRunOnDevice(WGPUTexture texture, void* state_, VkImageSubresourceRange run){
+    ZeroFillState* state = (ZeroFillState*)state_;
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        // Whatever the subresource holds is discarded anyway
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture->image,
+        .subresourceRange = run,
+    };
+    state->device->functions.vkCmdPipelineBarrier(state->commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+    Texture_recordZero(state->device, state->commandBuffer, texture, run);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = state->layout;
+    state->device->functions.vkCmdPipelineBarrier(state->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+/**
+ * @brief The encoder's view of the initialization of texture, created on first use
+ */
+static TextureSubresourceInit* CommandEncoder_textureInit(WGPUCommandEncoder encoder, WGPUTexture texture){
+    TextureSubresourceInit* init = TextureSubresourceInitMap_get(&encoder->textureInits, texture);
+    if(init == NULL){
+        const uint32_t words = Texture_subresourceWords(texture);
+        uint64_t* bits = RL_CALLOC(3 * words, sizeof(uint64_t));
+        TextureSubresourceInitMap_put(&encoder->textureInits, texture, (TextureSubresourceInit){
+            .zero = bits,
+            .written = bits + words,
+            .discarded = bits + 2 * words,
+        });
+        init = TextureSubresourceInitMap_get(&encoder->textureInits, texture);
     }
-    if(buffer->latestFence){
-        if(buffer->latestFence->state == WGPUFenceState_InUse){
+    return init;
+}
+
+static void TextureSubresourceInit_freeCallback(void* texture, TextureSubresourceInit* init, void* unused){
+    RL_FREE(init->zero);
+}
+
+static void TextureSubresourceInitMap_release(TextureSubresourceInitMap* map){
+    TextureSubresourceInitMap_for_each(map, TextureSubresourceInit_freeCallback, NULL);
+    TextureSubresourceInitMap_free(map);
+}
+
+/**
+ * @brief Before commands that may read range of texture, nothing is recorded for subresources that may be initialized
+ * @details Subresources the encoder discarded itself are known to be uninitialized and cleared right here.
+ * The others the encoder didn't write yet are zeroed on submit if they're still uninitialized by then.
+ */
+static void CommandEncoder_initializeTextureRead(WGPUCommandEncoder encoder, WGPUTexture texture, VkImageSubresourceRange range){
+    if(texture->initializedSubresources == NULL)return;
+    // Without discards initialization is monotonic, so what's initialized now stays so until the encoder is submitted
+    const WGPUBool monotonic = !Texture_isDiscardable(texture);
+    if(monotonic && atomic_load_explicit(&texture->uninitializedSubresourceCount, memory_order_relaxed) == 0)return;
+    range = Texture_trackedRange(texture, range);
+    TextureSubresourceInit* init = TextureSubresourceInitMap_get(&encoder->textureInits, texture);
+    if(init && Texture_isZeroable(texture)){
+        Texture_forEachSubresourceRun(texture, range, init->discarded, Texture_zeroRunInEncoder, encoder);
+    }
+    for(uint32_t layer = range.baseArrayLayer;layer < range.baseArrayLayer + range.layerCount;layer++){
+        for(uint32_t level = range.baseMipLevel;level < range.baseMipLevel + range.levelCount;level++){
+            if(init && subresourceBitSet(init->discarded, texture, level, layer)){
+                subresourceBitAssign(init->discarded, texture, level, layer, 0);
+                subresourceBitAssign(init->written, texture, level, layer, 1);
+                continue;
+            }
+            if(init && subresourceBitSet(init->written, texture, level, layer))continue;
+            if(monotonic && Texture_isInitialized(texture, level, layer))continue;
+            if(init == NULL)init = CommandEncoder_textureInit(encoder, texture);
+            subresourceBitAssign(init->zero, texture, level, layer, 1);
+        }
+    }
+}
+
+/**
+ * @brief Notes that the encoder overwrites (written) or discards every texel of range of texture
+ */
+static void CommandEncoder_noteTextureContents(WGPUCommandEncoder encoder, WGPUTexture texture, VkImageSubresourceRange range, WGPUBool written){
+    if(texture->initializedSubresources == NULL)return;
+    const WGPUBool monotonic = !Texture_isDiscardable(texture);
+    if(monotonic && atomic_load_explicit(&texture->uninitializedSubresourceCount, memory_order_relaxed) == 0)return;
+    range = Texture_trackedRange(texture, range);
+    TextureSubresourceInit* init = TextureSubresourceInitMap_get(&encoder->textureInits, texture);
+    for(uint32_t layer = range.baseArrayLayer;layer < range.baseArrayLayer + range.layerCount;layer++){
+        for(uint32_t level = range.baseMipLevel;level < range.baseMipLevel + range.levelCount;level++){
+            if(init == NULL && monotonic && Texture_isInitialized(texture, level, layer))continue;
+            if(init == NULL)init = CommandEncoder_textureInit(encoder, texture);
+            subresourceBitAssign(init->written, texture, level, layer, written);
+            subresourceBitAssign(init->discarded, texture, level, layer, !written);
+        }
+    }
+}
+
+/**
+ * @brief Before commands that overwrite range of texture, wholeSubresources if they write every texel of it
+ */
+static void CommandEncoder_initializeTextureWrite(WGPUCommandEncoder encoder, WGPUTexture texture, VkImageSubresourceRange range, WGPUBool wholeSubresources){
+    if(wholeSubresources){
+        CommandEncoder_noteTextureContents(encoder, texture, range, 1);
+    }else{
+        CommandEncoder_initializeTextureRead(encoder, texture, range);
+    }
+}
+
+/**
+ * @brief Whether a render pass loading the single subresource range of texture has to clear it instead
+ * @details That is the case if the encoder discarded it itself. Anything else is zeroed on submit if uninitialized,
+ * except for transient attachments which transfer commands can't clear: passes clear those that were uninitialized when encoded.
+ */
+static WGPUBool CommandEncoder_loadTurnsIntoClear(WGPUCommandEncoder encoder, WGPUTexture texture, VkImageSubresourceRange range){
+    if(texture->initializedSubresources == NULL)return 0;
+    TextureSubresourceInit* init = TextureSubresourceInitMap_get(&encoder->textureInits, texture);
+    if(init && subresourceBitSet(init->discarded, texture, range.baseMipLevel, range.baseArrayLayer))return 1;
+    if(init && subresourceBitSet(init->written, texture, range.baseMipLevel, range.baseArrayLayer))return 0;
+    if(!Texture_isZeroable(texture)){
+        return !Texture_isInitialized(texture, range.baseMipLevel, range.baseArrayLayer);
+    }
+    CommandEncoder_initializeTextureRead(encoder, texture, range);
+    return 0;
+}
+
+/**
+ * @brief Applies the subresource states collected by the encoder of submitted to one texture
+ * @details Zeroes what submitted reads and nothing initialized before, then marks what it writes and unmarks what it discards.
+ * Like for buffers, the first submit to set a bit zeroes the subresource.
+ */
+static void Texture_resolveSubresourceInit(void* texture_, TextureSubresourceInit* init, void* state_){
+    WGPUTexture texture = (WGPUTexture)texture_;
+    ZeroFillState* state = (ZeroFillState*)state_;
+    const uint32_t words = Texture_subresourceWords(texture);
+    WGPUBool fill = 0;
+    for(uint32_t w = 0;w < words;w++){
+        const uint64_t claim = init->zero[w] | init->written[w];
+        const uint64_t discard = init->discarded[w];
+        const uint64_t before = atomic_fetch_or_explicit(&texture->initializedSubresources[w], claim, memory_order_relaxed);
+        const uint64_t beforeDiscard = discard ? atomic_fetch_and_explicit(&texture->initializedSubresources[w], ~discard, memory_order_relaxed) : 0;
+        init->zero[w] &= ~before;
+        fill |= init->zero[w] != 0;
+        // Only the bits this submit actually flipped are kept, for Texture_revertSubresourceInit
+        init->written[w] = claim & ~before & ~discard;
+        init->discarded[w] = discard & beforeDiscard & ~(claim & ~before);
+        atomic_fetch_sub_explicit(&texture->uninitializedSubresourceCount, bitCount64(init->written[w]), memory_order_relaxed);
+        atomic_fetch_add_explicit(&texture->uninitializedSubresourceCount, bitCount64(init->discarded[w]), memory_order_relaxed);
+    }
+    if(!fill || !Texture_isZeroable(texture))return;
+    const ImageUsageRecord* record = ImageUsageRecordMap_get(&state->submitted->resourceUsage.referencedTextures, texture);
+    state->layout = record ? record->initialLayout : texture->layout;
+    if(state->layout == VK_IMAGE_LAYOUT_UNDEFINED)state->layout = VK_IMAGE_LAYOUT_GENERAL;
+    const VkImageSubresourceRange everything = Texture_trackedRange(texture, (VkImageSubresourceRange){0, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS});
+    Texture_forEachSubresourceRun(texture, everything, init->zero, Texture_zeroRunOnDevice, state);
+    state->filled = 1;
+}
+
+static void Texture_revertSubresourceInit(void* texture_, TextureSubresourceInit* init, void* unused){
+    WGPUTexture texture = (WGPUTexture)texture_;
+    const uint32_t words = Texture_subresourceWords(texture);
+    for(uint32_t w = 0;w < words;w++){
+        atomic_fetch_and_explicit(&texture->initializedSubresources[w], ~init->written[w], memory_order_relaxed);
+        atomic_fetch_or_explicit(&texture->initializedSubresources[w], init->discarded[w], memory_order_relaxed);
+        atomic_fetch_add_explicit(&texture->uninitializedSubresourceCount, bitCount64(init->written[w]), memory_order_relaxed);
+        atomic_fetch_sub_explicit(&texture->uninitializedSubresourceCount, bitCount64(init->discarded[w]), memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Applies the initialization states collected by the encoder of submitted to the buffers and textures it uses
+ * @details Zero fills of what submitted reads and nothing initialized before go into commandBuffer, which executes
+ * right before submitted. Has to run in submission order, Queue_settleInitialization follows once the submit result is known.
+ */
+static void Queue_initializeResources(WGPUDevice device, VkCommandBuffer commandBuffer, WGPUCommandBuffer submitted){
+    if(submitted->bufferChunkInits.current_size == 0 && submitted->textureInits.current_size == 0)return;
+    ZeroFillState state = {
+        .commandBuffer = commandBuffer,
+        .device = device,
+        .submitted = submitted,
+    };
+    BufferChunkInitMap_for_each(&submitted->bufferChunkInits, Buffer_resolveChunkInit, &state);
+    TextureSubresourceInitMap_for_each(&submitted->textureInits, Texture_resolveSubresourceInit, &state);
+    if(state.filled){
+        const VkMemoryBarrier memoryBarrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+        };
+        device->functions.vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &memoryBarrier, 0, NULL, 0, NULL);
+    }
+}
+
+/**
+ * @brief Drops the initialization states of submitted after its submit, reverting what Queue_initializeResources marked if it failed
+ */
+static void Queue_settleInitialization(WGPUCommandBuffer submitted, WGPUBool succeeded){
+    if(!succeeded){
+        BufferChunkInitMap_for_each(&submitted->bufferChunkInits, Buffer_revertChunkInit, NULL);
+        TextureSubresourceInitMap_for_each(&submitted->textureInits, Texture_revertSubresourceInit, NULL);
+    }
+    BufferChunkInitMap_clear(&submitted->bufferChunkInits);
+    TextureSubresourceInitMap_release(&submitted->textureInits);
+}
+
+/**
+ * @brief Whether a copy of size at origin covers the whole of mip level of texture
+ */
+static inline WGPUBool Texture_copyCoversLevel(WGPUTexture texture, uint32_t level, const WGPUOrigin3D* origin, const WGPUExtent3D* size){
+    const uint32_t width  = texture->width  >> level ? texture->width  >> level : 1;
+    const uint32_t height = texture->height >> level ? texture->height >> level : 1;
+    if(origin->x != 0 || origin->y != 0 || size->width < width || size->height < height){
+        return 0;
+    }
+    if(texture->dimension == VK_IMAGE_TYPE_3D){
+        const uint32_t depth = texture->depthOrArrayLayers >> level ? texture->depthOrArrayLayers >> level : 1;
+        return origin->z == 0 && size->depthOrArrayLayers >= depth;
+    }
+    return 1;
+}
+
+/**
+ * @brief Range of a linear texel copy in a buffer, an over-estimation unless the rows are tightly packed
+ */
+static inline void TexelCopyBufferLayout_range(const WGPUTexelCopyBufferLayout* layout, WGPUTexture texture, const WGPUExtent3D* size, uint64_t* rangeSize, WGPUBool* exact){
+    const uint64_t tightRow = (uint64_t)size->width * vkFormatSize(texture->format);
+    const uint64_t bytesPerRow = (layout->bytesPerRow == WGPU_COPY_STRIDE_UNDEFINED || layout->bytesPerRow == 0) ? tightRow : layout->bytesPerRow;
+    const uint64_t rowsPerImage = (layout->rowsPerImage == WGPU_COPY_STRIDE_UNDEFINED || layout->rowsPerImage == 0) ? size->height : layout->rowsPerImage;
+    *rangeSize = bytesPerRow * rowsPerImage * (size->depthOrArrayLayers ? size->depthOrArrayLayers : 1);
+    *exact = !isCompressedFormatVk(texture->format) && bytesPerRow == tightRow && rowsPerImage == size->height;
+}
+
+/**
+ * @brief Turns loads of attachments the encoder knows to be uninitialized into clears to zero and notes what the pass leaves initialized
+ */
+static void CommandEncoder_initializeAttachments(WGPUCommandEncoder encoder, RenderPassCommandBegin* beginInfo){
+    for(uint32_t i = 0;i < beginInfo->colorAttachmentCount;i++){
+        WGPURenderPassColorAttachment* attachment = beginInfo->colorAttachments + i;
+        WGPUTexture texture = attachment->view->texture;
+        const VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, attachment->view->subresourceRange.baseMipLevel, 1, attachment->view->subresourceRange.baseArrayLayer, 1};
+        if(texture->dimension == VK_IMAGE_TYPE_3D){
+            // A pass only renders one slice, the others of the level need zeroing on their own
+            CommandEncoder_initializeTextureRead(encoder, texture, range);
+        }
+        else if(attachment->loadOp == WGPULoadOp_Load && CommandEncoder_loadTurnsIntoClear(encoder, texture, range)){
+            attachment->loadOp = WGPULoadOp_Clear;
+            attachment->clearValue = (WGPUColor){0};
+        }
+        CommandEncoder_noteTextureContents(encoder, texture, range, attachment->storeOp != WGPUStoreOp_Discard);
+        if(attachment->resolveTarget){
+            const VkImageSubresourceRange resolveRange = {VK_IMAGE_ASPECT_COLOR_BIT, attachment->resolveTarget->subresourceRange.baseMipLevel, 1, attachment->resolveTarget->subresourceRange.baseArrayLayer, 1};
+            CommandEncoder_noteTextureContents(encoder, attachment->resolveTarget->texture, resolveRange, 1);
+        }
+    }
+    if(beginInfo->depthAttachmentPresent){
+        WGPURenderPassDepthStencilAttachment* attachment = &beginInfo->depthStencilAttachment;
+        WGPUTexture texture = attachment->view->texture;
+        const VkImageSubresourceRange range = {toVulkanAspectMaskVk(WGPUTextureAspect_All, texture->format), attachment->view->subresourceRange.baseMipLevel, 1, attachment->view->subresourceRange.baseArrayLayer, 1};
+        if(attachment->depthLoadOp == WGPULoadOp_Load && CommandEncoder_loadTurnsIntoClear(encoder, texture, range)){
+            attachment->depthLoadOp = WGPULoadOp_Clear;
+            attachment->depthClearValue = 0.0f;
+        }
+        const WGPUBool discarded = attachment->depthStoreOp == WGPUStoreOp_Discard && attachment->stencilStoreOp != WGPUStoreOp_Store;
+        CommandEncoder_noteTextureContents(encoder, texture, range, !discarded);
+    }
+}
+
+
+WGPUBuffer wgpuDeviceCreateBuffer(WGPUDevice device, const WGPUBufferDescriptor* desc){
+    ENTRY();
+    //vmaCreateAllocator(const VmaAllocatorCreateInfo * _Nonnull pCreateInfo, VmaAllocator  _Nullable * _Nonnull pAllocator)
+    
+    if(desc->usage & WGPUBufferUsage_MapRead){
+        if(desc->usage & ~(WGPUBufferUsage_CopyDst | WGPUBufferUsage_MapRead)){
+            DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("WGPUBufferUsage_MapRead used with something other than WGPUBufferUsage_CopyDst"));
+        }
+    }
+    if(desc->usage & WGPUBufferUsage_MapWrite){
+        if(desc->usage & ~(WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite)){
+            DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("WGPUBufferUsage_MapWrite used with something other than WGPUBufferUsage_CopySrc"));
+        }
+    }
+    WGPUBuffer wgpuBuffer = RL_CALLOC(1, sizeof(WGPUBufferImpl));
+
+    uint32_t cacheIndex = device->submittedFrames % framesInFlight;
+
+    wgpuBuffer->device = device;
+    wgpuBuffer->cacheIndex = cacheIndex;
+    wgpuBuffer->refCount = 1;
+    wgpuBuffer->usage = desc->usage;
+    wgpuBuffer->capacity = desc->size;
+    wgpuBuffer->zeroInitChunkSize = ((desc->size + 63) / 64 + 3) & ~(uint64_t)3;
+    
+    const VkBufferCreateInfo bufferDesc = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size = desc->size,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        // Lazy zero-initialization fills chunks with vkCmdFillBuffer whatever usage was asked for
+        .usage = toVulkanBufferUsage(desc->usage) | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    };
+    
+    VkMemoryPropertyFlags propertyToFind = 0;
+    if(desc->usage & (WGPUBufferUsage_MapRead | WGPUBufferUsage_MapWrite)){
+        propertyToFind = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+    else{
+        // propertyToFind = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        propertyToFind = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    }
+
+    #if USE_VMA_ALLOCATOR == 1
+    VmaAllocationCreateInfo vallocInfo = {
+        .preferredFlags = propertyToFind,
+    };
+    VmaAllocation allocation zeroinit;
+    VmaAllocationInfo allocationInfo zeroinit;
+    VkResult vmabufferCreateResult = vmaCreateBuffer(device->allocator, &bufferDesc, &vallocInfo, &wgpuBuffer->buffer, &allocation, &allocationInfo);
+
+    if(vmabufferCreateResult != VK_SUCCESS){
+        DeviceCallback(device, WGPUErrorType_OutOfMemory, STRVIEW("Failed to create allocator"));
+        TRACELOG(WGPU_LOG_ERROR, "Could not allocate buffer: %s", vkErrorString(vmabufferCreateResult));
+        RL_FREE(wgpuBuffer);
+        return NULL;
+    }
+    wgpuBuffer->vmaAllocation = allocation;
+    wgpuBuffer->allocationType = AllocationTypeVMA;
+    #else
+    device->functions.vkCreateBuffer(device->device, &bufferDesc, NULL, &wgpuBuffer->buffer);
+    wgvkAllocation allocation = {0};
+    VkMemoryRequirements requirements = {0};
+    device->functions.vkGetBufferMemoryRequirements(device->device, wgpuBuffer->buffer, &requirements);
+    if(desc->usage & WGPUBufferUsage_Raytracing){
+        requirements.alignment = 256;
+    }
+    bool ret = wgvkAllocator_alloc(&device->builtinAllocator, &requirements, propertyToFind, &allocation);
+    wgpuBuffer->allocationType = AllocationTypeBuiltin;
+    wgpuBuffer->builtinAllocation = allocation;
+    device->functions.vkBindBufferMemory(device->device, wgpuBuffer->buffer, allocation.pool->chunks[allocation.chunk_index].memory, allocation.offset);
+    #endif
+    wgpuBuffer->memoryProperties = propertyToFind;
+
+    if(desc->usage & WGPUBufferUsage_ShaderDeviceAddress){
+        const VkBufferDeviceAddressInfo bdai = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO_KHR,
+            .buffer = wgpuBuffer->buffer
+        };
+        wgpuBuffer->address = device->functions.vkGetBufferDeviceAddress(device->device, &bdai);
+    }
+    if(desc->mappedAtCreation){
+        // TODO
+        void* mapData = NULL;
+        wgpuBufferMap(wgpuBuffer, (desc->usage & WGPUBufferUsage_MapWrite) ? WGPUMapMode_Write : WGPUMapMode_Read, 0, desc->size, &mapData);
+
+    }
+    return wgpuBuffer;
+    EXIT();
+}
+
+void wgpuBufferMap(WGPUBuffer buffer, WGPUMapMode mapmode, size_t offset, size_t size, void** data){
+    ENTRY();
+    WGPUDevice device = buffer->device;
+    if(size == WGPU_WHOLE_SIZE){
+        size = wgpuBufferGetSize(buffer);
+    }
+    if(buffer->latestFence){
+        if(buffer->latestFence->state == WGPUFenceState_InUse){
             wgpuFenceWait(buffer->latestFence, ((uint64_t)1) << 40);
         }
         wgpuFenceRelease(buffer->latestFence);
@@ -2116,11 +2912,13 @@ void wgpuBufferMap(WGPUBuffer buffer, WGPUMapMode mapmode, size_t offset, size_t
             }
             *data = (void*)(((uint8_t*)chunk->mapped) + allocation->offset + offset);
             buffer->mappedRange = *data;
+            Buffer_zeroUninitializedOnHost(buffer, ((uint8_t*)chunk->mapped) + allocation->offset, offset, size);
         }break;
         #if USE_VMA_ALLOCATOR == 1
         case AllocationTypeVMA: {
             vmaMapMemory(buffer->device->allocator, buffer->vmaAllocation, data);
             buffer->mappedRange = *data;
+            Buffer_zeroUninitializedOnHost(buffer, *data, offset, size);
         }break;
         #endif
         case AllocationTypeJustMemory: {
@@ -2233,6 +3031,8 @@ void wgpuQueueWriteBuffer(WGPUQueue cSelf, WGPUBuffer buffer, uint64_t bufferOff
     //);
     if(buffer->memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT){
         void* mappedMemory = NULL;
+        // Only chunks the write covers partially need zeroing when mapped
+        Buffer_markInitialized(buffer, bufferOffset, size);
         wgpuBufferMap(buffer, WGPUMapMode_Write, bufferOffset, size, &mappedMemory);
         
         if (mappedMemory != NULL) {
@@ -2247,21 +3047,337 @@ void wgpuQueueWriteBuffer(WGPUQueue cSelf, WGPUBuffer buffer, uint64_t bufferOff
         stDesc.size = size;
         stDesc.usage = WGPUBufferUsage_MapWrite;
         WGPUBuffer stagingBuffer = wgpuDeviceCreateBuffer(cSelf->device, &stDesc);
-        wgpuQueueWriteBuffer(cSelf, stagingBuffer, bufferOffset, data, size);
+        wgpuQueueWriteBuffer(cSelf, stagingBuffer, 0, data, size);
         wgpuCommandEncoderCopyBufferToBuffer(cSelf->presubmitCache, stagingBuffer, 0, buffer, bufferOffset, size);
         wgpuBufferRelease(stagingBuffer);
     }
     EXIT();
 }
 
+/**
+ * @brief Round to nearest even float to half conversion, overflow goes to infinity and NaNs stay quiet NaNs (like F16C)
+ */
+static inline uint16_t floatToHalf(float value){
+    union { uint32_t u; float f; } v = { .f = value };
+    const union { uint32_t u; float f; } denormMagic = { .u = ((127 - 15) + (23 - 10) + 1) << 23 };
+    const uint32_t sign = v.u & 0x80000000u;
+    uint16_t ret;
+    v.u ^= sign;
+    if(v.u >= ((127 + 16) << 23)){
+        ret = v.u > (255u << 23) ? (uint16_t)(0x7E00 | ((v.u >> 13) & 0x1FF)) : 0x7C00;
+    }
+    else if(v.u < (113u << 23)){
+        // Half denormals: the float addition rounds the mantissa into place
+        v.f += denormMagic.f;
+        ret = (uint16_t)(v.u - denormMagic.u);
+    }
+    else{
+        const uint32_t mantissaOdd = (v.u >> 13) & 1;
+        v.u += ((uint32_t)(15 - 127) << 23) + 0xFFF;
+        v.u += mantissaOdd;
+        ret = (uint16_t)(v.u >> 13);
+    }
+    return ret | (uint16_t)(sign >> 16);
+}
+
+#if WGVK_X86_TEXEL_CONVERSION == 1
+// The x86 kernels are compiled for their instruction set regardless of the build flags and picked by cpuid
+#if defined(__GNUC__) || defined(__clang__)
+    #define WGVK_TEXEL_TARGET(features) __attribute__((target(features)))
+#else
+    #define WGVK_TEXEL_TARGET(features)
+#endif
+
+enum {
+    TexelCpu_SSE2  = 1 << 0,
+    TexelCpu_SSSE3 = 1 << 1,
+    TexelCpu_AVX2  = 1 << 2,
+    TexelCpu_F16C  = 1 << 3,
+    TexelCpu_Known = 1 << 30,
+};
+
+static uint32_t TexelRow_cpuFeatures(void){
+    static Atomar(uint32_t) cached = 0;
+    uint32_t features = atomic_load_explicit(&cached, memory_order_relaxed);
+    if(features & TexelCpu_Known){
+        return features;
+    }
+    features = TexelCpu_Known;
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    const uint32_t ecx = (uint32_t)info[2], edx = (uint32_t)info[3];
+    // AVX state has to be enabled by the OS (OSXSAVE and XCR0 YMM bits) before AVX2 or F16C can be used
+    const int avxUsable = (ecx & (1u << 27)) && (ecx & (1u << 28)) && (_xgetbv(0) & 6) == 6;
+    if(edx & (1u << 26)) features |= TexelCpu_SSE2;
+    if(ecx & (1u << 9)) features |= TexelCpu_SSSE3;
+    if(avxUsable && (ecx & (1u << 29))) features |= TexelCpu_F16C;
+    if(avxUsable && maxLeaf >= 7){
+        __cpuidex(info, 7, 0);
+        if((uint32_t)info[1] & (1u << 5)) features |= TexelCpu_AVX2;
+    }
+    #else
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")) features |= TexelCpu_SSE2;
+    if(__builtin_cpu_supports("ssse3")) features |= TexelCpu_SSSE3;
+    if(__builtin_cpu_supports("avx2")) features |= TexelCpu_AVX2;
+    // F16C has no __builtin_cpu_supports name everywhere, it is usable whenever AVX is (OS saved YMM state)
+    unsigned int eax, ebx, ecx, edx;
+    if(__builtin_cpu_supports("avx") && __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C)){
+        features |= TexelCpu_F16C;
+    }
+    #endif
+    atomic_store_explicit(&cached, features, memory_order_relaxed);
+    return features;
+}
+
+/**
+ * @brief The x86 kernels return how many texels (or components) they converted, the scalar loops finish the rest
+ */
+WGVK_TEXEL_TARGET("ssse3") static size_t TexelRow_expandRGB8SSSE3(uint8_t* dst, const uint8_t* src, size_t texelCount){
+    size_t i = 0;
+    const __m128i expand = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    // 16 byte loads of which 12 are used, stop while the load stays inside the row
+    for(;i + 6 <= texelCount;i += 4){
+        const __m128i rgb = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, expand), alpha));
+    }
+    return i;
+}
+
+WGVK_TEXEL_TARGET("avx2") static size_t TexelRow_swapRB8AVX2(uint8_t* dst, const uint8_t* src, size_t texelCount){
+    size_t i = 0;
+    const __m256i swap256 = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    for(;i + 8 <= texelCount;i += 8){
+        const __m256i texels = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(texels, swap256));
+    }
+    return i;
+}
+
+WGVK_TEXEL_TARGET("sse2") static size_t TexelRow_swapRB8SSE2(uint8_t* dst, const uint8_t* src, size_t texelCount){
+    size_t i = 0;
+    const __m128i greenAlpha = _mm_set1_epi32((int)0xFF00FF00u);
+    const __m128i low = _mm_set1_epi32(0x000000FF);
+    for(;i + 4 <= texelCount;i += 4){
+        const __m128i texels = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        const __m128i red  = _mm_slli_epi32(_mm_and_si128(texels, low), 16);
+        const __m128i blue = _mm_and_si128(_mm_srli_epi32(texels, 16), low);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_and_si128(texels, greenAlpha), _mm_or_si128(red, blue)));
+    }
+    return i;
+}
+
+WGVK_TEXEL_TARGET("avx,f16c") static size_t TexelRow_floatToHalfF16C(uint8_t* dst, const uint8_t* src, size_t componentCount){
+    size_t i = 0;
+    for(;i + 8 <= componentCount;i += 8){
+        const __m256 floats = _mm256_loadu_ps((const float*)(src + i * 4));
+        _mm_storeu_si128((__m128i*)(dst + i * 2), _mm256_cvtps_ph(floats, _MM_FROUND_TO_NEAREST_INT));
+    }
+    return i;
+}
+#endif
+
+static void TexelRow_expandRGB8(uint8_t* dst, const uint8_t* src, size_t texelCount){
+    size_t i = 0;
+    #if WGVK_X86_TEXEL_CONVERSION == 1
+    if(TexelRow_cpuFeatures() & TexelCpu_SSSE3){
+        i = TexelRow_expandRGB8SSSE3(dst, src, texelCount);
+    }
+    #elif WGVK_SIMD_TEXEL_CONVERSION == 1 && defined(__ARM_NEON)
+    for(;i + 16 <= texelCount;i += 16){
+        const uint8x16x3_t rgb = vld3q_u8(src + i * 3);
+        const uint8x16x4_t rgba = {{rgb.val[0], rgb.val[1], rgb.val[2], vdupq_n_u8(0xFF)}};
+        vst4q_u8(dst + i * 4, rgba);
+    }
+    #endif
+    for(;i < texelCount;i++){
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 0xFF;
+    }
+}
+
+static void TexelRow_swapRB8(uint8_t* dst, const uint8_t* src, size_t texelCount){
+    size_t i = 0;
+    #if WGVK_X86_TEXEL_CONVERSION == 1
+    const uint32_t features = TexelRow_cpuFeatures();
+    if(features & TexelCpu_AVX2){
+        i = TexelRow_swapRB8AVX2(dst, src, texelCount);
+    }
+    if(features & TexelCpu_SSE2){
+        i += TexelRow_swapRB8SSE2(dst + i * 4, src + i * 4, texelCount - i);
+    }
+    #elif WGVK_SIMD_TEXEL_CONVERSION == 1 && defined(__ARM_NEON)
+    for(;i + 16 <= texelCount;i += 16){
+        uint8x16x4_t texels = vld4q_u8(src + i * 4);
+        const uint8x16_t red = texels.val[0];
+        texels.val[0] = texels.val[2];
+        texels.val[2] = red;
+        vst4q_u8(dst + i * 4, texels);
+    }
+    #endif
+    for(;i < texelCount;i++){
+        dst[i * 4 + 0] = src[i * 4 + 2];
+        dst[i * 4 + 1] = src[i * 4 + 1];
+        dst[i * 4 + 2] = src[i * 4 + 0];
+        dst[i * 4 + 3] = src[i * 4 + 3];
+    }
+}
+
+static void TexelRow_floatToHalf(uint8_t* dst, const uint8_t* src, size_t componentCount){
+    size_t i = 0;
+    #if WGVK_X86_TEXEL_CONVERSION == 1
+    if(TexelRow_cpuFeatures() & TexelCpu_F16C){
+        i = TexelRow_floatToHalfF16C(dst, src, componentCount);
+    }
+    #elif WGVK_SIMD_TEXEL_CONVERSION == 1 && defined(__ARM_NEON) && defined(__aarch64__)
+    for(;i + 4 <= componentCount;i += 4){
+        const float32x4_t floats = vld1q_f32((const float*)(src + i * 4));
+        vst1_u16((uint16_t*)(dst + i * 2), vreinterpret_u16_f16(vcvt_f16_f32(floats)));
+    }
+    #endif
+    for(;i < componentCount;i++){
+        float value;
+        memcpy(&value, src + i * 4, sizeof(float));
+        const uint16_t half = floatToHalf(value);
+        memcpy(dst + i * 2, &half, sizeof(uint16_t));
+    }
+}
+
+static void TexelRow_convert(WGPUTexelConversion conversion, uint8_t* dst, const uint8_t* src, size_t texelCount, size_t dstTexelSize){
+    switch(conversion){
+        case WGPUTexelConversion_RGB8ToRGBA8: TexelRow_expandRGB8(dst, src, texelCount);break;
+        case WGPUTexelConversion_SwapRB8: TexelRow_swapRB8(dst, src, texelCount);break;
+        case WGPUTexelConversion_Float32ToFloat16: TexelRow_floatToHalf(dst, src, texelCount * dstTexelSize / 2);break;
+        default: memcpy(dst, src, texelCount * dstTexelSize);break;
+    }
+}
+
+/**
+ * @brief Buffer side size of one texel of the aspect a copy addresses, UINT32_MAX for aspects without a packed texel size
+ */
+static uint32_t Texture_copyTexelSize(VkFormat format, WGPUTextureAspect aspect){
+    switch(aspect){
+        case WGPUTextureAspect_StencilOnly: return 1;
+        case WGPUTextureAspect_DepthOnly: {
+            switch(format){
+                case VK_FORMAT_D16_UNORM:
+                case VK_FORMAT_D16_UNORM_S8_UINT: return 2;
+                case VK_FORMAT_X8_D24_UNORM_PACK32:
+                case VK_FORMAT_D24_UNORM_S8_UINT:
+                case VK_FORMAT_D32_SFLOAT:
+                case VK_FORMAT_D32_SFLOAT_S8_UINT: return 4;
+                default: break;
+            }
+        }break;
+        case WGPUTextureAspect_Plane0Only:
+        case WGPUTextureAspect_Plane1Only:
+        case WGPUTextureAspect_Plane2Only: return UINT32_MAX;
+        default: break;
+    }
+    return vkFormatSize(format);
+}
+
+/**
+ * @brief Writes the texels of data tightly packed and converted into a staging buffer and copies that into the destination
+ */
+static void Queue_writeTexture(WGPUQueue queue, const WGPUTexelCopyTextureInfo* destination, const void* data, size_t dataSize, const WGPUTexelCopyBufferLayout* dataLayout, const WGPUExtent3D* writeSize, WGPUTexelConversion conversion){
+    const VkFormat format = destination->texture->format;
+    const size_t dstTexelSize = Texture_copyTexelSize(format, destination->aspect);
+    size_t srcTexelSize = dstTexelSize;
+    WGPUBool valid = 1;
+    switch(conversion){
+        case WGPUTexelConversion_None: break;
+        case WGPUTexelConversion_RGB8ToRGBA8: srcTexelSize = 3; valid = dstTexelSize == 4; break;
+        case WGPUTexelConversion_SwapRB8: valid = dstTexelSize == 4; break;
+        case WGPUTexelConversion_Float32ToFloat16: {
+            srcTexelSize = dstTexelSize * 2;
+            valid = format == VK_FORMAT_R16_SFLOAT || format == VK_FORMAT_R16G16_SFLOAT || format == VK_FORMAT_R16G16B16A16_SFLOAT;
+        }break;
+        default: valid = 0; break;
+    }
+    if(!valid || dstTexelSize == UINT32_MAX || isCompressedFormatVk(format)){
+        DeviceCallback(queue->device, WGPUErrorType_Validation, STRVIEW("wgpuQueueWriteTextureConverted: conversion doesn't apply to the destination format"));
+        return;
+    }
+    const uint64_t width = writeSize->width, height = writeSize->height, depth = writeSize->depthOrArrayLayers;
+    if(width == 0 || height == 0 || depth == 0){
+        return;
+    }
+    const uint64_t srcRowSize = width * srcTexelSize;
+    const uint64_t srcBytesPerRow = (dataLayout->bytesPerRow == WGPU_COPY_STRIDE_UNDEFINED || dataLayout->bytesPerRow == 0) ? srcRowSize : dataLayout->bytesPerRow;
+    const uint64_t rowsPerImage = (dataLayout->rowsPerImage == WGPU_COPY_STRIDE_UNDEFINED || dataLayout->rowsPerImage == 0) ? height : dataLayout->rowsPerImage;
+    const uint64_t lastByte = dataLayout->offset + (depth - 1) * rowsPerImage * srcBytesPerRow + (height - 1) * srcBytesPerRow + srcRowSize;
+    if(srcBytesPerRow < srcRowSize || rowsPerImage < height || lastByte > dataSize){
+        DeviceCallback(queue->device, WGPUErrorType_Validation, STRVIEW("wgpuQueueWriteTexture: data is too small for the layout and size"));
+        return;
+    }
+    const uint64_t dstRowSize = width * dstTexelSize;
+    const uint64_t stagingSize = dstRowSize * height * depth;
+
+    const WGPUBufferDescriptor bdesc = {
+        .size = stagingSize,
+        .usage = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite,
+    };
+    WGPUBuffer stagingBuffer = wgpuDeviceCreateBuffer(queue->device, &bdesc);
+    if(stagingBuffer == NULL){
+        return;
+    }
+    uint8_t* mappedMemory = NULL;
+    Buffer_markInitialized(stagingBuffer, 0, stagingSize);
+    wgpuBufferMap(stagingBuffer, WGPUMapMode_Write, 0, stagingSize, (void**)&mappedMemory);
+    if(mappedMemory != NULL){
+        const uint8_t* source = (const uint8_t*)data + dataLayout->offset;
+        if(conversion == WGPUTexelConversion_None && srcBytesPerRow == dstRowSize && rowsPerImage == height){
+            memcpy(mappedMemory, source, stagingSize);
+        }
+        else{
+            for(uint64_t z = 0;z < depth;z++){
+                for(uint64_t y = 0;y < height;y++){
+                    TexelRow_convert(conversion, mappedMemory + (z * height + y) * dstRowSize, source + (z * rowsPerImage + y) * srcBytesPerRow, width, dstTexelSize);
+                }
+            }
+        }
+        wgpuBufferUnmap(stagingBuffer);
+    }
+    const WGPUTexelCopyBufferInfo stagingSource = {
+        .buffer = stagingBuffer,
+        .layout = {
+            .offset = 0,
+            .bytesPerRow = (uint32_t)dstRowSize,
+            .rowsPerImage = (uint32_t)height,
+        }
+    };
+    wgpuCommandEncoderCopyBufferToTexture(queue->presubmitCache, &stagingSource, destination, writeSize);
+    wgpuBufferRelease(stagingBuffer);
+}
+
+void wgpuQueueWriteTextureConverted(WGPUQueue queue, const WGPUTexelCopyTextureInfo* destination, const void* data, size_t dataSize, const WGPUTexelCopyBufferLayout* dataLayout, const WGPUExtent3D* writeSize, WGPUTexelConversion conversion){
+    ENTRY();
+    Queue_writeTexture(queue, destination, data, dataSize, dataLayout, writeSize, conversion);
+    EXIT();
+}
+
 void wgpuQueueWriteTexture(WGPUQueue queue, const WGPUTexelCopyTextureInfo* destination, const void* data, size_t dataSize, const WGPUTexelCopyBufferLayout* dataLayout, const WGPUExtent3D* writeSize){
     ENTRY();
+    // Texel formats are repacked into tight rows of the written aspect, block compressed and planar data is staged as is
+    if(!isCompressedFormatVk(destination->texture->format) && Texture_copyTexelSize(destination->texture->format, destination->aspect) != UINT32_MAX){
+        Queue_writeTexture(queue, destination, data, dataSize, dataLayout, writeSize, WGPUTexelConversion_None);
+        EXIT();
+        return;
+    }
 
     WGPUBufferDescriptor bdesc zeroinit;
     bdesc.size = dataSize;
     bdesc.usage = WGPUBufferUsage_CopySrc | WGPUBufferUsage_MapWrite;
     WGPUBuffer stagingBuffer = wgpuDeviceCreateBuffer(queue->device, &bdesc);
     void* mappedMemory = NULL;
+    Buffer_markInitialized(stagingBuffer, 0, dataSize);
     wgpuBufferMap(stagingBuffer, WGPUMapMode_Write, 0, dataSize, &mappedMemory);
     if(mappedMemory != NULL){
         memcpy(mappedMemory, data, dataSize);
@@ -2432,19 +3548,21 @@ WGPUTexture wgpuDeviceCreateTexture(WGPUDevice device, const WGPUTextureDescript
     }
     WGPUTexture ret = RL_CALLOC(1, sizeof(WGPUTextureImpl));
     ret->usage = toVulkanTextureUsage(descriptor->usage, descriptor->format);
-    ret->dimension = toVulkanTextureDimension(descriptor->dimension);
+    ret->dimension = toVulkanTextureDimension(descriptor->dimension == WGPUTextureDimension_Undefined ? WGPUTextureDimension_2D : descriptor->dimension);
+    // WebGPU folds depth slices and array layers into depthOrArrayLayers; Vulkan keeps them apart
+    const bool is3D = ret->dimension == VK_IMAGE_TYPE_3D;
     VkImageCreateInfo imageInfo = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .imageType = VK_IMAGE_TYPE_2D,
+        .imageType = ret->dimension,
         .extent = {
             .width = descriptor->size.width,
-            .height = descriptor->size.height,
-            .depth = 1
+            .height = ret->dimension == VK_IMAGE_TYPE_1D ? 1 : descriptor->size.height,
+            .depth = is3D ? descriptor->size.depthOrArrayLayers : 1
         },
         .mipLevels = descriptor->mipLevelCount,
-        .arrayLayers = descriptor->size.depthOrArrayLayers,
+        .arrayLayers = is3D ? 1 : descriptor->size.depthOrArrayLayers,
         .format = toVulkanPixelFormat(descriptor->format),
         .tiling = VK_IMAGE_TILING_OPTIMAL,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -2454,7 +3572,25 @@ WGPUTexture wgpuDeviceCreateTexture(WGPUDevice device, const WGPUTextureDescript
     };
 
     if(descriptor->viewFormats == NULL || descriptor->viewFormatCount > 1 || descriptor->viewFormats[0] != descriptor->format){
-        imageInfo.flags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+        imageInfo.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+    }
+    #if WGVK_IMPLICIT_TRANSIENT_ATTACHMENTS == 1
+    // MSAA color and depth/stencil textures with no usage besides RenderAttachment are mostly discarded at the end of
+    // every pass, so tile based GPUs can keep them in tile memory without ever backing them with real memory
+    const bool attachmentOnly = (descriptor->usage & ~WGPUTextureUsage_TransientAttachment) == WGPUTextureUsage_RenderAttachment;
+    const bool tileResident = descriptor->sampleCount > 1 || isDepthFormat(descriptor->format) || descriptor->format == WGPUTextureFormat_Stencil8;
+    if(attachmentOnly && tileResident && imageInfo.imageType == VK_IMAGE_TYPE_2D && imageInfo.mipLevels == 1){
+        imageInfo.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        ret->usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    }
+    #endif
+    // Lazy zero-initialization clears subresources that are read before being written
+    if(!(imageInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)){
+        imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    // The descriptor carries no view dimension hint, so any square 2D texture with a multiple of six layers may be viewed as a cube
+    if(imageInfo.imageType == VK_IMAGE_TYPE_2D && imageInfo.extent.width == imageInfo.extent.height && imageInfo.arrayLayers >= 6 && imageInfo.arrayLayers % 6 == 0 && imageInfo.samples == VK_SAMPLE_COUNT_1_BIT){
+        imageInfo.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
     }
     
     VkImage image zeroinit;
@@ -2467,11 +3603,18 @@ WGPUTexture wgpuDeviceCreateTexture(WGPUDevice device, const WGPUTextureDescript
     VkMemoryAllocateInfo allocInfo zeroinit;
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memReq.size;
-    allocInfo.memoryTypeIndex = findMemoryType(
-        device->adapter,
-        memReq.memoryTypeBits, 
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    );
+    allocInfo.memoryTypeIndex = ~0u;
+    if(imageInfo.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT){
+        // Lazily allocated memory is only committed when a pass actually needs to spill or store the attachment
+        allocInfo.memoryTypeIndex = findMemoryTypeIfPresent(device->adapter, memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    }
+    if(allocInfo.memoryTypeIndex == ~0u){
+        allocInfo.memoryTypeIndex = findMemoryType(
+            device->adapter,
+            memReq.memoryTypeBits, 
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+        );
+    }
     //wgvkAllocation allocation = {0};
     //wgvkAllocator_alloc(&device->builtinAllocator, &memReq, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &allocation);
     
@@ -2492,6 +3635,8 @@ WGPUTexture wgpuDeviceCreateTexture(WGPUDevice device, const WGPUTextureDescript
     ret->refCount = 1;
     ret->mipLevels = descriptor->mipLevelCount;
     ret->memory = imageMemory;
+    ret->uninitializedSubresourceCount = ret->mipLevels * (is3D ? 1 : ret->depthOrArrayLayers);
+    ret->initializedSubresources = RL_CALLOC(Texture_subresourceWords(ret), sizeof(uint64_t));
     Texture_ViewCache_init(&ret->viewCache);
     EXIT();
     return ret;
@@ -2548,6 +3693,170 @@ static inline VkDescriptorType contiguousDescriptorType(uint32_t cont){
 }
 #define DESCRIPTOR_TYPE_UPPER_LIMIT 32
 
+static WGPUBool supportsUpdateAfterBind(const WGVKCapabilities* capabilities, VkDescriptorType type){
+    switch(type){
+        case VK_DESCRIPTOR_TYPE_SAMPLER:        // [[fallthrough]];
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:  return capabilities->updateAfterBindSampledImage;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:  return capabilities->updateAfterBindStorageImage;
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return capabilities->updateAfterBindUniformBuffer;
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return capabilities->updateAfterBindStorageBuffer;
+        default: return 0;
+    }
+}
+
+// Pool for exactly one set of the layout, array bindings counted with their full size
+static VkDescriptorPool BindGroupLayout_createPool(WGPUDevice device, WGPUBindGroupLayout layout){
+    uint32_t counts[DESCRIPTOR_TYPE_UPPER_LIMIT] = {0};
+
+    for(uint32_t i = 0;i < layout->entryCount;i++){
+        counts[descriptorTypeContiguous(extractVkDescriptorType(layout->entries + i))] += layout->arraySizes[i];
+    }
+    VkDescriptorPoolSize sizes[DESCRIPTOR_TYPE_UPPER_LIMIT];
+    uint32_t VkDescriptorPoolSizeCount = 0;
+    for(uint32_t i = 0;i < DESCRIPTOR_TYPE_UPPER_LIMIT;i++){
+        if(counts[i] != 0){
+            sizes[VkDescriptorPoolSizeCount++] = (VkDescriptorPoolSize){
+                .type = contiguousDescriptorType(i), 
+                .descriptorCount = counts[i]
+            };
+        }
+    }
+    const VkDescriptorPoolCreateInfo dpci = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = layout->updateAfterBind ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT : 0,
+        .maxSets = 1,
+        .poolSizeCount = VkDescriptorPoolSizeCount,
+        .pPoolSizes = sizes
+    };
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    device->functions.vkCreateDescriptorPool(device->device, &dpci, NULL, &pool);
+    return pool;
+}
+
+static void BindGroup_computeBufferUsages(WGPUBindGroup bindGroup, const WGPUBindGroupDescriptor* bgdesc){
+    RL_FREE(bindGroup->bufferUsages);
+    bindGroup->bufferUsages = RL_CALLOC(bgdesc->entryCount ? bgdesc->entryCount : 1, sizeof(BindGroupBufferUsage));
+    bindGroup->bufferUsageCount = 0;
+    bindGroup->writesBuffers = 0;
+    for(uint32_t i = 0;i < bgdesc->entryCount;i++){
+        const WGPUBindGroupEntry* entry = bgdesc->entries + i;
+        if(entry->buffer == NULL)continue;
+        uint32_t bglEntryIndex = 0;
+        for(;bglEntryIndex < bgdesc->layout->entryCount;bglEntryIndex++){
+            if(bgdesc->layout->entries[bglEntryIndex].binding == entry->binding)break;
+        }
+        if(bglEntryIndex == bgdesc->layout->entryCount)continue;
+        const WGPUBindGroupLayoutEntry* layoutEntry = bgdesc->layout->entries + bglEntryIndex;
+        const BindGroupBufferUsage usage = {
+            .buffer = entry->buffer,
+            .usage = {
+                .stage  = toVulkanPipelineStageBits(layoutEntry->visibility),
+                .access = extractVkAccessFlags(layoutEntry),
+            }
+        };
+        bindGroup->writesBuffers |= isWritingAccess(usage.usage.access);
+        bindGroup->bufferUsages[bindGroup->bufferUsageCount++] = usage;
+    }
+}
+
+static uint32_t BindGroupLayout_entryIndex(WGPUBindGroupLayout layout, uint32_t binding, uint32_t hint){
+    if(hint < layout->entryCount && layout->entries[hint].binding == binding){
+        return hint;
+    }
+    for(uint32_t i = 0;i < layout->entryCount;i++){
+        if(layout->entries[i].binding == binding)return i;
+    }
+    return layout->entryCount;
+}
+
+// Fills in the descriptor info of a single element, type and destination of write are already set
+static void BindGroup_fillWrite(WGPUBindGroup bindGroup, const WGPUBindGroupEntry* entry, VkWriteDescriptorSet* write, VkDescriptorBufferInfo* bufferInfo, VkDescriptorImageInfo* imageInfo, VkWriteDescriptorSetAccelerationStructureKHR* accelStructInfo){
+    switch(write->descriptorType){
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: //[[fallthrough]];
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:{
+            WGPUBuffer bufferOfThatEntry = (WGPUBuffer)entry->buffer;
+            bufferInfo->buffer = bufferOfThatEntry->buffer;
+            bufferInfo->offset = entry->offset;
+            bufferInfo->range  = entry->size;
+            write->pBufferInfo = bufferInfo;
+        }break;
+
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:{
+            imageInfo->imageView   = ((WGPUTextureView)entry->textureView)->view;
+            imageInfo->imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            write->pImageInfo      = imageInfo;
+        }break;
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:{
+            imageInfo->imageView   = ((WGPUTextureView)entry->textureView)->view;
+            imageInfo->imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            write->pImageInfo      = imageInfo;
+        }break;
+        case VK_DESCRIPTOR_TYPE_SAMPLER:{
+            imageInfo->sampler = entry->sampler->sampler;
+            write->pImageInfo  = imageInfo;
+        }break;
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:{
+            ru_trackAccelerationStructure(&bindGroup->resourceUsage, entry->accelerationStructure);
+            accelStructInfo->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+            accelStructInfo->accelerationStructureCount = 1;
+            accelStructInfo->pAccelerationStructures = &(entry->accelerationStructure->accelerationStructure);
+            write->pNext = accelStructInfo;
+        }break;
+        default:
+        rg_unreachable();
+    }
+}
+
+/**
+ * @brief Hands the references of a displaced slot content to the current frame, which releases them once it retired
+ * @details Submitted work may still read the element's old descriptor until then.
+ */
+static void BindGroup_retireSlotContent(WGPUBindGroup bindGroup, BindGroupSlotContent* content){
+    if(content->buffer == NULL && content->textureView == NULL && content->sampler == NULL)return;
+    WGPUDevice device = bindGroup->device;
+    PerframeCache* pfcache = DeviceGetFIFCache(device, device->submittedFrames % framesInFlight);
+    BindGroupSlotContentVector_push_back(&pfcache->retiredSlotContents, *content);
+    *content = (BindGroupSlotContent){0};
+}
+
+// (Re)creates one slot allocator per array binding of layout, with every element free
+static void BindGroup_resetSlots(WGPUBindGroup bindGroup, WGPUBindGroupLayout layout){
+    for(uint32_t i = 0;i < bindGroup->slotAllocatorCount;i++){
+        BindGroupSlotAllocator* allocator = bindGroup->slotAllocators + i;
+        for(uint32_t slot = 0;allocator->contents && slot < allocator->contentEnd;slot++){
+            BindGroup_retireSlotContent(bindGroup, allocator->contents + slot);
+        }
+        RL_FREE(allocator->freeSlots);
+        RL_FREE(allocator->contents);
+    }
+    RL_FREE(bindGroup->slotAllocators);
+    bindGroup->slotAllocators = NULL;
+    bindGroup->slotAllocatorCount = 0;
+
+    uint32_t arrayBindingCount = 0;
+    for(uint32_t i = 0;i < layout->entryCount;i++){
+        arrayBindingCount += (layout->arraySizes[i] > 1);
+    }
+    if(arrayBindingCount == 0)return;
+    bindGroup->slotAllocators = RL_CALLOC(arrayBindingCount, sizeof(BindGroupSlotAllocator));
+    for(uint32_t i = 0;i < layout->entryCount;i++){
+        if(layout->arraySizes[i] > 1){
+            bindGroup->slotAllocators[bindGroup->slotAllocatorCount++] = (BindGroupSlotAllocator){
+                .binding = layout->entries[i].binding,
+                .layoutIndex = i,
+                .arraySize = layout->arraySizes[i],
+            };
+        }
+    }
+}
+
+static BindGroupSlotAllocator* BindGroup_slotAllocator(WGPUBindGroup bindGroup, uint32_t binding){
+    for(uint32_t i = 0;i < bindGroup->slotAllocatorCount;i++){
+        if(bindGroup->slotAllocators[i].binding == binding)return bindGroup->slotAllocators + i;
+    }
+    return NULL;
+}
+
 void wgpuWriteBindGroup(WGPUDevice device, WGPUBindGroup wvBindGroup, const WGPUBindGroupDescriptor* bgdesc){
     ENTRY();
     
@@ -2556,33 +3865,7 @@ void wgpuWriteBindGroup(WGPUDevice device, WGPUBindGroup wvBindGroup, const WGPU
     if(wvBindGroup->pool == NULL){
         wvBindGroup->layout = bgdesc->layout;
 
-        uint32_t counts[DESCRIPTOR_TYPE_UPPER_LIMIT] = {0};
-
-        //std::unordered_map<VkDescriptorType, uint32_t> counts;
-        for(uint32_t i = 0;i < bgdesc->layout->entryCount;i++){
-            ++counts[descriptorTypeContiguous(extractVkDescriptorType(bgdesc->layout->entries + i))];
-        }
-
-        VkDescriptorPoolSize sizes[DESCRIPTOR_TYPE_UPPER_LIMIT];
-        uint32_t VkDescriptorPoolSizeCount = 0;
-        //sizes.reserve(counts.size());
-        for(uint32_t i = 0;i < DESCRIPTOR_TYPE_UPPER_LIMIT;i++){
-            if(counts[i] != 0){
-                sizes[VkDescriptorPoolSizeCount++] = (VkDescriptorPoolSize){
-                    .type = contiguousDescriptorType(i), 
-                    .descriptorCount = counts[i]
-                };
-            }
-        }
-        VkDescriptorPoolCreateInfo dpci = {
-            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0,
-            .maxSets = 1,
-            .poolSizeCount = VkDescriptorPoolSizeCount,
-            .pPoolSizes = sizes
-        };
-        device->functions.vkCreateDescriptorPool(device->device, &dpci, NULL, &wvBindGroup->pool);
+        wvBindGroup->pool = BindGroupLayout_createPool(device, bgdesc->layout);
 
         //VkCopyDescriptorSet copy{};
         //copy.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
@@ -2617,6 +3900,8 @@ void wgpuWriteBindGroup(WGPUDevice device, WGPUBindGroup wvBindGroup, const WGPU
     }
     releaseAllAndClear(&wvBindGroup->resourceUsage);
     ResourceUsage_move(&wvBindGroup->resourceUsage, &newResourceUsage);
+    BindGroup_computeBufferUsages(wvBindGroup, bgdesc);
+    BindGroup_resetSlots(wvBindGroup, bgdesc->layout);
 
     
     uint32_t count = bgdesc->entryCount;
@@ -2633,52 +3918,15 @@ void wgpuWriteBindGroup(WGPUDevice device, WGPUBindGroup wvBindGroup, const WGPU
     VkWriteDescriptorSetAccelerationStructureKHRVector_initWithSize(&accelStructInfos, count);
 
     for(uint32_t i = 0;i < count;i++){
+        const WGPUBindGroupEntry* entry = bgdesc->entries + i;
+        const uint32_t layoutIndex = BindGroupLayout_entryIndex(bgdesc->layout, entry->binding, i);
+        wgvk_assert(layoutIndex < bgdesc->layout->entryCount, "Bind group entry binding not in layout");
         writes.data[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        uint32_t binding = bgdesc->entries[i].binding;
-        writes.data[i].dstBinding = binding;
+        writes.data[i].dstBinding = entry->binding;
         writes.data[i].dstSet = wvBindGroup->set;
-        const WGPUBindGroupLayoutEntry* entryi = &bgdesc->layout->entries[i];
-        const VkDescriptorType entryType = extractVkDescriptorType(bgdesc->layout->entries + i);
-        writes.data[i].descriptorType = entryType;
+        writes.data[i].descriptorType = extractVkDescriptorType(bgdesc->layout->entries + layoutIndex);
         writes.data[i].descriptorCount = 1;
-        switch(entryType){
-            case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: //[[fallthrough]];
-            case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:{
-                WGPUBuffer bufferOfThatEntry = (WGPUBuffer)bgdesc->entries[i].buffer;
-                ru_trackBuffer(&wvBindGroup->resourceUsage, bufferOfThatEntry, (BufferUsageRecord){0, 0, VK_FALSE});
-                bufferInfos.data[i].buffer = bufferOfThatEntry->buffer;
-                bufferInfos.data[i].offset = bgdesc->entries[i].offset;
-                bufferInfos.data[i].range  = bgdesc->entries[i].size;
-                writes.data[i].pBufferInfo = bufferInfos.data + i;
-            }break;
-
-            case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:{
-                ru_trackTextureView(&wvBindGroup->resourceUsage, (WGPUTextureView)bgdesc->entries[i].textureView);
-                imageInfos.data[i].imageView   = ((WGPUTextureView)bgdesc->entries[i].textureView)->view;
-                imageInfos.data[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                writes    .data[i].pImageInfo  = imageInfos.data + i;
-            }break;
-            case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:{
-                ru_trackTextureView(&wvBindGroup->resourceUsage, (WGPUTextureView)bgdesc->entries[i].textureView);
-                imageInfos.data[i].imageView   = ((WGPUTextureView)bgdesc->entries[i].textureView)->view;
-                imageInfos.data[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
-                writes    .data[i].pImageInfo  = imageInfos.data + i;
-            }break;
-            case VK_DESCRIPTOR_TYPE_SAMPLER:{
-                ru_trackSampler(&wvBindGroup->resourceUsage, bgdesc->entries[i].sampler);
-                imageInfos.data[i].sampler    = bgdesc->entries[i].sampler->sampler;
-                writes.    data[i].pImageInfo = imageInfos.data + i;
-            }break;
-            case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:{
-                ru_trackAccelerationStructure(&wvBindGroup->resourceUsage, bgdesc->entries[i].accelerationStructure);
-                accelStructInfos.data[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
-                accelStructInfos.data[i].accelerationStructureCount = 1;
-                accelStructInfos.data[i].pAccelerationStructures = &(bgdesc->entries[i].accelerationStructure->accelerationStructure);
-                writes.          data[i].pNext = accelStructInfos.data + i;
-            }break;
-            default:
-            rg_unreachable();
-        }
+        BindGroup_fillWrite(wvBindGroup, entry, writes.data + i, bufferInfos.data + i, imageInfos.data + i, accelStructInfos.data + i);
     }
 
     device->functions.vkUpdateDescriptorSets(device->device, writes.size, writes.data, 0, NULL);
@@ -2709,32 +3957,7 @@ WGPUBindGroup wgpuDeviceCreateBindGroup(WGPUDevice device, const WGPUBindGroupDe
 
     if(dsap == NULL || dsap->size == 0){ //Cache miss
         //TRACELOG(WGPU_LOG_INFO, "Allocating new VkDescriptorPool and -Set");
-        VkDescriptorPoolCreateInfo dpci zeroinit;
-        dpci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        dpci.maxSets = 1;
-
-        uint32_t counts[DESCRIPTOR_TYPE_UPPER_LIMIT] = {0};
-
-        for(uint32_t i = 0;i < bgdesc->layout->entryCount;i++){
-            const VkDescriptorType vkdt = extractVkDescriptorType(bgdesc->layout->entries + i);
-            const uint32_t contiguousIndex = descriptorTypeContiguous(vkdt);
-            ++counts[contiguousIndex];
-        }
-        VkDescriptorPoolSize sizes[DESCRIPTOR_TYPE_UPPER_LIMIT];
-        uint32_t VkDescriptorPoolSizeCount = 0;
-        for(uint32_t i = 0;i < DESCRIPTOR_TYPE_UPPER_LIMIT;i++){
-            if(counts[i] != 0){
-                sizes[VkDescriptorPoolSizeCount++] = (VkDescriptorPoolSize){
-                    .type = contiguousDescriptorType(i), 
-                    .descriptorCount = counts[i]
-                };
-            }
-        }
-
-        dpci.poolSizeCount = VkDescriptorPoolSizeCount;
-        dpci.pPoolSizes = sizes;
-        dpci.maxSets = 1;
-        device->functions.vkCreateDescriptorPool(device->device, &dpci, NULL, &ret->pool);
+        ret->pool = BindGroupLayout_createPool(device, bgdesc->layout);
 
         //VkCopyDescriptorSet copy{};
         //copy.sType = VK_STRUCTURE_TYPE_COPY_DESCRIPTOR_SET;
@@ -2757,16 +3980,96 @@ WGPUBindGroup wgpuDeviceCreateBindGroup(WGPUDevice device, const WGPUBindGroupDe
     if(bgdesc->entryCount > 0){
         memcpy(ret->entries, bgdesc->entries, bgdesc->entryCount * sizeof(WGPUBindGroupEntry));
     }
-    wgpuWriteBindGroup(device, ret, bgdesc);
-    ret->layout = bgdesc->layout;
-    ++ret->layout->refCount;
-    wgvk_assert(ret->layout != NULL, "ret->layout is NULL");
-    return ret;
+    wgpuWriteBindGroup(device, ret, bgdesc);
+    ret->layout = bgdesc->layout;
+    ++ret->layout->refCount;
+    wgvk_assert(ret->layout != NULL, "ret->layout is NULL");
+    return ret;
+    EXIT();
+}
+
+
+
+uint32_t wgpuBindGroupAllocateSlot(WGPUBindGroup bindGroup, uint32_t binding){
+    BindGroupSlotAllocator* allocator = BindGroup_slotAllocator(bindGroup, binding);
+    if(allocator == NULL){
+        DeviceCallback(bindGroup->device, WGPUErrorType_Validation, STRVIEW("wgpuBindGroupAllocateSlot: binding is not an array binding"));
+        return WGVK_INVALID_SLOT;
+    }
+    if(allocator->freeCount > 0){
+        return allocator->freeSlots[--allocator->freeCount];
+    }
+    if(allocator->highWater < allocator->arraySize){
+        return allocator->highWater++;
+    }
+    return WGVK_INVALID_SLOT;
+}
+
+void wgpuBindGroupFreeSlot(WGPUBindGroup bindGroup, uint32_t binding, uint32_t slot){
+    BindGroupSlotAllocator* allocator = BindGroup_slotAllocator(bindGroup, binding);
+    if(allocator == NULL || slot >= allocator->highWater){
+        DeviceCallback(bindGroup->device, WGPUErrorType_Validation, STRVIEW("wgpuBindGroupFreeSlot: slot was not allocated from this binding"));
+        return;
+    }
+    wgvk_assert(allocator->freeCount < allocator->highWater, "More slots freed than allocated");
+    if(allocator->freeSlots == NULL){
+        allocator->freeSlots = RL_CALLOC(allocator->arraySize, sizeof(uint32_t));
+    }
+    allocator->freeSlots[allocator->freeCount++] = slot;
+    // The descriptor keeps its old contents, but no barrier or initialization has to cover them anymore
+    if(allocator->contents && slot < allocator->contentEnd){
+        BindGroup_retireSlotContent(bindGroup, allocator->contents + slot);
+    }
+}
+
+void wgpuBindGroupWriteSlot(WGPUBindGroup bindGroup, uint32_t slot, const WGPUBindGroupEntry* entry){
+    ENTRY();
+    WGPUDevice device = bindGroup->device;
+    BindGroupSlotAllocator* allocator = BindGroup_slotAllocator(bindGroup, entry->binding);
+    if(allocator == NULL || slot >= allocator->arraySize){
+        DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("wgpuBindGroupWriteSlot: slot is outside of the binding's array"));
+        EXIT();
+        return;
+    }
+    const WGPUBindGroupLayoutEntry* layoutEntry = bindGroup->layout->entries + allocator->layoutIndex;
+
+    VkDescriptorBufferInfo bufferInfo zeroinit;
+    VkDescriptorImageInfo imageInfo zeroinit;
+    VkWriteDescriptorSetAccelerationStructureKHR accelStructInfo zeroinit;
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = bindGroup->set,
+        .dstBinding = entry->binding,
+        .dstArrayElement = slot,
+        .descriptorCount = 1,
+        .descriptorType = extractVkDescriptorType(layoutEntry),
+    };
+    BindGroup_fillWrite(bindGroup, entry, &write, &bufferInfo, &imageInfo, &accelStructInfo);
+
+    if(allocator->contents == NULL){
+        allocator->contents = RL_CALLOC(allocator->arraySize, sizeof(BindGroupSlotContent));
+    }
+    if(entry->buffer)wgpuBufferAddRef(entry->buffer);
+    if(entry->textureView)wgpuTextureViewAddRef(entry->textureView);
+    if(entry->sampler)wgpuSamplerAddRef(entry->sampler);
+    BindGroup_retireSlotContent(bindGroup, allocator->contents + slot);
+    allocator->contents[slot] = (BindGroupSlotContent){
+        .buffer = entry->buffer,
+        .offset = entry->offset,
+        .size = entry->size,
+        .textureView = entry->textureView,
+        .sampler = entry->sampler,
+    };
+    if(slot >= allocator->contentEnd){
+        allocator->contentEnd = slot + 1;
+    }
+    if(entry->buffer){
+        bindGroup->writesBuffers |= isWritingAccess(extractVkAccessFlags(layoutEntry));
+    }
+    device->functions.vkUpdateDescriptorSets(device->device, 1, &write, 0, NULL);
     EXIT();
 }
 
-
-
 WGPUBindGroupLayout wgpuDeviceCreateBindGroupLayout(WGPUDevice device, const WGPUBindGroupLayoutDescriptor* bgldesc){
     ENTRY();
     WGPUBindGroupLayout ret = RL_CALLOC(1, sizeof(WGPUBindGroupLayoutImpl));
@@ -2780,12 +4083,33 @@ WGPUBindGroupLayout wgpuDeviceCreateBindGroupLayout(WGPUDevice device, const WGP
     VkDescriptorSetLayoutBindingVector vkBindings;
     VkDescriptorSetLayoutBindingVector_initWithSize(&vkBindings, bgldesc->entryCount);
 
+    ret->arraySizes = (uint32_t*)RL_CALLOC(entryCount ? entryCount : 1, sizeof(uint32_t));
+    VkDescriptorBindingFlags* bindingFlags = (VkDescriptorBindingFlags*)RL_CALLOC(entryCount ? entryCount : 1, sizeof(VkDescriptorBindingFlags));
+
     for(uint32_t i = 0;i < bgldesc->entryCount;i++){
-        vkBindings.data[i].descriptorCount = 1;
+        ret->arraySizes[i] = 1;
+        for(const WGPUChainedStruct* chain = entries[i].nextInChain;chain;chain = chain->next){
+            if(chain->sType == WGPUSType_BindGroupLayoutEntryArraySize){
+                ret->arraySizes[i] = ((const WGPUBindGroupLayoutEntryArraySize*)chain)->arraySize;
+            }
+        }
+        if(ret->arraySizes[i] == 0){
+            DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("WGPUBindGroupLayoutEntryArraySize::arraySize must not be 0"));
+            ret->arraySizes[i] = 1;
+        }
+        vkBindings.data[i].descriptorCount = ret->arraySizes[i];
         vkBindings.data[i].binding = entries[i].binding;
         VkDescriptorType vkdtype = extractVkDescriptorType(entries + i);
         vkBindings.data[i].descriptorType = vkdtype;
 
+        if(ret->arraySizes[i] > 1 && device->capabilities.bindless){
+            bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+            if(supportsUpdateAfterBind(&device->capabilities, vkdtype)){
+                bindingFlags[i] |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+                ret->updateAfterBind = 1;
+            }
+        }
+
         if(entries[i].visibility == 0){
             //TRACELOG(WGPU_LOG_WARNING, "Empty visibility detected, falling back to Vertex | Fragment | Compute mask");
             vkBindings.data[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_GEOMETRY_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
@@ -2796,14 +4120,24 @@ WGPUBindGroupLayout wgpuDeviceCreateBindGroupLayout(WGPUDevice device, const WGP
         }
     }
     
+    const VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = bgldesc->entryCount,
+        .pBindingFlags = bindingFlags,
+    };
     VkDescriptorSetLayoutCreateInfo slci = {
         .bindingCount = bgldesc->entryCount,
         .pBindings = vkBindings.data,
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = device->capabilities.bindless ? &bindingFlagsInfo : NULL,
+        .flags = ret->updateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0,
     };
 
     VkResult createResult = device->functions.vkCreateDescriptorSetLayout(device->device, &slci, NULL, &ret->layout);
+    RL_FREE(bindingFlags);
     if(createResult != VK_SUCCESS){
+        VkDescriptorSetLayoutBindingVector_free(&vkBindings);
+        RL_FREE(ret->arraySizes);
         RL_FREE(ret);
         return NULL;
     }
@@ -2926,6 +4260,20 @@ WGPUPipelineLayout wgpuDeviceCreatePipelineLayout(WGPUDevice device, const WGPUP
     lci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     lci.pSetLayouts = dslayouts;
     lci.setLayoutCount = ret->bindGroupLayoutCount;
+    // One range for all stages, so a push never has to know which stages consume which bytes
+    if(pldesc->immediateDataRangeByteSize > WGVK_MAX_IMMEDIATE_DATA_SIZE || (pldesc->immediateDataRangeByteSize & 3)){
+        DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("immediateDataRangeByteSize must be a multiple of 4 and at most WGVK_MAX_IMMEDIATE_DATA_SIZE"));
+        wgpuPipelineLayoutRelease(ret);
+        return NULL;
+    }
+    ret->immediateDataSize = pldesc->immediateDataRangeByteSize;
+    const VkPushConstantRange immediateRange = {
+        .stageFlags = VK_SHADER_STAGE_ALL,
+        .offset = 0,
+        .size = ret->immediateDataSize,
+    };
+    lci.pushConstantRangeCount = ret->immediateDataSize ? 1 : 0;
+    lci.pPushConstantRanges = &immediateRange;
     VkResult res = device->functions.vkCreatePipelineLayout(device->device, &lci, NULL, &ret->layout);
     if(res != VK_SUCCESS){
         wgpuPipelineLayoutRelease(ret);
@@ -2936,44 +4284,350 @@ WGPUPipelineLayout wgpuDeviceCreatePipelineLayout(WGPUDevice device, const WGPUP
 }
 
 
-WGPUCommandEncoder wgpuDeviceCreateCommandEncoder(WGPUDevice device, const WGPUCommandEncoderDescriptor* desc){
-    ENTRY();
-    WGPUCommandEncoder ret = RL_CALLOC(1, sizeof(WGPUCommandEncoderImpl));
-    ret->cacheIndex = device->submittedFrames % framesInFlight;
-    PerframeCache* pfcache = DeviceGetFIFCache(device, ret->cacheIndex);
-    ret->device = device;
-    ret->movedFrom = 0;
-    //vkCreateCommandPool(device->device, &pci, NULL, &cache.commandPool);
-    if(VkCommandBufferVector_empty(&pfcache->commandBuffers)){
+static const VkCommandBufferBeginInfo primaryBeginInfo = {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    .pNext = NULL,
+    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    .pInheritanceInfo = NULL
+};
+
+/**
+ * @brief PerframeCache_beginPrimaryCommandBuffer for threads without a slot of their own
+ */
+static VkCommandBuffer PerframeCache_beginOverflowCommandBuffer(WGPUDevice device, PerframeCache* pfcache){
+    OverflowCommandPool* opool = &pfcache->overflowPool;
+    wgvk_mutex_lock(opool->mutex);
+    if(opool->nextFree == opool->buffers.size){
+        PooledCommandBuffer pooled zeroinit;
+        const VkCommandPoolCreateInfo pci = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = device->adapter->queueIndices.graphicsIndex
+        };
+        device->functions.vkCreateCommandPool(device->device, &pci, NULL, &pooled.pool);
+        const VkCommandBufferAllocateInfo bai = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pooled.pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        device->functions.vkAllocateCommandBuffers(device->device, &bai, &pooled.buffer);
+        PooledCommandBufferVector_push_back(&opool->buffers, pooled);
+    }
+    VkCommandBuffer ret = opool->buffers.data[opool->nextFree++].buffer;
+    ++opool->outstanding;
+    wgvk_mutex_unlock(opool->mutex);
+    device->functions.vkBeginCommandBuffer(ret, &primaryBeginInfo);
+    return ret;
+}
+
+/**
+ * @brief Hands out the next primary command buffer of a thread's pool in this frame, begins it and pins the pool to it
+ * @details threadSlot passes in the preferred slot, usually wgvk_thread_slot(), and returns the one the buffer came from. 
+ * If that pool is pinned by another recording, the buffer is taken from the overflow pool. The pool is created on first use 
+ * and stays pinned until PerframeCache_endPrimaryCommandBuffer, so the buffer may be recorded on any thread meanwhile.
+ */
+static VkCommandBuffer PerframeCache_beginPrimaryCommandBuffer(WGPUDevice device, PerframeCache* pfcache, uint32_t* threadSlot){
+    if(*threadSlot == WGVK_OVERFLOW_THREAD_SLOT || atomic_exchange_explicit(&pfcache->threadPools[*threadSlot].pinned, 1, memory_order_acquire)){
+        *threadSlot = WGVK_OVERFLOW_THREAD_SLOT;
+        return PerframeCache_beginOverflowCommandBuffer(device, pfcache);
+    }
+    ThreadCommandPool* tpool = pfcache->threadPools + *threadSlot;
+    // Claim the pool before touching it, a reset by wgpuDeviceTick that already started has to finish first
+    if(atomic_fetch_add_explicit(&tpool->outstanding, 1, memory_order_acquire) & THREAD_COMMAND_POOL_RESETTING){
+        while(atomic_load_explicit(&tpool->outstanding, memory_order_acquire) & THREAD_COMMAND_POOL_RESETTING){
+            wgvk_thread_yield();
+        }
+    }
+    if(tpool->pool == VK_NULL_HANDLE){
+        const VkCommandPoolCreateInfo pci = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+            .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+            .queueFamilyIndex = device->adapter->queueIndices.graphicsIndex
+        };
+        device->functions.vkCreateCommandPool(device->device, &pci, NULL, &tpool->pool);
+        VkCommandBufferVector_init(&tpool->buffers);
+    }
+    if(tpool->nextFree == tpool->buffers.size){
+        VkCommandBuffer newBuffer = VK_NULL_HANDLE;
         VkCommandBufferAllocateInfo bai = {
             .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .commandPool = pfcache->commandPool,
+            .commandPool = tpool->pool,
             .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
             .commandBufferCount = 1,
         };
-        device->functions.vkAllocateCommandBuffers(device->device, &bai, &ret->buffer);
-        //printf("Allocating cb %p from pool %d\n", ret->buffer, (int)ret->cacheIndex);
+        device->functions.vkAllocateCommandBuffers(device->device, &bai, &newBuffer);
+        VkCommandBufferVector_push_back(&tpool->buffers, newBuffer);
     }
-    else{
-        ret->buffer = pfcache->commandBuffers.data[pfcache->commandBuffers.size - 1];
-        //printf("Recycling cb %p from pool %d\n",  ret->buffer, (int)ret->cacheIndex);
-        VkCommandBufferVector_pop_back(&pfcache->commandBuffers);
-        //vkResetCommandBuffer(ret->buffer, 0);
+    VkCommandBuffer ret = tpool->buffers.data[tpool->nextFree++];
+    
+    device->functions.vkBeginCommandBuffer(ret, &primaryBeginInfo);
+    return ret;
+}
+
+/**
+ * @brief Unpins the pool of a buffer handed out by PerframeCache_beginPrimaryCommandBuffer without ending it
+ * @details For encoders that are released while still recording.
+ */
+static void PerframeCache_unpinCommandPool(PerframeCache* pfcache, uint32_t threadSlot){
+    if(threadSlot == WGVK_OVERFLOW_THREAD_SLOT)return;
+    atomic_store_explicit(&pfcache->threadPools[threadSlot].pinned, 0, memory_order_release);
+}
+
+/**
+ * @brief Ends a buffer handed out by PerframeCache_beginPrimaryCommandBuffer, after which other recordings may use its pool
+ */
+static void PerframeCache_endPrimaryCommandBuffer(WGPUDevice device, PerframeCache* pfcache, uint32_t threadSlot, VkCommandBuffer buffer){
+    device->functions.vkEndCommandBuffer(buffer);
+    PerframeCache_unpinCommandPool(pfcache, threadSlot);
+}
+
+/**
+ * @brief Gives a buffer handed out by PerframeCache_beginPrimaryCommandBuffer back to its pool
+ * @details Callable from any thread; the buffer itself is only recycled by the next pool reset.
+ */
+static void PerframeCache_returnPrimaryCommandBuffer(PerframeCache* pfcache, uint32_t threadSlot){
+    if(threadSlot == WGVK_OVERFLOW_THREAD_SLOT){
+        wgvk_mutex_lock(pfcache->overflowPool.mutex);
+        --pfcache->overflowPool.outstanding;
+        wgvk_mutex_unlock(pfcache->overflowPool.mutex);
+        return;
+    }
+    atomic_fetch_sub_explicit(&pfcache->threadPools[threadSlot].outstanding, 1, memory_order_release);
+}
+
+/**
+ * @brief Resets all command pools of a retired frame wholesale
+ * @details A pool that still has buffers alive (e.g. an encoder kept across wgpuDeviceTick) or that 
+ * its thread is handing a buffer out of right now is skipped and keeps growing until a later frame finds it idle.
+ */
+static void PerframeCache_resetCommandPools(WGPUDevice device, PerframeCache* pfcache){
+    device->functions.vkResetCommandPool(device->device, pfcache->commandPool, 0);
+    pfcache->transitionBuffersUsed = 0;
+    for(uint32_t i = 0;i < WGVK_MAX_RECORDING_THREADS;i++){
+        ThreadCommandPool* tpool = pfcache->threadPools + i;
+        uint32_t idle = 0;
+        if(!atomic_compare_exchange_strong_explicit(&tpool->outstanding, &idle, THREAD_COMMAND_POOL_RESETTING, memory_order_acquire, memory_order_relaxed)){
+            continue;
+        }
+        if(tpool->pool != VK_NULL_HANDLE && tpool->nextFree != 0){
+            device->functions.vkResetCommandPool(device->device, tpool->pool, 0);
+            tpool->nextFree = 0;
+        }
+        // Keeps the claims of threads that are waiting for the reset to finish
+        atomic_fetch_and_explicit(&tpool->outstanding, ~THREAD_COMMAND_POOL_RESETTING, memory_order_release);
+    }
+    OverflowCommandPool* opool = &pfcache->overflowPool;
+    wgvk_mutex_lock(opool->mutex);
+    if(opool->outstanding == 0){
+        for(uint32_t b = 0;b < opool->nextFree;b++){
+            device->functions.vkResetCommandPool(device->device, opool->buffers.data[b].pool, 0);
+        }
+        opool->nextFree = 0;
     }
+    wgvk_mutex_unlock(opool->mutex);
+}
 
+/**
+ * @brief Hands out the next barrier-only command buffer of this frame, begun and ready for recording
+ * @details These buffers are never wrapped in a WGPUCommandBuffer, they are rewound in wgpuDeviceTick 
+ * once the frame's fences have been waited on.
+ */
+static VkCommandBuffer PerframeCache_beginTransitionBuffer(WGPUDevice device, PerframeCache* pfcache){
+    if(pfcache->transitionBuffersUsed == pfcache->transitionBuffers.size){
+        VkCommandBuffer newBuffer = VK_NULL_HANDLE;
+        VkCommandBufferAllocateInfo bai = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .commandPool = pfcache->commandPool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1,
+        };
+        device->functions.vkAllocateCommandBuffers(device->device, &bai, &newBuffer);
+        VkCommandBufferVector_push_back(&pfcache->transitionBuffers, newBuffer);
+    }
+    VkCommandBuffer ret = pfcache->transitionBuffers.data[pfcache->transitionBuffersUsed++];
     const VkCommandBufferBeginInfo bbi = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .pNext = NULL,
         .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-        .pInheritanceInfo = NULL
     };
-    
-    device->functions.vkBeginCommandBuffer(ret->buffer, &bbi);
+    device->functions.vkBeginCommandBuffer(ret, &bbi);
+    return ret;
+}
+
+/**
+ * @brief wgpuDeviceCreateCommandEncoder with the slot whose pool is preferred for the encoder's buffers
+ * @details The queue's presubmit encoder is recorded by whichever thread writes to the queue and lives for a 
+ * whole frame, so it passes WGVK_OVERFLOW_THREAD_SLOT instead of pinning the pool of the thread that created it.
+ */
+static WGPUCommandEncoder CommandEncoder_create(WGPUDevice device, uint32_t threadSlot){
+    WGPUCommandEncoder ret = RL_CALLOC(1, sizeof(WGPUCommandEncoderImpl));
+    ret->cacheIndex = device->submittedFrames % framesInFlight;
+    PerframeCache* pfcache = DeviceGetFIFCache(device, ret->cacheIndex);
+    ret->device = device;
+    ret->movedFrom = 0;
+    ret->threadSlot = threadSlot;
+    ret->buffer = PerframeCache_beginPrimaryCommandBuffer(device, pfcache, &ret->threadSlot);
+    ContainerCache_acquireResourceUsage(&device->containerCache, &ret->resourceUsage);
+    return ret;
+}
+
+WGPUCommandEncoder wgpuDeviceCreateCommandEncoder(WGPUDevice device, const WGPUCommandEncoderDescriptor* desc){
+    ENTRY();
+    WGPUCommandEncoder ret = CommandEncoder_create(device, wgvk_thread_slot());
     
     return ret;
     EXIT();
 }
 
+/**
+ * @brief Notes that queryIndex of querySet is written by the encoder, must be called before the write is recorded
+ * @details Queries must be reset before they are written. Instead of resetting around every pass, wgpuCommandEncoderFinish
+ * resets the first write of every query once, in front of everything the encoder recorded. A query written again by 
+ * the same encoder (another pass, or after wgpuCommandEncoderResolveQuerySet read it) is reset right here instead. 
+ * Passes are recorded into the encoder when they end, so the reset lands before the pass that rewrites the query.
+ */
+static void CommandEncoder_markQueryWritten(WGPUCommandEncoder encoder, WGPUQuerySet querySet, uint32_t queryIndex){
+    wgvk_assert(queryIndex < querySet->count, "queryIndex is out of range");
+    ru_trackQuerySet(&encoder->resourceUsage, querySet);
+    QueryWrites* writes = NULL;
+    for(size_t i = 0;i < encoder->queryWrites.size;i++){
+        if(encoder->queryWrites.data[i].querySet == querySet){
+            writes = encoder->queryWrites.data + i;
+            break;
+        }
+    }
+    if(writes == NULL){
+        QueryWritesVector_push_back(&encoder->queryWrites, (QueryWrites){
+            .querySet = querySet,
+            .written = RL_CALLOC((querySet->count + 63) / 64, sizeof(uint64_t)),
+        });
+        writes = encoder->queryWrites.data + encoder->queryWrites.size - 1;
+    }
+    uint64_t* word = writes->written + queryIndex / 64;
+    const uint64_t bit = 1ull << (queryIndex % 64);
+    if(!(*word & bit)){
+        *word |= bit;
+        return;
+    }
+    // The previous write or a resolve reading it must be done before the query is reset
+    WGPUDevice device = encoder->device;
+    device->functions.vkCmdPipelineBarrier(encoder->buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0, NULL);
+    device->functions.vkCmdResetQueryPool(encoder->buffer, querySet->queryPool, queryIndex, 1);
+}
+
+static void CommandEncoder_freeQueryWrites(WGPUCommandEncoder encoder){
+    for(size_t i = 0;i < encoder->queryWrites.size;i++){
+        RL_FREE(encoder->queryWrites.data[i].written);
+    }
+    QueryWritesVector_free(&encoder->queryWrites);
+}
+
+static void CommandEncoder_markPassTimestampWrites(WGPUCommandEncoder encoder, const WGPUPassTimestampWrites* timestampWrites){
+    if(timestampWrites->beginningOfPassWriteIndex != WGPU_QUERY_SET_INDEX_UNDEFINED){
+        CommandEncoder_markQueryWritten(encoder, timestampWrites->querySet, timestampWrites->beginningOfPassWriteIndex);
+    }
+    if(timestampWrites->endOfPassWriteIndex != WGPU_QUERY_SET_INDEX_UNDEFINED){
+        CommandEncoder_markQueryWritten(encoder, timestampWrites->querySet, timestampWrites->endOfPassWriteIndex);
+    }
+}
+
+static void PassTimestampWrites_record(WGPUDevice device, VkCommandBuffer commandBuffer, const WGPUPassTimestampWrites* timestampWrites, WGPUBool endOfPass){
+    const uint32_t queryIndex = endOfPass ? timestampWrites->endOfPassWriteIndex : timestampWrites->beginningOfPassWriteIndex;
+    if(queryIndex == WGPU_QUERY_SET_INDEX_UNDEFINED)return;
+    const VkPipelineStageFlagBits stage = endOfPass ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    device->functions.vkCmdWriteTimestamp(commandBuffer, stage, timestampWrites->querySet->queryPool, queryIndex);
+}
+
+/**
+ * @brief Takes a host-reset timestamp query pool from the device, creating one if none was collected yet
+ */
+static TimestampScopes Device_acquireTimestampScopes(WGPUDevice device){
+    TimestampScopes scopes zeroinit;
+    wgvk_mutex_lock(device->timestampScopesMutex);
+    if(device->freeTimestampScopes.size){
+        scopes = device->freeTimestampScopes.data[--device->freeTimestampScopes.size];
+    }
+    wgvk_mutex_unlock(device->timestampScopesMutex);
+    if(scopes.queryPool)return scopes;
+
+    const VkQueryPoolCreateInfo qpci = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2 * device->timestampScopeCapacity,
+    };
+    device->functions.vkCreateQueryPool(device->device, &qpci, NULL, &scopes.queryPool);
+    device->functions.vkResetQueryPool(device->device, scopes.queryPool, 0, qpci.queryCount);
+    scopes.labels = RL_CALLOC(device->timestampScopeCapacity, WGVK_TIMESTAMP_LABEL_LENGTH);
+    return scopes;
+}
+
+/**
+ * @brief Host-resets the used queries of scopes and returns its pool to the device, scopes is left empty
+ * @details The GPU must be done with the pool: it was collected from a retired frame or never submitted.
+ */
+static void Device_recycleTimestampScopes(WGPUDevice device, TimestampScopes* scopes){
+    if(scopes->queryPool == VK_NULL_HANDLE)return;
+    const uint32_t scopeCount = scopes->scopeCount < device->timestampScopeCapacity ? scopes->scopeCount : device->timestampScopeCapacity;
+    if(scopeCount){
+        device->functions.vkResetQueryPool(device->device, scopes->queryPool, 0, 2 * scopeCount);
+    }
+    scopes->scopeCount = 0;
+    wgvk_mutex_lock(device->timestampScopesMutex);
+    TimestampScopesVector_push_back(&device->freeTimestampScopes, *scopes);
+    wgvk_mutex_unlock(device->timestampScopesMutex);
+    *scopes = (TimestampScopes){0};
+}
+
+/**
+ * @brief Hands out a profiled scope of encoder, or WGVK_NO_TIMESTAMP_SCOPE if profiling is off or the encoder is full
+ * @details The frame the scope is collected in is only known once the encoder's command buffer is submitted, 
+ * so scopes belong to the encoder and travel with it (see wgpuQueueSubmit).
+ */
+static uint32_t Device_beginTimestampScope(WGPUCommandEncoder encoder, WGPUStringView label, const char* fallbackLabel){
+    WGPUDevice device = encoder->device;
+    if(device->timestampScopeCapacity == 0)return WGVK_NO_TIMESTAMP_SCOPE;
+    TimestampScopes* timestamps = &encoder->timestamps;
+    if(timestamps->queryPool == VK_NULL_HANDLE){
+        *timestamps = Device_acquireTimestampScopes(device);
+    }
+    const uint32_t scope = timestamps->scopeCount++;
+    if(scope >= device->timestampScopeCapacity)return WGVK_NO_TIMESTAMP_SCOPE;
+
+    const char* text = label.data;
+    size_t length = (text == NULL) ? 0 : ((label.length == WGPU_STRLEN) ? strlen(text) : label.length);
+    if(length == 0){
+        text = fallbackLabel;
+        length = strlen(fallbackLabel);
+    }
+    length = length < WGVK_TIMESTAMP_LABEL_LENGTH - 1 ? length : WGVK_TIMESTAMP_LABEL_LENGTH - 1;
+    memcpy(timestamps->labels[scope], text, length);
+    timestamps->labels[scope][length] = '\0';
+    return scope;
+}
+
+static void Device_recordTimestampScope(WGPUDevice device, VkCommandBuffer commandBuffer, const TimestampScopes* timestamps, uint32_t scope, WGPUBool endOfScope){
+    if(scope == WGVK_NO_TIMESTAMP_SCOPE)return;
+    const VkPipelineStageFlagBits stage = endOfScope ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    device->functions.vkCmdWriteTimestamp(commandBuffer, stage, timestamps->queryPool, 2 * scope + (endOfScope ? 1 : 0));
+}
+
+/**
+ * @brief Re-arms an encoder that has been finished, so the same object can keep recording
+ * @details Used for the queue's presubmit encoder: instead of releasing and recreating it after every
+ * submit, it receives a fresh command buffer of the current frame. The previous one may still be in flight.
+ */
+static void CommandEncoder_rearm(WGPUCommandEncoder encoder){
+    wgvk_assert(encoder->movedFrom && encoder->buffer == NULL, "Only finished encoders can be rearmed");
+    WGPUDevice device = encoder->device;
+    encoder->cacheIndex = device->submittedFrames % framesInFlight;
+    encoder->movedFrom = 0;
+    encoder->encodedCommandCount = 0;
+    encoder->debugGroupDepth = 0;
+    encoder->threadSlot = WGVK_OVERFLOW_THREAD_SLOT;
+    encoder->buffer = PerframeCache_beginPrimaryCommandBuffer(device, DeviceGetFIFCache(device, encoder->cacheIndex), &encoder->threadSlot);
+    ContainerCache_acquireResourceUsage(&device->containerCache, &encoder->resourceUsage);
+}
+
 static inline VkComponentSwizzle toVkSwizzleComponent(WGPUComponentSwizzle wgpuSwizzle){
     switch(wgpuSwizzle){
         case WGPUComponentSwizzle_Zero: return VK_COMPONENT_SWIZZLE_ZERO;
@@ -2989,10 +4643,10 @@ static inline VkComponentSwizzle toVkSwizzleComponent(WGPUComponentSwizzle wgpuS
         abort();
     }
 }
-static inline WGPUTextureViewDimension toViewDim_(WGPUTextureDimension dim){
-    if(dim == WGPUTextureDimension_1D)return WGPUTextureViewDimension_1D;
-    if(dim == WGPUTextureDimension_2D)return WGPUTextureViewDimension_2D;
-    if(dim == WGPUTextureDimension_3D)return WGPUTextureViewDimension_3D;
+static inline WGPUTextureViewDimension toViewDim_(WGPUTexture texture){
+    if(texture->dimension == VK_IMAGE_TYPE_1D)return WGPUTextureViewDimension_1D;
+    if(texture->dimension == VK_IMAGE_TYPE_3D)return WGPUTextureViewDimension_3D;
+    if(texture->dimension == VK_IMAGE_TYPE_2D)return texture->depthOrArrayLayers > 1 ? WGPUTextureViewDimension_2DArray : WGPUTextureViewDimension_2D;
     return WGPUTextureViewDimension_Undefined;
 }
 WGPUTextureView wgpuTextureCreateView(WGPUTexture texture, const WGPUTextureViewDescriptor *descriptor){
@@ -3000,16 +4654,36 @@ WGPUTextureView wgpuTextureCreateView(WGPUTexture texture, const WGPUTextureView
     if(descriptor == NULL){
         WGPUTextureViewDescriptor tvDesc = {
             .format = fromVulkanPixelFormat(texture->format),
-            .dimension = toViewDim_(fromVulkanTextureDimension(texture->dimension)),
+            .dimension = toViewDim_(texture),
             .baseMipLevel = 0,
             .mipLevelCount = texture->mipLevels,
             .baseArrayLayer = 0,
-            .arrayLayerCount = texture->depthOrArrayLayers,
+            .arrayLayerCount = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : texture->depthOrArrayLayers,
             .aspect = WGPUTextureAspect_All,
             .usage = texture->usage
         };
         return wgpuTextureCreateView(texture, &tvDesc);
     }
+    const WGPUTextureViewDimension viewDimension = descriptor->dimension == WGPUTextureViewDimension_Undefined ? toViewDim_(texture) : descriptor->dimension;
+    // A 3D image has exactly one array layer; its depth is addressed through the view, not the subresource range
+    const uint32_t layers = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : texture->depthOrArrayLayers;
+    const uint32_t baseArrayLayer = texture->dimension == VK_IMAGE_TYPE_3D ? 0 : descriptor->baseArrayLayer;
+    // Bases are checked first so the remaining counts below can't wrap around
+    if(descriptor->baseMipLevel >= texture->mipLevels || baseArrayLayer >= layers){
+        DeviceCallback(texture->device, WGPUErrorType_Validation, STRVIEW("wgpuTextureCreateView: subresource range exceeds the texture"));
+        EXIT();
+        return NULL;
+    }
+    uint32_t arrayLayerCount = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : descriptor->arrayLayerCount;
+    if(arrayLayerCount == WGPU_ARRAY_LAYER_COUNT_UNDEFINED){
+        arrayLayerCount = (viewDimension == WGPUTextureViewDimension_Cube) ? 6 : (viewDimension == WGPUTextureViewDimension_2D || viewDimension == WGPUTextureViewDimension_1D) ? 1 : layers - baseArrayLayer;
+    }
+    const uint32_t mipLevelCount = descriptor->mipLevelCount == WGPU_MIP_LEVEL_COUNT_UNDEFINED ? texture->mipLevels - descriptor->baseMipLevel : descriptor->mipLevelCount;
+    if(mipLevelCount == 0 || mipLevelCount > texture->mipLevels - descriptor->baseMipLevel || arrayLayerCount == 0 || arrayLayerCount > layers - baseArrayLayer){
+        DeviceCallback(texture->device, WGPUErrorType_Validation, STRVIEW("wgpuTextureCreateView: subresource range exceeds the texture"));
+        EXIT();
+        return NULL;
+    }
     VkComponentMapping swizzle = {
         .r = VK_COMPONENT_SWIZZLE_IDENTITY,
         .g = VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -3029,14 +4703,14 @@ WGPUTextureView wgpuTextureCreateView(WGPUTexture texture, const WGPUTextureView
         .flags = 0,
         .image = texture->image,
         .components = swizzle,
-        .viewType = toVulkanTextureViewDimension(descriptor->dimension),
+        .viewType = toVulkanTextureViewDimension(viewDimension),
         .format = toVulkanPixelFormat(descriptor->format),
         .subresourceRange = {
             .aspectMask = toVulkanAspectMask(descriptor->aspect, descriptor->format),
             .baseMipLevel = descriptor->baseMipLevel,
-            .levelCount = descriptor->mipLevelCount,
-            .baseArrayLayer = descriptor->baseArrayLayer,
-            .layerCount = descriptor->arrayLayerCount
+            .levelCount = mipLevelCount,
+            .baseArrayLayer = baseArrayLayer,
+            .layerCount = arrayLayerCount
         }
     };
     const SlimViewCreateInfo key = {
@@ -3055,11 +4729,15 @@ WGPUTextureView wgpuTextureCreateView(WGPUTexture texture, const WGPUTextureView
     if(hit_pointer){
         WGPUTextureView hit = *hit_pointer;
         if(hit->refCount == 0){
+            --texture->unreferencedViews;
             wgpuTextureAddRef(texture);
         }
+        hit->lastUse = ++texture->viewCacheClock;
+        atomic_fetch_add_explicit(&texture->device->viewCacheHits, 1, memory_order_relaxed);
         wgpuTextureViewAddRef(hit);
         return hit;
     }
+    atomic_fetch_add_explicit(&texture->device->viewCacheMisses, 1, memory_order_relaxed);
     
     //if(!is__depthVk(ivci.format)){
     //    sr.aspectMask &= VK_IMAGE_ASPECT_COLOR_BIT;
@@ -3075,6 +4753,7 @@ WGPUTextureView wgpuTextureCreateView(WGPUTexture texture, const WGPUTextureView
     ret->sampleCount = texture->sampleCount;
     ret->depthOrArrayLayers = texture->depthOrArrayLayers;
     ret->subresourceRange = ivci.subresourceRange;
+    ret->lastUse = ++texture->viewCacheClock;
     
     Texture_ViewCache_put(&texture->viewCache, key, ret);
     return ret;
@@ -3148,6 +4827,7 @@ WGPURenderBundleEncoder wgpuDeviceCreateRenderBundleEncoder(WGPUDevice device, c
     ret->colorAttachmentCount = descriptor->colorFormatCount;
     ret->colorAttachmentFormats = colorAttachmentFormats;
     ret->depthStencilFormat = toVulkanPixelFormat(descriptor->depthStencilFormat);
+    ret->sampleCount = toVulkanSampleCount(descriptor->sampleCount);
     //if(VkCommandBufferVector_empty(&device->secondaryCommandBuffers)){
     //VkCommandBufferAllocateInfo bai = {
     //    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -3178,13 +4858,14 @@ WGPURenderBundleEncoder wgpuDeviceCreateRenderBundleEncoder(WGPUDevice device, c
 WGPURenderBundle wgpuRenderBundleEncoderFinish(WGPURenderBundleEncoder renderBundleEncoder, WGPU_NULLABLE WGPURenderBundleDescriptor const * descriptor){
     ENTRY();
     WGPURenderBundle ret = RL_CALLOC(1, sizeof(WGPURenderBundleImpl));
-    RenderPassCommandGenericVector_move(&ret->bufferedCommands, &renderBundleEncoder->bufferedCommands);
+    RenderPassCommandStream_move(&ret->bufferedCommands, &renderBundleEncoder->bufferedCommands);
     renderBundleEncoder->movedFrom = 1;
     ret->device = renderBundleEncoder->device;
     ret->colorAttachmentFormats = renderBundleEncoder->colorAttachmentFormats;
     renderBundleEncoder->colorAttachmentFormats = NULL;
     ret->colorAttachmentCount = renderBundleEncoder->colorAttachmentCount;
     ret->depthStencilFormat = renderBundleEncoder->depthStencilFormat;
+    ret->sampleCount = renderBundleEncoder->sampleCount;
     //ret->device->functions.vkEndCommandBuffer(ret->commandBuffer);
     ret->refCount = 1;
     return ret;
@@ -3203,7 +4884,7 @@ void wgpuRenderBundleEncoderDraw(WGPURenderBundleEncoder renderBundleEncoder, ui
             firstInstance
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3219,7 +4900,7 @@ void wgpuRenderBundleEncoderDrawIndexed(WGPURenderBundleEncoder renderBundleEnco
             firstInstance
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3232,7 +4913,7 @@ void wgpuRenderBundleEncoderDrawIndexedIndirect(WGPURenderBundleEncoder renderBu
             indirectOffset
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3245,7 +4926,7 @@ void wgpuRenderBundleEncoderDrawIndirect(WGPURenderBundleEncoder renderBundleEnc
             indirectOffset
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3261,7 +4942,7 @@ void wgpuRenderBundleEncoderSetBindGroup(WGPURenderBundleEncoder renderBundleEnc
             dynamicOffsets
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3277,7 +4958,7 @@ void wgpuRenderBundleEncoderSetIndexBuffer(WGPURenderBundleEncoder renderBundleE
             size
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3289,7 +4970,7 @@ void wgpuRenderBundleEncoderSetPipeline(WGPURenderBundleEncoder renderBundleEnco
             pipeline
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3303,7 +4984,7 @@ void wgpuRenderBundleEncoderSetVertexBuffer(WGPURenderBundleEncoder renderBundle
             offset
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderBundleEncoder->bufferedCommands, cmd);
+    Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &cmd);
     EXIT();
 }
 
@@ -3316,6 +4997,10 @@ void wgpuRenderBundleEncoderAddRef(WGPURenderBundleEncoder renderBundleEncoder)
 void wgpuRenderBundleEncoderRelease(WGPURenderBundleEncoder renderBundleEncoder) WGPU_FUNCTION_ATTRIBUTE{
     ENTRY();
     if(--renderBundleEncoder->refCount == 0){
+        if(!renderBundleEncoder->movedFrom){
+            RenderPassCommandStream_free(&renderBundleEncoder->bufferedCommands);
+        }
+        RL_FREE(renderBundleEncoder->colorAttachmentFormats);
         RL_FREE(renderBundleEncoder);
     }
     EXIT();
@@ -3431,6 +5116,7 @@ WGPURenderPassEncoder wgpuCommandEncoderBeginRenderPass(WGPUCommandEncoder enc,
     if(rpdesc->depthStencilAttachment){
         ret->beginInfo.depthStencilAttachment = *rpdesc->depthStencilAttachment;
     }
+    CommandEncoder_initializeAttachments(enc, &ret->beginInfo);
     if(rpdesc->occlusionQuerySet){
         wgpuQuerySetAddRef(rpdesc->occlusionQuerySet);
         ret->beginInfo.occlusionQuerySet = rpdesc->occlusionQuerySet;
@@ -3439,8 +5125,11 @@ WGPURenderPassEncoder wgpuCommandEncoderBeginRenderPass(WGPUCommandEncoder enc,
         ret->beginInfo.timestampWrites = *rpdesc->timestampWrites;
         ret->beginInfo.timestampWritesPresent = 1;
         wgpuQuerySetAddRef(ret->beginInfo.timestampWrites.querySet);
+        CommandEncoder_markPassTimestampWrites(enc, rpdesc->timestampWrites);
     }
-    RenderPassCommandGenericVector_init(&ret->bufferedCommands);
+    ret->timestampScope = Device_beginTimestampScope(enc, rpdesc->label, "RenderPass");
+    ContainerCache_acquireResourceUsage(&enc->device->containerCache, &ret->resourceUsage);
+    ContainerCache_acquireCommandStream(&enc->device->containerCache, &ret->bufferedCommands);
 
     const ImageUsageSnap iur_color = {
         .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
@@ -3471,121 +5160,107 @@ WGPURenderPassEncoder wgpuCommandEncoderBeginRenderPass(WGPUCommandEncoder enc,
     };
 
     
+    BarrierBatch attachmentBarriers = {0};
     for(uint32_t i = 0;i < rpdesc->colorAttachmentCount;i++){
         wgvk_assert(rpdesc->colorAttachments[i].view, "colorAttachments[%d].view is null", (int)i);
-        ce_trackTextureView(enc, rpdesc->colorAttachments[i].view, iur_color);
-    }
-
-    for(uint32_t i = 0;i < rpdesc->colorAttachmentCount;i++){
-        if(rpdesc->colorAttachments[i].resolveTarget){
-            ce_trackTextureView(enc, rpdesc->colorAttachments[i].resolveTarget, iur_resolve);
-        }
-    }
-
-    if(rpdesc->depthStencilAttachment){
-        wgvk_assert(rpdesc->depthStencilAttachment->view, "depthStencilAttachment.view is null");
-        ce_trackTextureView(enc, rpdesc->depthStencilAttachment->view, iur_depth);
+        ce_trackTextureViewBatched(enc, &attachmentBarriers, rpdesc->colorAttachments[i].view, iur_color);
     }
-    //wgpuRenderPassEncoderSetViewport(ret, 0, 0, rpdesc->colorAttachments[0].view->width, rpdesc->colorAttachments[0].view->height, 0, 1);
-    return ret;
-    EXIT();
-}
-
-void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder){
-    ENTRY();
-    
-    WGPUDevice device = renderPassEncoder->device;
-    VkCommandBuffer destination = renderPassEncoder->cmdEncoder->buffer;
-    const size_t bufferSize = RenderPassCommandGenericVector_size(&renderPassEncoder->bufferedCommands);
-
-    const RenderPassCommandBegin* beginInfo = &renderPassEncoder->beginInfo;
-
-    
-
-    VkImageView attachmentViews[2 * max_color_attachments + 2] = {0};// = (VkImageView* )RL_CALLOC(frp.allAttachments.size, sizeof(VkImageView) );
-    VkClearValue clearValues   [2 * max_color_attachments + 2] = {0};// = (VkClearValue*)RL_CALLOC(frp.allAttachments.size, sizeof(VkClearValue));
-
-    
-    
-
-    
-    VkRect2D renderPassRect = {
-        .offset = {0, 0},
-        .extent = {
-            beginInfo->colorAttachments[0].view->width, 
-            beginInfo->colorAttachments[0].view->height
-        }
-    };
-
-    
-
-    
-
-
-    for(size_t i = 0;i < renderPassEncoder->bufferedCommands.size;i++){
-        const RenderPassCommandGeneric* cmd = &renderPassEncoder->bufferedCommands.data[i];
-        if(cmd->type == rp_command_type_set_bind_group){
-            const RenderPassCommandSetBindGroup* cmdSetBindGroup = &cmd->setBindGroup;
-            const WGPUBindGroup       group  = cmdSetBindGroup->group;
-            const WGPUBindGroupLayout layout = group->layout;
-            for(uint32_t bindingIndex = 0;bindingIndex < layout->entryCount;bindingIndex++){
-
-                wgvk_assert(group->entries[bindingIndex].binding == layout->entries[bindingIndex].binding, "Mismatch between layout and group, this will cause bugs.");
-                
-                const WGPUBindGroupEntry*       groupEntry  = &group ->entries[bindingIndex];
-                const WGPUBindGroupLayoutEntry* layoutEntry = &layout->entries[bindingIndex];
-
-                //uniform_type eType = layout->entries[bindingIndex].type;
-                if(layout->entries[bindingIndex].buffer.type != WGPUBufferBindingType_BindingNotUsed){
-                    wgvk_assert(group->entries[bindingIndex].buffer, "Layout indicates buffer but no buffer passed");
-                    WGPUShaderStage visibility = layout->entries[bindingIndex].visibility;
-                    wgvk_assert(visibility, "Empty visibility goddamnit");
-                    ce_trackBuffer(
-                        renderPassEncoder->cmdEncoder,
-                        group->entries[bindingIndex].buffer,
-                        (BufferUsageSnap){
-                            .access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-                            //.access = access_to_vk[layout->entries[bindingIndex].access], //TODO
-                            .stage = toVulkanPipelineStageBits(visibility)
-                        }
-                    );
-                }
 
-                else if(layout->entries[bindingIndex].texture.sampleType != WGPUTextureSampleType_BindingNotUsed){
-                    WGPUShaderStage visibility = layout->entries[bindingIndex].visibility;
-                    wgvk_assert(visibility, "Empty visibility goddamnit");
-                    if(visibility == 0){ //TODO: Get rid of this hack
-                        visibility = (WGPUShaderStage_Vertex | WGPUShaderStage_Fragment | WGPUShaderStage_Compute);
-                    }
-                    ce_trackTextureView(
-                        renderPassEncoder->cmdEncoder,
-                        group->entries[bindingIndex].textureView,
-                        (ImageUsageSnap){
-                            .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                            .access = VK_ACCESS_SHADER_READ_BIT,
-                            .stage = toVulkanPipelineStageBits(visibility)
-                        }
-                    );
-                }
-                else if(layout->entries[bindingIndex].storageTexture.access != WGPUStorageTextureAccess_BindingNotUsed){
-                    WGPUShaderStage visibility = layout->entries[bindingIndex].visibility;
-                    wgvk_assert(visibility, "Empty visibility goddamnit");
-                    if(visibility == 0){ //TODO: Get rid of this hack
-                        visibility = (WGPUShaderStage_Vertex | WGPUShaderStage_Fragment | WGPUShaderStage_Compute);
-                    }
-                    ce_trackTextureView(
-                        renderPassEncoder->cmdEncoder,
-                        group->entries[bindingIndex].textureView,
-                        (ImageUsageSnap){
-                            .layout = VK_IMAGE_LAYOUT_GENERAL,
-                            .access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-                            .stage = toVulkanPipelineStageBits(visibility)
-                        }
-                    );
-                }
-            }
+    for(uint32_t i = 0;i < rpdesc->colorAttachmentCount;i++){
+        if(rpdesc->colorAttachments[i].resolveTarget){
+            ce_trackTextureViewBatched(enc, &attachmentBarriers, rpdesc->colorAttachments[i].resolveTarget, iur_resolve);
         }
     }
+
+    if(rpdesc->depthStencilAttachment){
+        wgvk_assert(rpdesc->depthStencilAttachment->view, "depthStencilAttachment.view is null");
+        ce_trackTextureViewBatched(enc, &attachmentBarriers, rpdesc->depthStencilAttachment->view, iur_depth);
+    }
+    ce_flushBarriers(enc, &attachmentBarriers);
+    //wgpuRenderPassEncoderSetViewport(ret, 0, 0, rpdesc->colorAttachments[0].view->width, rpdesc->colorAttachments[0].view->height, 0, 1);
+    return ret;
+    EXIT();
+}
+
+/**
+ * @brief Load op of a render attachment in dynamic rendering
+ * @details Loads of discarded contents were already turned into clears by CommandEncoder_initializeAttachments.
+ * Without a load op nothing is read back, so a transient attachment starts out as don't care instead of committing lazily allocated memory to load it
+ */
+static inline VkAttachmentLoadOp RenderAttachment_loadOp(WGPUTextureView view, WGPULoadOp loadOp){
+    if(loadOp == WGPULoadOp_Undefined && (view->texture->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)){
+        return VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    }
+    return toVulkanLoadOperation(loadOp);
+}
+
+/**
+ * @brief The viewport, scissor, blend constants and stencil reference a render pass starts out with
+ */
+static DefaultDynamicState RenderPassCommandBegin_defaultDynamicState(const RenderPassCommandBegin* beginInfo){
+    const float vpWidth = (float)beginInfo->colorAttachments[0].view->width;
+    const float vpHeight = (float)beginInfo->colorAttachments[0].view->height;
+    const DefaultDynamicState ret = {
+        .viewport = {
+            .x        = 0,
+            .y        = vpHeight,
+            .width    = vpWidth,
+            .height   = -vpHeight,
+            .minDepth = 0,
+            .maxDepth = 1,
+        },
+        .scissorRect = {
+            .offset = {0, 0},
+            .extent = {beginInfo->colorAttachments[0].view->width, beginInfo->colorAttachments[0].view->height},
+        },
+        .stencilReference = 0,
+        .blendConstants = {1, 1, 1, 1},
+    };
+    return ret;
+}
+
+/**
+ * @brief Sets all of state on destination, the viewport and scissor for viewportCount attachments
+ */
+static void DefaultDynamicState_apply(WGPUDevice device, VkCommandBuffer destination, const DefaultDynamicState* state, uint32_t viewportCount){
+    VkViewport viewports[MAX_COLOR_ATTACHMENTS];
+    VkRect2D scissors[MAX_COLOR_ATTACHMENTS];
+    viewportCount = viewportCount ? viewportCount : 1;
+    for(uint32_t i = 0;i < viewportCount;i++){
+        viewports[i] = state->viewport;
+        scissors[i] = state->scissorRect;
+    }
+    device->functions.vkCmdSetViewport(destination, 0, viewportCount, viewports);
+    device->functions.vkCmdSetScissor (destination, 0, viewportCount, scissors);
+    device->functions.vkCmdSetBlendConstants(destination, state->blendConstants);
+    device->functions.vkCmdSetStencilReference(destination, VK_STENCIL_FACE_FRONT_AND_BACK, state->stencilReference);
+}
+
+/**
+ * @brief Records the rendering scope of a render pass (begin, default state, replay, end) into destination
+ * @details Only reads the pass encoder, which allows running it on a worker thread (see RenderPassEncoder_dispatchParallel)
+ */
+static void RenderPassEncoder_recordRendering(WGPURenderPassEncoder renderPassEncoder, VkCommandBuffer destination){
+    WGPUDevice device = renderPassEncoder->device;
+    const RenderPassCommandBegin* beginInfo = &renderPassEncoder->beginInfo;
+    const TimestampScopes* timestamps = &renderPassEncoder->cmdEncoder->timestamps;
+
+    Device_recordTimestampScope(device, destination, timestamps, renderPassEncoder->timestampScope, 0);
+    if(beginInfo->timestampWritesPresent){
+        PassTimestampWrites_record(device, destination, &beginInfo->timestampWrites, 0);
+    }
+
+    VkImageView attachmentViews[2 * max_color_attachments + 2] = {0};// = (VkImageView* )RL_CALLOC(frp.allAttachments.size, sizeof(VkImageView) );
+    VkClearValue clearValues   [2 * max_color_attachments + 2] = {0};// = (VkClearValue*)RL_CALLOC(frp.allAttachments.size, sizeof(VkClearValue));
+    
+    VkRect2D renderPassRect = {
+        .offset = {0, 0},
+        .extent = {
+            beginInfo->colorAttachments[0].view->width, 
+            beginInfo->colorAttachments[0].view->height
+        }
+    };
+
     #if VULKAN_USE_DYNAMIC_RENDERING == 0
     RenderPassLayout rplayout = GetRenderPassLayout2(beginInfo);
     LayoutedRenderPass frp = LoadRenderPassFromLayout(renderPassEncoder->device, rplayout);
@@ -3648,13 +5323,13 @@ void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder){
             colorAttachments[i].resolveImageView = beginInfo->colorAttachments[i].resolveTarget->view;
             colorAttachments[i].resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
         }
-        colorAttachments[i].loadOp = toVulkanLoadOperation(beginInfo->colorAttachments[i].loadOp);
+        colorAttachments[i].loadOp = RenderAttachment_loadOp(beginInfo->colorAttachments[i].view, beginInfo->colorAttachments[i].loadOp);
         colorAttachments[i].storeOp = toVulkanStoreOperation(beginInfo->colorAttachments[i].storeOp);
     }
 
     const VkRenderingInfo info = {
         .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-        //.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT | VK_RENDERING_CONTENTS_INLINE_BIT_KHR,
+        .flags = (device->capabilities.secondaryRenderBundles && renderPassEncoder->executesBundles) ? (VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT | VK_RENDERING_CONTENTS_INLINE_BIT_KHR) : 0,
         .colorAttachmentCount = beginInfo->colorAttachmentCount,
         .pColorAttachments = colorAttachments,
         .pDepthAttachment = beginInfo->depthAttachmentPresent ? &(const VkRenderingAttachmentInfo){
@@ -3662,7 +5337,7 @@ void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder){
             .clearValue.depthStencil.depth = beginInfo->depthStencilAttachment.depthClearValue,
             .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
             .imageView = beginInfo->depthStencilAttachment.view->view,
-            .loadOp = toVulkanLoadOperation(beginInfo->depthStencilAttachment.depthLoadOp),
+            .loadOp = RenderAttachment_loadOp(beginInfo->depthStencilAttachment.view, beginInfo->depthStencilAttachment.depthLoadOp),
             .storeOp = toVulkanStoreOperation(beginInfo->depthStencilAttachment.depthStoreOp),
         } : NULL,
         .layerCount = 1,
@@ -3673,42 +5348,9 @@ void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder){
     };
     device->functions.vkCmdBeginRendering(destination, &info);
     #endif
-    float ones[4] = {1,1,1,1};
-    device->functions.vkCmdSetBlendConstants(destination, ones);
-    const float vpWidth = (float)beginInfo->colorAttachments[0].view->width;
-    const float vpHeight = (float)beginInfo->colorAttachments[0].view->height;
-    
-    const VkViewport viewport = {
-        .x        = 0,
-        .y        = vpHeight,
-        .width    = vpWidth,
-        .height   = -vpHeight,
-        .minDepth = 0,
-        .maxDepth = 1,
-    };
-
-    const VkRect2D scissor = {
-        .offset = {
-            .x = 0,
-            .y = 0,
-        },
-        .extent = {
-            .width = vpWidth,
-            .height = vpHeight,
-        }
-    };
-    for(uint32_t i = 0;i < beginInfo->colorAttachmentCount;i++){
-        device->functions.vkCmdSetViewport(destination, i, 1, &viewport);
-        device->functions.vkCmdSetScissor (destination, i, 1, &scissor);
-    }
-    recordVkCommands(renderPassEncoder->cmdEncoder, renderPassEncoder->device, &renderPassEncoder->bufferedCommands, beginInfo);
-    if(beginInfo->occlusionQuerySet){
-        wgpuQuerySetRelease(beginInfo->occlusionQuerySet);
-    }
-    if(beginInfo->timestampWritesPresent){
-        wgpuQuerySetRelease(beginInfo->timestampWrites.querySet);
-    }
-
+    const DefaultDynamicState defaultState = RenderPassCommandBegin_defaultDynamicState(beginInfo);
+    DefaultDynamicState_apply(device, destination, &defaultState, beginInfo->colorAttachmentCount);
+    recordVkCommandsToBuffer(renderPassEncoder->cmdEncoder, destination, renderPassEncoder->device, &renderPassEncoder->bufferedCommands, beginInfo);
     //for(uint32_t i = 0;i < beginInfo->colorAttachmentCount;i++){
     //    wgvk_assert(beginInfo->colorAttachments[i].view, "colorAttachments[%d].view is null", (int)i);
     //    ce_trackTextureView(destination, rpdesc->colorAttachments[i].view, iur_color);
@@ -3725,8 +5367,163 @@ void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder){
     #else
     device->functions.vkCmdEndRenderPass(destination);
     #endif
+    if(beginInfo->timestampWritesPresent){
+        PassTimestampWrites_record(device, destination, &beginInfo->timestampWrites, 1);
+    }
+    Device_recordTimestampScope(device, destination, timestamps, renderPassEncoder->timestampScope, 1);
+}
+
+static void RenderPassEncoder_releaseQuerySets(WGPURenderPassEncoder renderPassEncoder){
+    const RenderPassCommandBegin* beginInfo = &renderPassEncoder->beginInfo;
+    if(beginInfo->occlusionQuerySet){
+        wgpuQuerySetRelease(beginInfo->occlusionQuerySet);
+    }
+    if(beginInfo->timestampWritesPresent){
+        wgpuQuerySetRelease(beginInfo->timestampWrites.querySet);
+    }
+
+}
+
+struct ParallelPassRecording{
+    WGPURenderPassEncoder pass;
+    uint32_t cacheIndex;
+    VkCommandBuffer buffer;
+    uint32_t threadSlot;
+    wgvk_job_t* job;
+};
+
+static void* RenderPassEncoder_parallelRecordJob(void* arg){
+    ParallelPassRecording* recording = (ParallelPassRecording*)arg;
+    WGPUDevice device = recording->pass->device;
+    // Worker threads record from their own pool, so nothing here needs a lock
+    PerframeCache* pfcache = DeviceGetFIFCache(device, recording->cacheIndex);
+    recording->threadSlot = wgvk_thread_slot();
+    recording->buffer = PerframeCache_beginPrimaryCommandBuffer(device, pfcache, &recording->threadSlot);
+    RenderPassEncoder_recordRendering(recording->pass, recording->buffer);
+    PerframeCache_endPrimaryCommandBuffer(device, pfcache, recording->threadSlot, recording->buffer);
+    return NULL;
+}
+
+/**
+ * @brief Decides whether a pass is replayed on device->thread_pool instead of inline
+ */
+static WGPUBool RenderPassEncoder_shouldRecordParallel(WGPURenderPassEncoder renderPassEncoder){
+    WGPUDevice device = renderPassEncoder->device;
+    #if VULKAN_USE_DYNAMIC_RENDERING == 0
+    // LoadRenderPassFromLayout touches the shared renderPassCache
+    return 0;
+    #else
+    if(!device->parallelPassRecording || device->thread_pool == NULL)return 0;
+    if(renderPassEncoder->bufferedCommands.count < device->parallelPassMinCommands)return 0;
+    return 1;
+    #endif
+}
+
+/**
+ * @brief Seals the encoder's current primary, hands the pass replay to a worker and continues in a fresh primary
+ * @details The pass holds an additional reference until CommandEncoder_joinSegments has collected the result.
+ */
+static void RenderPassEncoder_dispatchParallel(WGPURenderPassEncoder renderPassEncoder){
+    WGPUCommandEncoder encoder = renderPassEncoder->cmdEncoder;
+    WGPUDevice device = encoder->device;
+    PerframeCache* pfcache = DeviceGetFIFCache(device, encoder->cacheIndex);
+
+    PerframeCache_endPrimaryCommandBuffer(device, pfcache, encoder->threadSlot, encoder->buffer);
+    EncoderSegmentVector_push_back(&encoder->segments, (EncoderSegment){
+        .buffer = encoder->buffer,
+        .threadSlot = encoder->threadSlot,
+    });
+
+    ParallelPassRecording* recording = RL_CALLOC(1, sizeof(ParallelPassRecording));
+    recording->pass = renderPassEncoder;
+    recording->cacheIndex = encoder->cacheIndex;
+    wgpuRenderPassEncoderAddRef(renderPassEncoder);
+    EncoderSegmentVector_push_back(&encoder->segments, (EncoderSegment){
+        .recording = recording,
+    });
+    recording->job = wgvk_job_enqueue(device->thread_pool, RenderPassEncoder_parallelRecordJob, recording);
+    if(recording->job == NULL){
+        RenderPassEncoder_parallelRecordJob(recording);
+    }
+
+    encoder->threadSlot = wgvk_thread_slot();
+    encoder->buffer = PerframeCache_beginPrimaryCommandBuffer(device, pfcache, &encoder->threadSlot);
+}
+
+/**
+ * @brief Waits for all parallel pass recordings of an encoder, after which every segment holds its buffer
+ */
+static void CommandEncoder_joinSegments(WGPUCommandEncoder encoder){
+    for(size_t i = 0;i < encoder->segments.size;i++){
+        EncoderSegment* segment = encoder->segments.data + i;
+        ParallelPassRecording* recording = segment->recording;
+        if(recording == NULL)continue;
+        if(recording->job){
+            wgvk_job_wait(recording->job, NULL);
+            wgvk_job_destroy(recording->job);
+        }
+        segment->buffer = recording->buffer;
+        segment->threadSlot = recording->threadSlot;
+        RenderPassEncoder_releaseQuerySets(recording->pass);
+        wgpuRenderPassEncoderRelease(recording->pass);
+        RL_FREE(recording);
+        segment->recording = NULL;
+    }
+}
+
+/**
+ * @brief Records the pass into its command encoder
+ * @details Everything the pass uses has already been tracked into the encoder while it was encoded (see 
+ * wgpuRenderPassEncoderSetBindGroup and RenderPassEncoder_trackIndirectBuffer), so only the replay is left.
+ */
+void wgpuRenderPassEncoderEnd(WGPURenderPassEncoder renderPassEncoder){
+    ENTRY();
+    if(RenderPassEncoder_shouldRecordParallel(renderPassEncoder)){
+        RenderPassEncoder_dispatchParallel(renderPassEncoder);
+    }
+    else{
+        RenderPassEncoder_recordRendering(renderPassEncoder, renderPassEncoder->cmdEncoder->buffer);
+        RenderPassEncoder_releaseQuerySets(renderPassEncoder);
+    }
     EXIT();
 }
+/**
+ * @brief Records the reset of every query the encoder writes into one primary that becomes its first segment
+ * @details Only written queries are reset, one vkCmdResetQueryPool per run of consecutive ones. Results of queries 
+ * in between, written by earlier submissions, stay intact.
+ */
+static void CommandEncoder_recordQueryResets(WGPUCommandEncoder encoder){
+    if(encoder->queryWrites.size == 0)return;
+    WGPUDevice device = encoder->device;
+    PerframeCache* pfcache = DeviceGetFIFCache(device, encoder->cacheIndex);
+    uint32_t threadSlot = wgvk_thread_slot();
+    VkCommandBuffer prologue = PerframeCache_beginPrimaryCommandBuffer(device, pfcache, &threadSlot);
+    for(size_t i = 0;i < encoder->queryWrites.size;i++){
+        const QueryWrites* writes = encoder->queryWrites.data + i;
+        const uint32_t count = writes->querySet->count;
+        for(uint32_t query = 0;query < count;){
+            if(!(writes->written[query / 64] & (1ull << (query % 64)))){
+                query++;
+                continue;
+            }
+            const uint32_t firstQuery = query;
+            while(query < count && (writes->written[query / 64] & (1ull << (query % 64)))){
+                query++;
+            }
+            device->functions.vkCmdResetQueryPool(prologue, writes->querySet->queryPool, firstQuery, query - firstQuery);
+        }
+    }
+    PerframeCache_endPrimaryCommandBuffer(device, pfcache, threadSlot, prologue);
+    CommandEncoder_freeQueryWrites(encoder);
+
+    EncoderSegmentVector_push_back(&encoder->segments, (EncoderSegment){0});
+    memmove(encoder->segments.data + 1, encoder->segments.data, (encoder->segments.size - 1) * sizeof(EncoderSegment));
+    encoder->segments.data[0] = (EncoderSegment){
+        .buffer = prologue,
+        .threadSlot = threadSlot,
+    };
+}
+
 /**
  * @brief Ends a CommandEncoder into a CommandBuffer
  * @details This is a one-way transition for WebGPU, therefore we can move resource tracking
@@ -3742,13 +5539,21 @@ WGPUCommandBuffer wgpuCommandEncoderFinish(WGPUCommandEncoder commandEncoder, co
     ret->refCount = 1;
     wgvk_assert(commandEncoder->movedFrom == 0, "Command encoder is already invalidated");
     commandEncoder->movedFrom = 1;
-    commandEncoder->device->functions.vkEndCommandBuffer(commandEncoder->buffer);
+    PerframeCache_endPrimaryCommandBuffer(commandEncoder->device, DeviceGetFIFCache(commandEncoder->device, commandEncoder->cacheIndex), commandEncoder->threadSlot, commandEncoder->buffer);
+    CommandEncoder_joinSegments(commandEncoder);
+    CommandEncoder_recordQueryResets(commandEncoder);
+    EncoderSegmentVector_move(&ret->segments, &commandEncoder->segments);
 
     WGPURenderPassEncoderSet_move(&ret->referencedRPs, &commandEncoder->referencedRPs);
     WGPUComputePassEncoderSet_move(&ret->referencedCPs, &commandEncoder->referencedCPs);
     WGPURaytracingPassEncoderSet_move(&ret->referencedRTs, &commandEncoder->referencedRTs);
     ResourceUsage_move(&ret->resourceUsage, &commandEncoder->resourceUsage);
     ret->cacheIndex = commandEncoder->cacheIndex;
+    ret->threadSlot = commandEncoder->threadSlot;
+    ret->timestamps = commandEncoder->timestamps;
+    commandEncoder->timestamps = (TimestampScopes){0};
+    BufferChunkInitMap_move(&ret->bufferChunkInits, &commandEncoder->bufferChunkInits);
+    TextureSubresourceInitMap_move(&ret->textureInits, &commandEncoder->textureInits);
     ret->buffer = commandEncoder->buffer;
     ret->device = commandEncoder->device;
     commandEncoder->buffer = NULL;
@@ -3761,12 +5566,203 @@ WGPUCommandBuffer wgpuCommandEncoderFinish(WGPUCommandEncoder commandEncoder, co
     EXIT();
 }
 
+static void CommandBufferAndSomeState_flushBindGroups(CommandBufferAndSomeState* state){
+    if(state->dirtyBindGroups == 0 || state->lastLayout == VK_NULL_HANDLE)return;
+    for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
+        if(!(state->dirtyBindGroups & (1u << groupIndex)))continue;
+        const BoundBindGroup* bound = state->bindGroups + groupIndex;
+        state->device->functions.vkCmdBindDescriptorSets(
+            state->buffer,
+            bound->bindPoint,
+            state->lastLayout,
+            groupIndex,
+            1,
+            &bound->group->set,
+            bound->dynamicOffsetCount,
+            bound->dynamicOffsets
+        );
+    }
+    state->dirtyBindGroups = 0;
+}
+
+/**
+ * @brief Pushes the words of immediate data set but not yet pushed for the bound layout, as one range
+ */
+static void CommandBufferAndSomeState_flushImmediateData(CommandBufferAndSomeState* state){
+    if(state->lastLayout == VK_NULL_HANDLE || state->lastImmediateDataSize == 0)return;
+    const uint32_t layoutWords = state->lastImmediateDataSize / 4;
+    const uint32_t inLayout = (layoutWords >= 32) ? UINT32_MAX : ((1u << layoutWords) - 1u);
+    const uint32_t pending = state->immediateDataSet & ~state->immediateDataPushed & inLayout;
+    if(pending == 0)return;
+    uint32_t first = 0, last = 31;
+    while(!(pending & (1u << first)))++first;
+    while(!(pending & (1u << last)))--last;
+    state->device->functions.vkCmdPushConstants(
+        state->buffer,
+        state->lastLayout,
+        VK_SHADER_STAGE_ALL,
+        first * 4,
+        (last - first + 1) * 4,
+        state->immediateData + first * 4
+    );
+    const uint32_t span = ((last == 31) ? UINT32_MAX : ((1u << (last + 1)) - 1u)) & ~((1u << first) - 1u);
+    state->immediateDataPushed |= span;
+}
+
+/**
+ * @brief Emits the state the next draw, dispatch or trace depends on
+ */
+static void CommandBufferAndSomeState_flush(CommandBufferAndSomeState* state){
+    CommandBufferAndSomeState_flushBindGroups(state);
+    CommandBufferAndSomeState_flushImmediateData(state);
+}
+
+static void CommandBufferAndSomeState_bindPipeline(CommandBufferAndSomeState* state, VkPipelineBindPoint bindPoint, VkPipeline pipeline, WGPUPipelineLayout layout){
+    if(pipeline != state->lastPipeline){
+        state->device->functions.vkCmdBindPipeline(state->buffer, bindPoint, pipeline);
+        state->lastPipeline = pipeline;
+    }
+    if(layout->layout != state->lastLayout){
+        // Sets bound against another layout may have been disturbed, bind all of them again
+        for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
+            if(state->bindGroups[groupIndex].group)state->dirtyBindGroups |= (1u << groupIndex);
+        }
+        // Same for push constants, unless the range is identical
+        if(layout->immediateDataSize != state->lastImmediateDataSize){
+            state->immediateDataPushed = 0;
+        }
+        state->lastLayout = layout->layout;
+        state->lastImmediateDataSize = layout->immediateDataSize;
+    }
+}
+
+/**
+ * @brief Forgets everything bound, after something outside of the tracked stream (e.g. a render bundle) recorded into the buffer
+ * @details Render bundles cannot change dynamic state, so the viewport and scissor stay known.
+ */
+static void CommandBufferAndSomeState_invalidate(CommandBufferAndSomeState* state){
+    state->lastLayout = VK_NULL_HANDLE;
+    state->lastPipeline = VK_NULL_HANDLE;
+    memset((void*)state->vertexBuffers, 0, sizeof(state->vertexBuffers));
+    state->indexBuffer = NULL;
+    memset((void*)state->bindGroups, 0, sizeof(state->bindGroups));
+    state->dirtyBindGroups = 0;
+    state->immediateDataPushed = 0;
+}
+
+/**
+ * @brief Tracks the buffers of the bound compute bind groups before a dispatch
+ * @details Slots set since the last dispatch track all their buffers. For unchanged slots the usage records 
+ * are already current and the only hazard is a previous dispatch writing them, covered by one memory barrier.
+ */
+static void CommandBufferAndSomeState_trackComputeBindGroups(CommandBufferAndSomeState* state){
+    WGPUBool writeAfterWrite = 0;
+    for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
+        const WGPUBindGroup group = state->computeBindGroups[groupIndex];
+        if(group == NULL)continue;
+        if(state->untrackedComputeBindGroups & (1u << groupIndex)){
+            for(uint32_t i = 0;i < group->bufferUsageCount;i++){
+                ce_trackBuffer(state->cmdEncoder, group->bufferUsages[i].buffer, group->bufferUsages[i].usage);
+            }
+            for(uint32_t a = 0;a < group->slotAllocatorCount;a++){
+                const BindGroupSlotAllocator* allocator = group->slotAllocators + a;
+                const WGPUBindGroupLayoutEntry* layoutEntry = group->layout->entries + allocator->layoutIndex;
+                for(uint32_t slot = 0;slot < allocator->contentEnd;slot++){
+                    if(allocator->contents[slot].buffer == NULL)continue;
+                    ce_trackBuffer(state->cmdEncoder, allocator->contents[slot].buffer, (BufferUsageSnap){
+                        .stage  = toVulkanPipelineStageBits(layoutEntry->visibility),
+                        .access = extractVkAccessFlags(layoutEntry),
+                    });
+                }
+            }
+        }
+        else{
+            writeAfterWrite |= group->writesBuffers;
+        }
+    }
+    state->untrackedComputeBindGroups = 0;
+    if(writeAfterWrite){
+        const VkMemoryBarrier memoryBarrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+        };
+        state->device->functions.vkCmdPipelineBarrier(
+            state->buffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1, &memoryBarrier,
+            0, NULL,
+            0, NULL
+        );
+    }
+}
+
+/**
+ * @brief Returns the secondary command buffer holding bundle recorded against state, recording it on first use
+ * @details Caller holds device->secondaryCommandPoolMutex. Returns VK_NULL_HANDLE once the bundle has 
+ * WGVK_RENDERBUNDLE_CACHE_SIZE secondaries, the bundle is then replayed inline. The secondaries don't 
+ * reference the executing encoder, they live until wgpuRenderBundleRelease.
+ */
+static VkCommandBuffer RenderBundle_secondaryFor(WGPURenderBundle bundle, const DefaultDynamicState* state){
+    WGPUDevice device = bundle->device;
+    VkCommandBuffer* cached = DynamicStateCommandBufferMap_get(&bundle->encodedCommandBuffers, *state);
+    if(cached){
+        return *cached;
+    }
+    if(bundle->encodedCommandBuffers.current_size >= WGVK_RENDERBUNDLE_CACHE_SIZE){
+        return VK_NULL_HANDLE;
+    }
+    const VkCommandBufferAllocateInfo bai = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = device->secondaryCommandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1
+    };
+    VkCommandBuffer secondary = VK_NULL_HANDLE;
+    if(device->functions.vkAllocateCommandBuffers(device->device, &bai, &secondary) != VK_SUCCESS){
+        return VK_NULL_HANDLE;
+    }
+    
+    // Has to match the VkRenderingInfo of the executing pass, which never binds a separate stencil attachment
+    const VkCommandBufferInheritanceRenderingInfo renderingInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+        .colorAttachmentCount = bundle->colorAttachmentCount,
+        .pColorAttachmentFormats = bundle->colorAttachmentFormats,
+        .depthAttachmentFormat = bundle->depthStencilFormat,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .rasterizationSamples = bundle->sampleCount,
+    };
+    const VkCommandBufferInheritanceInfo inheritanceInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = &renderingInfo,
+        .occlusionQueryEnable = device->capabilities.inheritedQueries,
+    };
+    const VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
+        .pInheritanceInfo = &inheritanceInfo
+    };
+    device->functions.vkBeginCommandBuffer(secondary, &beginInfo);
+    // Secondaries inherit no dynamic state
+    DefaultDynamicState_apply(device, secondary, state, bundle->colorAttachmentCount);
+    const RenderPassCommandBegin dummyBeginInfo = {
+        .colorAttachmentCount = bundle->colorAttachmentCount
+    };
+    recordVkCommandsToBuffer(NULL, secondary, device, &bundle->bufferedCommands, &dummyBeginInfo);
+    device->functions.vkEndCommandBuffer(secondary);
+    DynamicStateCommandBufferMap_put(&bundle->encodedCommandBuffers, *state, secondary);
+    return secondary;
+}
+
 void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCommandGeneric* command, const RenderPassCommandBegin *beginInfo){
     VkCommandBuffer destinationVk = destination_->buffer;
     WGPUDevice device = destination_->device;
     switch(command->type){
         case rp_command_type_draw_indexed_indirect:{
             const RenderPassCommandDrawIndexedIndirect* drawIndexedIndirect = &command->drawIndexedIndirect;
+            CommandBufferAndSomeState_flush(destination_);
             device->functions.vkCmdDrawIndexedIndirect(
                 destinationVk,
                 drawIndexedIndirect->indirectBuffer->buffer,
@@ -3780,6 +5776,7 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         case rp_command_type_draw_indirect:{
             
             const RenderPassCommandDrawIndirect* drawIndirect = &command->drawIndirect;
+            CommandBufferAndSomeState_flush(destination_);
             device->functions.vkCmdDrawIndirect(
                 destinationVk,
                 drawIndirect->indirectBuffer->buffer,
@@ -3805,6 +5802,7 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
                 (float)setBlendConstant->color.b,
                 (float)setBlendConstant->color.a,
             };
+            memcpy(destination_->dynamicState.blendConstants, buffer, sizeof(buffer));
             device->functions.vkCmdSetBlendConstants(
                 destinationVk,
                 buffer
@@ -3813,7 +5811,12 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         break;
         case rp_command_type_set_viewport:{
             const RenderPassCommandSetViewport* vp = &command->setViewport;
-            destination_->dynamicState.viewport = (VkViewport){vp->x, vp->y, vp->width, vp->height, vp->minDepth, vp->maxDepth};
+            const VkViewport newViewport = {vp->x, vp->y, vp->width, vp->height, vp->minDepth, vp->maxDepth};
+            if(destination_->viewportSet && memcmp(&destination_->dynamicState.viewport, &newViewport, sizeof(VkViewport)) == 0){
+                break;
+            }
+            destination_->dynamicState.viewport = newViewport;
+            destination_->viewportSet = 1;
             const VkViewport viewport[8] = {
                 {vp->x, vp->y, vp->width, vp->height, vp->minDepth, vp->maxDepth},
                 {vp->x, vp->y, vp->width, vp->height, vp->minDepth, vp->maxDepth},
@@ -3828,7 +5831,12 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         }break;
         case rp_command_type_set_scissor_rect:{
             const RenderPassCommandSetScissorRect* sr = &command->setScissorRect;
-            destination_->dynamicState.scissorRect = (VkRect2D){{sr->x, sr->y}, {sr->width, sr->height}};
+            const VkRect2D newScissor = {{sr->x, sr->y}, {sr->width, sr->height}};
+            if(destination_->scissorSet && memcmp(&destination_->dynamicState.scissorRect, &newScissor, sizeof(VkRect2D)) == 0){
+                break;
+            }
+            destination_->dynamicState.scissorRect = newScissor;
+            destination_->scissorSet = 1;
             const VkRect2D scissors[8] = {
                 {{sr->x, sr->y}, {sr->width, sr->height}},
                 {{sr->x, sr->y}, {sr->width, sr->height}},
@@ -3844,6 +5852,7 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
 
         case rp_command_type_draw: {
             const RenderPassCommandDraw* draw = &command->draw;
+            CommandBufferAndSomeState_flush(destination_);
             device->functions.vkCmdDraw(
                 destinationVk, 
                 draw->vertexCount,
@@ -3855,6 +5864,7 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         break;
         case rp_command_type_draw_indexed: {
             const RenderPassCommandDrawIndexed* drawIndexed = &command->drawIndexed;
+            CommandBufferAndSomeState_flush(destination_);
             device->functions.vkCmdDrawIndexed(
                 destinationVk,
                 drawIndexed->indexCount,
@@ -3867,6 +5877,13 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         break;
         case rp_command_type_set_vertex_buffer: {
             const RenderPassCommandSetVertexBuffer* setVertexBuffer = &command->setVertexBuffer;
+            if(setVertexBuffer->slot < 8){
+                if(destination_->vertexBuffers[setVertexBuffer->slot] == setVertexBuffer->buffer && destination_->vertexBufferOffsets[setVertexBuffer->slot] == setVertexBuffer->offset){
+                    break;
+                }
+                destination_->vertexBuffers[setVertexBuffer->slot] = setVertexBuffer->buffer;
+                destination_->vertexBufferOffsets[setVertexBuffer->slot] = setVertexBuffer->offset;
+            }
             device->functions.vkCmdBindVertexBuffers(
                 destinationVk,
                 setVertexBuffer->slot,
@@ -3878,6 +5895,12 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         break;
         case rp_command_type_set_index_buffer: {
             const RenderPassCommandSetIndexBuffer* setIndexBuffer = &command->setIndexBuffer;
+            if(destination_->indexBuffer == setIndexBuffer->buffer && destination_->indexBufferOffset == setIndexBuffer->offset && destination_->indexFormat == setIndexBuffer->format){
+                break;
+            }
+            destination_->indexBuffer = setIndexBuffer->buffer;
+            destination_->indexBufferOffset = setIndexBuffer->offset;
+            destination_->indexFormat = setIndexBuffer->format;
             device->functions.vkCmdBindIndexBuffer(
                 destinationVk,
                 setIndexBuffer->buffer->buffer,
@@ -3888,42 +5911,67 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         break;
         case rp_command_type_set_bind_group: {
             const RenderPassCommandSetBindGroup* setBindGroup = &command->setBindGroup;
-            if(setBindGroup->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS)
+            if(setBindGroup->bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS){
                 destination_->graphicsBindGroups[setBindGroup->groupIndex] = setBindGroup->group;
-            else
+            }
+            else{
+                if(destination_->computeBindGroups[setBindGroup->groupIndex] != setBindGroup->group){
+                    destination_->untrackedComputeBindGroups |= (1u << setBindGroup->groupIndex);
+                }
                 destination_->computeBindGroups[setBindGroup->groupIndex] = setBindGroup->group;
-            if(destination_->lastLayout){
-                device->functions.vkCmdBindDescriptorSets(
-                    destinationVk,
-                    setBindGroup->bindPoint,
-                    destination_->lastLayout,
-                    setBindGroup->groupIndex,
-                    1,
-                    &setBindGroup->group->set,
-                    setBindGroup->dynamicOffsetCount,
-                    setBindGroup->dynamicOffsets
-                );
+            }
+            const uint32_t slotBit = 1u << setBindGroup->groupIndex;
+            BoundBindGroup* bound = destination_->bindGroups + setBindGroup->groupIndex;
+            const WGPUBool unchanged = !(destination_->dirtyBindGroups & slotBit)
+                && bound->group == setBindGroup->group
+                && bound->bindPoint == setBindGroup->bindPoint
+                && bound->dynamicOffsetCount == setBindGroup->dynamicOffsetCount
+                && (setBindGroup->dynamicOffsetCount == 0 || memcmp(bound->dynamicOffsets, setBindGroup->dynamicOffsets, setBindGroup->dynamicOffsetCount * sizeof(uint32_t)) == 0);
+            if(unchanged){
+                break;
+            }
+            bound->group = setBindGroup->group;
+            bound->bindPoint = setBindGroup->bindPoint;
+            bound->dynamicOffsetCount = (uint32_t)setBindGroup->dynamicOffsetCount;
+            bound->dynamicOffsets = setBindGroup->dynamicOffsets;
+            destination_->dirtyBindGroups |= slotBit;
+        }
+        break;
+        case rp_command_type_set_immediate_data: {
+            // Only shadowed here, CommandBufferAndSomeState_flushImmediateData pushes changed words before the next draw
+            const RenderPassCommandSetImmediateData* setImmediateData = &command->setImmediateData;
+            const uint8_t* data = (const uint8_t*)setImmediateData->data;
+            for(uint32_t word = setImmediateData->offset / 4;word < (setImmediateData->offset + setImmediateData->size) / 4;word++){
+                const uint32_t wordBit = 1u << word;
+                uint8_t* shadow = destination_->immediateData + word * 4;
+                const uint8_t* incoming = data + (word * 4 - setImmediateData->offset);
+                if((destination_->immediateDataPushed & wordBit) && memcmp(shadow, incoming, 4) == 0){
+                    continue;
+                }
+                memcpy(shadow, incoming, 4);
+                destination_->immediateDataSet |= wordBit;
+                destination_->immediateDataPushed &= ~wordBit;
             }
         }
         break;
         case rp_command_type_set_render_pipeline: {
             const RenderPassCommandSetPipeline* setRenderPipeline = &command->setRenderPipeline;
-            device->functions.vkCmdBindPipeline(
-                destinationVk,
+            CommandBufferAndSomeState_bindPipeline(
+                destination_,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
-                setRenderPipeline->pipeline->renderPipeline
+                setRenderPipeline->pipeline->renderPipeline,
+                setRenderPipeline->pipeline->layout
             );
-            destination_->lastLayout = setRenderPipeline->pipeline->layout->layout;
         }
         break;
         case rp_command_type_set_raytracing_pipeline: {
             const RenderPassCommandSetRaytracingPipeline* setRaytracingPipeline = &command->setRaytracingPipeline;
-            device->functions.vkCmdBindPipeline(
-                destinationVk,
+            CommandBufferAndSomeState_bindPipeline(
+                destination_,
                 VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
-                setRaytracingPipeline->pipeline->raytracingPipeline
+                setRaytracingPipeline->pipeline->raytracingPipeline,
+                setRaytracingPipeline->pipeline->layout
             );
-            destination_->lastLayout = setRaytracingPipeline->pipeline->layout->layout;
             destination_->lastRaytracingPipeline = setRaytracingPipeline->pipeline;
         }
         break;
@@ -3932,6 +5980,7 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
                 
             WGPURaytracingPipeline pipeline = destination_->lastRaytracingPipeline;
             wgvk_assert(pipeline != NULL, "vkCmdTraceRaysKHR called without a bound ray tracing pipeline.");
+            CommandBufferAndSomeState_flush(destination_);
                 
             WGPUBuffer sbtBuffer = pipeline->sbtBuffer;
             VkDeviceSize totalSbtSize = pipeline->totalSbtSize;
@@ -3991,104 +6040,50 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         case rp_command_type_execute_renderbundle:{
             const RenderPassCommandExecuteRenderbundles* executeRenderBundles = &command->executeRenderBundles;
             WGPURenderBundle bundle = executeRenderBundles->renderBundle;
-            DefaultDynamicState ds = destination_->dynamicState;
-            VkCommandBuffer* maybeBuffer = DynamicStateCommandBufferMap_get(&bundle->encodedCommandBuffers, ds);
-            VkCommandBuffer executedBuffer;
-            #if RENDERBUNDLES_AS_SECONDARY_COMMANDBUFFERS == 1
-            if(maybeBuffer){
-                executedBuffer = *maybeBuffer;
+            const DefaultDynamicState ds = destination_->dynamicState;
+            VkCommandBuffer executedBuffer = VK_NULL_HANDLE;
+            // Without inheritedQueries, secondaries must not run inside an active query
+            const WGPUBool secondaryAllowed = device->capabilities.inheritedQueries || !destination_->occlusionQueryActive;
+            if(device->capabilities.secondaryRenderBundles && secondaryAllowed && !cmpDynamicState(ds, CLITERAL(DefaultDynamicState){0})){
+                wgvk_mutex_lock(device->secondaryCommandPoolMutex);
+                executedBuffer = RenderBundle_secondaryFor(bundle, &ds);
+                wgvk_mutex_unlock(device->secondaryCommandPoolMutex);
+            }
+            if(executedBuffer != VK_NULL_HANDLE){
+                device->functions.vkCmdExecuteCommands(destinationVk, 1, &executedBuffer);
+                CommandBufferAndSomeState_invalidate(destination_);
+                // Dynamic state is undefined after vkCmdExecuteCommands, but WebGPU keeps it across bundles
+                DefaultDynamicState_apply(device, destinationVk, &ds, beginInfo->colorAttachmentCount);
             }
             else{
-                VkCommandBufferAllocateInfo bai = {
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-                    .commandPool = device->secondaryCommandPool,
-                    .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
-                    .commandBufferCount = 1
-                };
-                device->functions.vkAllocateCommandBuffers(device->device, &bai, &executedBuffer);
-                
-                VkCommandBufferInheritanceRenderingInfo renderingInfo = {
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
-                    .colorAttachmentCount = bundle->colorAttachmentCount,
-                    .pColorAttachmentFormats = bundle->colorAttachmentFormats,
-                    .depthAttachmentFormat = bundle->depthStencilFormat,
-                    .stencilAttachmentFormat = bundle->depthStencilFormat,
-                    .rasterizationSamples = 1 // todo
-                };
-            
-                VkCommandBufferInheritanceInfo inheritanceInfo = {
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
-                    .pNext = &renderingInfo,
-                };
-            
-                VkCommandBufferBeginInfo beginInfo = {
-                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-                    .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
-                    .pInheritanceInfo = &inheritanceInfo
-                };
-                device->functions.vkBeginCommandBuffer(executedBuffer, &beginInfo);
                 RenderPassCommandBegin dummyBeginInfo = {
                     .colorAttachmentCount = bundle->colorAttachmentCount
                 };
-                
-                for(uint32_t ai = 0;ai < bundle->colorAttachmentCount;ai++){
-                    device->functions.vkCmdSetViewport(executedBuffer, 0, 1, &ds.viewport   );
-                    if(ds.scissorRect.extent.width != UINT32_MAX){
-                        device->functions.vkCmdSetScissor (executedBuffer, 0, 1, &ds.scissorRect);
-                    }
-                    else{
-                        VkRect2D defaultRect = {
-                            .offset = {0, 0},
-                            .extent = {ds.viewport.width, ds.viewport.height}
-                        };
-                        device->functions.vkCmdSetScissor (executedBuffer, 0, 1, &defaultRect);
-                    }
-                }
-                recordVkCommands(executedBuffer, device, &bundle->bufferedCommands, &dummyBeginInfo);
-                device->functions.vkEndCommandBuffer(executedBuffer);
-                DynamicStateCommandBufferMap_put(&bundle->encodedCommandBuffers, ds, executedBuffer);
+                recordVkCommandsToBuffer(destination_->cmdEncoder, destinationVk, device, &bundle->bufferedCommands, &dummyBeginInfo);
+                CommandBufferAndSomeState_invalidate(destination_);
             }
-            device->functions.vkCmdExecuteCommands(destination, 1, &executedBuffer);
-            #else
-            RenderPassCommandBegin dummyBeginInfo = {
-                .colorAttachmentCount = bundle->colorAttachmentCount
-            };
-            recordVkCommands(destination_->cmdEncoder, device, &bundle->bufferedCommands, &dummyBeginInfo);
-            #endif
         }break;
         case cp_command_type_set_compute_pipeline: {
             const ComputePassCommandSetPipeline* setComputePipeline = &command->setComputePipeline;
-            memset((void*)destination_->computeBindGroups, 0, sizeof(destination_->computeBindGroups));
-            device->functions.vkCmdBindPipeline(
-                destinationVk,
+            // Bound groups stay bound across the switch, the next dispatch tracks all of them again
+            for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
+                if(destination_->computeBindGroups[groupIndex]){
+                    destination_->untrackedComputeBindGroups |= (1u << groupIndex);
+                }
+            }
+            CommandBufferAndSomeState_bindPipeline(
+                destination_,
                 VK_PIPELINE_BIND_POINT_COMPUTE,
-                setComputePipeline->pipeline->computePipeline
+                setComputePipeline->pipeline->computePipeline,
+                setComputePipeline->pipeline->layout
             );
-
-            destination_->lastLayout = setComputePipeline->pipeline->layout->layout;
         }
         break;
         case cp_command_type_dispatch_workgroups: {
             const ComputePassCommandDispatchWorkgroups* dispatch = &command->dispatchWorkgroups;
             //ce_trackBuffer(WGPUCommandEncoder encoder, WGPUBuffer buffer, BufferUsageSnap usage)
-            for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
-                if(destination_->computeBindGroups[groupIndex]){
-                    const WGPUBindGroup group = destination_->computeBindGroups[groupIndex];
-                    for(uint32_t entryIndex = 0;entryIndex < group->entryCount;entryIndex++){
-                        const WGPUBindGroupEntry* entry = group->entries + entryIndex;
-                        uint32_t bglEntryIndex = 0;
-                        for(;bglEntryIndex < group->layout->entryCount;bglEntryIndex++){
-                            if(group->layout->entries[bglEntryIndex].binding == entry->binding)break;
-                        }
-                        if(entry->buffer){
-                            ce_trackBuffer(destination_->cmdEncoder, entry->buffer, (BufferUsageSnap){
-                                .access = extractVkAccessFlags(group->layout->entries + bglEntryIndex),
-                                .stage  = toVulkanPipelineStageBits(group->layout->entries[bglEntryIndex].visibility)
-                            });
-                        }
-                    }
-                }
-            }
+            CommandBufferAndSomeState_trackComputeBindGroups(destination_);
+            CommandBufferAndSomeState_flush(destination_);
             device->functions.vkCmdDispatch(
                 destinationVk, 
                 dispatch->x, 
@@ -4099,24 +6094,7 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
         }
         break;
         case cp_command_type_dispatch_workgroups_indirect:{
-            for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
-                if(destination_->computeBindGroups[groupIndex]){
-                    const WGPUBindGroup group = destination_->computeBindGroups[groupIndex];
-                    for(uint32_t entryIndex = 0;entryIndex < group->entryCount;entryIndex++){
-                        const WGPUBindGroupEntry* entry = group->entries + entryIndex;
-                        uint32_t bglEntryIndex = 0;
-                        for(;bglEntryIndex < group->layout->entryCount;bglEntryIndex++){
-                            if(group->layout->entries[bglEntryIndex].binding == entry->binding)break;
-                        }
-                        if(entry->buffer){
-                            ce_trackBuffer(destination_->cmdEncoder, entry->buffer, (BufferUsageSnap){
-                                .access = extractVkAccessFlags(group->layout->entries + bglEntryIndex),
-                                .stage  = toVulkanPipelineStageBits(group->layout->entries[bglEntryIndex].visibility)
-                            });
-                        }
-                    }
-                }
-            }
+            CommandBufferAndSomeState_trackComputeBindGroups(destination_);
             
             const ComputePassCommandDispatchWorkgroupsIndirect* dispatch = &command->dispatchWorkgroupsIndirect;
 
@@ -4124,7 +6102,15 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
                 .access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
                 .stage  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
             });
+            // The indirect read replaced the usage record, groups that also bind this buffer have to track it again
+            for(uint32_t groupIndex = 0;groupIndex < 8;groupIndex++){
+                const WGPUBindGroup group = destination_->computeBindGroups[groupIndex];
+                if(group && BufferUsageRecordMap_get(&group->resourceUsage.referencedBuffers, dispatch->buffer)){
+                    destination_->untrackedComputeBindGroups |= (1u << groupIndex);
+                }
+            }
             
+            CommandBufferAndSomeState_flush(destination_);
             device->functions.vkCmdDispatchIndirect(
                 destinationVk,
                 dispatch->buffer->buffer,
@@ -4132,19 +6118,67 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
             );
         }break;
         case rp_command_type_begin_occlusion_query:{
-
+            wgvk_assert(!destination_->occlusionQueryActive, "Occlusion queries can't be nested");
+            destination_->occlusionQueryActive = 1;
+            destination_->occlusionQueryIndex = command->beginOcclusionQuery.queryIndex;
+            device->functions.vkCmdBeginQuery(destinationVk, beginInfo->occlusionQuerySet->queryPool, destination_->occlusionQueryIndex, 0);
         }break;
         case rp_command_type_end_occlusion_query:{
-
+            // A begin rejected by validation leaves nothing to end
+            if(!destination_->occlusionQueryActive)break;
+            destination_->occlusionQueryActive = 0;
+            device->functions.vkCmdEndQuery(destinationVk, beginInfo->occlusionQuerySet->queryPool, destination_->occlusionQueryIndex);
         }break;
         case rp_command_type_insert_debug_marker:{
 
         }break;
         case rp_command_type_multi_draw_indexed_indirect:{
-
+            const RenderPassCommandMultiDrawIndexedIndirect* multiDraw = &command->multiDrawIndexedIndirect;
+            const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+            CommandBufferAndSomeState_flush(destination_);
+            if(multiDraw->drawCountBuffer){
+                device->functions.vkCmdDrawIndexedIndirectCount(
+                    destinationVk,
+                    multiDraw->indirectBuffer->buffer,
+                    multiDraw->indirectOffset,
+                    multiDraw->drawCountBuffer->buffer,
+                    multiDraw->drawCountBufferOffset,
+                    multiDraw->maxDrawCount,
+                    stride
+                );
+            }
+            else if(device->capabilities.multiDrawIndirect){
+                device->functions.vkCmdDrawIndexedIndirect(destinationVk, multiDraw->indirectBuffer->buffer, multiDraw->indirectOffset, multiDraw->maxDrawCount, stride);
+            }
+            else{
+                for(uint32_t drawIndex = 0;drawIndex < multiDraw->maxDrawCount;drawIndex++){
+                    device->functions.vkCmdDrawIndexedIndirect(destinationVk, multiDraw->indirectBuffer->buffer, multiDraw->indirectOffset + (uint64_t)drawIndex * stride, 1, stride);
+                }
+            }
         }break;
         case rp_command_type_multi_draw_indirect:{
-
+            const RenderPassCommandMultiDrawIndirect* multiDraw = &command->multiDrawIndirect;
+            const uint32_t stride = sizeof(VkDrawIndirectCommand);
+            CommandBufferAndSomeState_flush(destination_);
+            if(multiDraw->drawCountBuffer){
+                device->functions.vkCmdDrawIndirectCount(
+                    destinationVk,
+                    multiDraw->indirectBuffer->buffer,
+                    multiDraw->indirectOffset,
+                    multiDraw->drawCountBuffer->buffer,
+                    multiDraw->drawCountBufferOffset,
+                    multiDraw->maxDrawCount,
+                    stride
+                );
+            }
+            else if(device->capabilities.multiDrawIndirect){
+                device->functions.vkCmdDrawIndirect(destinationVk, multiDraw->indirectBuffer->buffer, multiDraw->indirectOffset, multiDraw->maxDrawCount, stride);
+            }
+            else{
+                for(uint32_t drawIndex = 0;drawIndex < multiDraw->maxDrawCount;drawIndex++){
+                    device->functions.vkCmdDrawIndirect(destinationVk, multiDraw->indirectBuffer->buffer, multiDraw->indirectOffset + (uint64_t)drawIndex * stride, 1, stride);
+                }
+            }
         }break;
     
         case rp_command_type_set_force32: // fallthrough
@@ -4153,10 +6187,14 @@ void recordVkCommand(CommandBufferAndSomeState* destination_, const RenderPassCo
     }
 }
 
-void recordVkCommands(WGPUCommandEncoder destination, WGPUDevice device, const RenderPassCommandGenericVector* commands, const RenderPassCommandBegin WGPU_NULLABLE *beginInfo){
+void recordVkCommands(WGPUCommandEncoder destination, WGPUDevice device, const RenderPassCommandStream* commands, const RenderPassCommandBegin WGPU_NULLABLE *beginInfo){
+    recordVkCommandsToBuffer(destination, destination->buffer, device, commands, beginInfo);
+}
+
+void recordVkCommandsToBuffer(WGPUCommandEncoder encoder, VkCommandBuffer destination, WGPUDevice device, const RenderPassCommandStream* commands, const RenderPassCommandBegin WGPU_NULLABLE *beginInfo){
     CommandBufferAndSomeState cal = {
-        .cmdEncoder = destination,
-        .buffer = destination->buffer,
+        .cmdEncoder = encoder,
+        .buffer = destination,
         .device = device,
         .lastLayout = VK_NULL_HANDLE,
         .dynamicState.scissorRect = {
@@ -4165,8 +6203,15 @@ void recordVkCommands(WGPUCommandEncoder destination, WGPUDevice device, const R
         }
     };
 
-    for(size_t i = 0;i < commands->size;i++){
-        const RenderPassCommandGeneric* cmd = RenderPassCommandGenericVector_get((RenderPassCommandGenericVector*)commands, i);
+    if(beginInfo && beginInfo->colorAttachmentCount > 0 && beginInfo->colorAttachments[0].view){
+        // A real pass, RenderPassEncoder_recordRendering has set these
+        cal.dynamicState = RenderPassCommandBegin_defaultDynamicState(beginInfo);
+        cal.viewportSet = 1;
+        cal.scissorSet = 1;
+    }
+
+    RenderPassCommandStreamReader reader = RenderPassCommandStream_read(commands);
+    for(const RenderPassCommandGeneric* cmd = RenderPassCommandStreamReader_next(&reader);cmd;cmd = RenderPassCommandStreamReader_next(&reader)){
         recordVkCommand(&cal, cmd, beginInfo);
     }
 }
@@ -4414,6 +6459,63 @@ void wgpuQueueWaitIdle(WGPUQueue queue){
 }
 DEFINE_VECTOR_WITH_INLINE_STORAGE(static inline, CmdBarrierSet, CmdBarrierSetILVector, 4);
 const int use_single_submit = 1;
+
+/**
+ * @brief Submits one batch of command buffers with at most one wait and one signal semaphore
+ * @details Uses vkQueueSubmit2 if synchronization2 is enabled, so the wait only blocks the given stages.
+ * Otherwise the stage masks are narrowed to their legacy equivalents for vkQueueSubmit.
+ */
+static VkResult Queue_submitBatch(WGPUQueue queue, const VkCommandBuffer* commandBuffers, uint32_t commandBufferCount, VkSemaphore waitSemaphore, VkPipelineStageFlags2 waitStage, VkSemaphore signalSemaphore, VkPipelineStageFlags2 signalStage, VkFence fence){
+    WGPUDevice device = queue->device;
+    if(device->capabilities.synchronization2){
+        VkCommandBufferSubmitInfo cbInfos[64];
+        VkCommandBufferSubmitInfo* cbInfosPtr = commandBufferCount > 64 ? (VkCommandBufferSubmitInfo*)RL_CALLOC(commandBufferCount, sizeof(VkCommandBufferSubmitInfo)) : cbInfos;
+        for(uint32_t i = 0;i < commandBufferCount;i++){
+            cbInfosPtr[i] = (VkCommandBufferSubmitInfo){
+                .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+                .commandBuffer = commandBuffers[i],
+            };
+        }
+        const VkSemaphoreSubmitInfo waitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = waitSemaphore,
+            .stageMask = waitStage,
+        };
+        const VkSemaphoreSubmitInfo signalInfo = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = signalSemaphore,
+            .stageMask = signalStage,
+        };
+        const VkSubmitInfo2 submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+            .waitSemaphoreInfoCount = waitSemaphore ? 1 : 0,
+            .pWaitSemaphoreInfos = &waitInfo,
+            .commandBufferInfoCount = commandBufferCount,
+            .pCommandBufferInfos = cbInfosPtr,
+            .signalSemaphoreInfoCount = signalSemaphore ? 1 : 0,
+            .pSignalSemaphoreInfos = &signalInfo,
+        };
+        VkResult result = device->functions.vkQueueSubmit2(queue->graphicsQueue, 1, &submitInfo, fence);
+        if(cbInfosPtr != cbInfos){
+            RL_FREE(cbInfosPtr);
+        }
+        return result;
+    }
+    else{
+        const VkPipelineStageFlags legacyWaitStage = (VkPipelineStageFlags)(waitStage & 0xFFFFFFFFu);
+        const VkSubmitInfo submitInfo = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+            .waitSemaphoreCount = waitSemaphore ? 1 : 0,
+            .pWaitSemaphores = &waitSemaphore,
+            .pWaitDstStageMask = &legacyWaitStage,
+            .commandBufferCount = commandBufferCount,
+            .pCommandBuffers = commandBuffers,
+            .signalSemaphoreCount = signalSemaphore ? 1 : 0,
+            .pSignalSemaphores = &signalSemaphore,
+        };
+        return device->functions.vkQueueSubmit(queue->graphicsQueue, 1, &submitInfo, fence);
+    }
+}
 static const char* il_string(VkImageLayout layout){
     switch(layout){
         case VK_IMAGE_LAYOUT_UNDEFINED: return "VK_IMAGE_LAYOUT_UNDEFINED";
@@ -4469,7 +6571,8 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
     WGPUCommandBufferDescriptor cbd = {
         .label = STRVIEW("PresubmitCache"),
     };
-    WGPUCommandBuffer cachebuffer = wgpuCommandEncoderFinish(queue->presubmitCache, &cbd);
+    // An empty presubmit encoder simply stays open for the next submit
+    WGPUCommandBuffer cachebuffer = cacheBufferNonEmpty ? wgpuCommandEncoderFinish(queue->presubmitCache, &cbd) : NULL;
     
     //submittable.data[0] = cachebuffer->buffer;
     //for(size_t i = 0;i < commandCount;i++){
@@ -4493,8 +6596,8 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
     PerframeCache* perFrameCache = DeviceGetFIFCache(queue->device, cacheIndex);
     
     VkResult submitResult = 0;
-    WGPUCommandBufferVector interspersedBuffers;
-    WGPUCommandBufferVector_init(&interspersedBuffers);
+    VkCommandBufferVector interspersedBuffers;
+    VkCommandBufferVector_init(&interspersedBuffers);
     if(use_single_submit && submittableWGPU.size > 0){
         CmdBarrierSetILVector compatibilityBarrierSets;
         CmdBarrierSetILVector_initWithSize(&compatibilityBarrierSets, submittableWGPU.size);
@@ -4509,9 +6612,9 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
                 }
             }
             //printf("cbs size: %lu\n", cbs->bufferBarriers.size);
-            WGPUCommandEncoder iencoder = wgpuDeviceCreateCommandEncoder(queue->device, NULL);
+            VkCommandBuffer transitionBuffer = PerframeCache_beginTransitionBuffer(queue->device, perFrameCache);
             queue->device->functions.vkCmdPipelineBarrier(
-                iencoder->buffer,
+                transitionBuffer,
                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
                 0,
@@ -4519,116 +6622,51 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
                 cbs->bufferBarriers.size, cbs->bufferBarriers.data,
                 cbs->imageBarriers.size,  cbs->imageBarriers.data
             );
-            WGPUCommandBuffer buffer = wgpuCommandEncoderFinish(iencoder, NULL);
-            WGPUCommandBufferVector_push_back(&interspersedBuffers, buffer);
-            wgpuCommandEncoderRelease(iencoder);
+            Queue_initializeResources(queue->device, transitionBuffer, submittableWGPU.data[i]);
+            queue->device->functions.vkEndCommandBuffer(transitionBuffer);
+            VkCommandBufferVector_push_back(&interspersedBuffers, transitionBuffer);
         }
         for(size_t i = 0;i < submittableWGPU.size;i++){
             CmdBarrierSet_free(CmdBarrierSetILVector_get(&compatibilityBarrierSets, i));
         }
         CmdBarrierSetILVector_free(&compatibilityBarrierSets);
-        VkSemaphoreVector waitSemaphores;
-        VkSemaphoreVector_init(&waitSemaphores);
         SyncState* syncState = DeviceGetSyncState(queue->device, cacheIndex);
 
+        // Ordering against earlier submits of this queue is provided by submission order and 
+        // the compatibility barriers, only a pending swapchain acquire has to be waited on.
+        VkSemaphore waitSemaphore = VK_NULL_HANDLE;
         if(syncState->acquireImageSemaphoreSignalled){
-            VkSemaphoreVector_push_back(&waitSemaphores, syncState->acquireImageSemaphore);
+            waitSemaphore = syncState->acquireImageSemaphore;
             syncState->acquireImageSemaphoreSignalled = false;
         }
-        if(syncState->submits > 0){
-            VkSemaphoreVector_push_back(&waitSemaphores, syncState->semaphores.data[syncState->submits]);
-        }
-        uint32_t submits = syncState->submits;
-        VkPipelineStageFlags* waitFlags = (VkPipelineStageFlags*)RL_CALLOC(waitSemaphores.size, sizeof(VkPipelineStageFlags));
-        for(uint32_t i = 0;i < waitSemaphores.size;i++){
-            waitFlags[i] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-        }
         VkCommandBufferVector finalSubmittable = {0};
         VkCommandBufferVector_init(&finalSubmittable);
         VkCommandBufferVector_reserve(&finalSubmittable, submittableWGPU.size * 2);
         for(size_t i = 0;i < submittableWGPU.size;i++){
-            VkCommandBufferVector_push_back(&finalSubmittable, interspersedBuffers.data[i]->buffer);
-            VkCommandBufferVector_push_back(&finalSubmittable, submittableWGPU.data[i]->buffer);
-        }
-        const VkSubmitInfo submitInfo = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .commandBufferCount = finalSubmittable.size,
-            .waitSemaphoreCount = waitSemaphores.size,
-            .pWaitSemaphores = waitSemaphores.data,
-            .pWaitDstStageMask = waitFlags,
-            .signalSemaphoreCount = 1,
-            .pSignalSemaphores = syncState->semaphores.data + syncState->submits + 1,
-            .pCommandBuffers = finalSubmittable.data,
-        };
-        if(finalSubmittable.size){
-            //printf("Submitting:\n");
-            //for(uint32_t i = 0;i < finalSubmittable.size;i++){
-            //    printf("  %p\n", finalSubmittable.data[i]);
-            //}
-            //printf("with fence %p\n", fence);
+            const WGPUCommandBuffer submitted = submittableWGPU.data[i];
+            VkCommandBufferVector_push_back(&finalSubmittable, interspersedBuffers.data[i]);
+            for(size_t seg = 0;seg < submitted->segments.size;seg++){
+                VkCommandBufferVector_push_back(&finalSubmittable, submitted->segments.data[seg].buffer);
+            }
+            VkCommandBufferVector_push_back(&finalSubmittable, submitted->buffer);
         }
         ++syncState->submits;
         WGPUFence submitFence = fence;
-        submitResult = queue->device->functions.vkQueueSubmit(queue->graphicsQueue, 1, &submitInfo, submitFence ? submitFence->fence : VK_NULL_HANDLE);
+        submitResult = Queue_submitBatch(
+            queue,
+            finalSubmittable.data, finalSubmittable.size,
+            waitSemaphore, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_NULL_HANDLE, VK_PIPELINE_STAGE_2_NONE,
+            submitFence ? submitFence->fence : VK_NULL_HANDLE
+        );
         if(submitResult == VK_SUCCESS){
             submitFence->state = WGPUFenceState_InUse;
         }
         for(uint32_t i = 0;i < submittableWGPU.size;i++){
-            ImageUsageRecordMap_for_each(&interspersedBuffers.data[i]->resourceUsage.referencedTextures, updateLayoutCallback, NULL);
+            Queue_settleInitialization(submittableWGPU.data[i], submitResult == VK_SUCCESS);
             ImageUsageRecordMap_for_each(&submittableWGPU.data[i]->resourceUsage.referencedTextures, updateLayoutCallback, NULL);
         }
-        VkSemaphoreVector_free(&waitSemaphores);
         VkCommandBufferVector_free(&finalSubmittable);
-        for(size_t i = 0;i < interspersedBuffers.size;i++){
-            // compensated by not calling addRef below
-            // wgpuCommandBufferRelease(interspersedBuffers.data[i]);
-        }
-        
-        RL_FREE(waitFlags);
-    }
-    else{
-        //for(uint32_t i = 0;i < submittable.size;i++){
-        //    VkSemaphoreVector waitSemaphores;
-        //    VkSemaphoreVector_init(&waitSemaphores);
-//
-        //    if(queue->syncState[cacheIndex].acquireImageSemaphoreSignalled){
-        //        VkSemaphoreVector_push_back(&waitSemaphores, queue->syncState[cacheIndex].acquireImageSemaphore);
-        //        queue->syncState[cacheIndex].acquireImageSemaphoreSignalled = false;
-        //    }
-        //    if(queue->syncState[cacheIndex].submits > 0){
-        //        VkSemaphoreVector_push_back(&waitSemaphores, queue->syncState[cacheIndex].semaphores.data[queue->syncState[cacheIndex].submits]);
-        //    }
-//
-        //    uint32_t submits = queue->syncState[cacheIndex].submits;
-        //    
-        //    VkPipelineStageFlags* waitFlags = (VkPipelineStageFlags*)RL_CALLOC(waitSemaphores.size, sizeof(VkPipelineStageFlags));
-        //    for(uint32_t i = 0;i < waitSemaphores.size;i++){
-        //        waitFlags[i] = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-        //    }
-//
-        //    const VkSubmitInfo si = {
-        //        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        //        .commandBufferCount = 1,
-        //        .waitSemaphoreCount = waitSemaphores.size,
-        //        .pWaitSemaphores = waitSemaphores.data,
-        //        .pWaitDstStageMask = waitFlags,
-        //        .signalSemaphoreCount = 1,
-        //        .pSignalSemaphores = queue->syncState[cacheIndex].semaphores.data + queue->syncState[cacheIndex].submits + 1,
-        //        .pCommandBuffers = submittable.data + i
-        //    };
-        //    
-//
-        //    ++queue->syncState[cacheIndex].submits;
-//
-        //    WGPUFence submitFence = (i == (submittable.size - 1)) ? fence : NULL;
-        //    submitResult |= queue->device->functions.vkQueueSubmit(queue->graphicsQueue, 1, &si, submitFence ? submitFence->fence : VK_NULL_HANDLE);
-        //    if(submitFence){
-        //        submitFence->state = WGPUFenceState_InUse;
-        //    }
-//
-        //    VkSemaphoreVector_free(&waitSemaphores);
-        //    RL_FREE(waitFlags);
-        //}
     }
 
     if(submitResult == VK_SUCCESS){
@@ -4658,7 +6696,9 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
         WGPUCommandBufferVector insert;
         WGPUCommandBufferVector_init(&insert);
         
-        WGPUCommandBufferVector_push_back(&insert, cachebuffer);
+        if(cachebuffer){
+            WGPUCommandBufferVector_push_back(&insert, cachebuffer);
+        }
         
         // TODO IMPORTANT: Is this really not required here? wgpuCommandBufferAddRef(cachebuffer);
         
@@ -4667,16 +6707,16 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
             WGPUCommandBufferVector_push_back(&insert, buffers[i]);
             //wgpuCommandBufferAddRef(buffers[i]);
         }
-        for(size_t i = 0;i < interspersedBuffers.size;i++){
-            WGPUCommandBufferVector_push_back(&insert, interspersedBuffers.data[i]);
-        }
 
         PerframeCache_pushFenceDependencies(perFrameCache, fence, &insert);
-
-        for(size_t i = 0;i < interspersedBuffers.size;i++){
-            wgpuCommandBufferRelease(interspersedBuffers.data[i]);
+        // Scopes are read back when the frame this submit belongs to retires, regardless of when they were encoded
+        for(size_t i = 0;i < submittableWGPU.size;i++){
+            TimestampScopes* timestamps = &submittableWGPU.data[i]->timestamps;
+            if(timestamps->queryPool == VK_NULL_HANDLE)continue;
+            TimestampScopesVector_push_back(&perFrameCache->timestamps, *timestamps);
+            *timestamps = (TimestampScopes){0};
         }
-        WGPUCommandBufferVector_free(&interspersedBuffers);
+
         uint32_t cacheIndex = frameCount % framesInFlight;
         //PendingCommandBufferMap* pcm = &DeviceGetFIFCache(queue->device, cacheIndex)->pendingCommandBuffers;
         //WGPUCommandBufferVector* fence_iterator = PendingCommandBufferMap_get(pcm, (void*)fence);
@@ -4705,10 +6745,11 @@ void wgpuQueueSubmit(WGPUQueue queue, size_t commandCount, const WGPUCommandBuff
     }else{
         DeviceCallback(queue->device, WGPUErrorType_Internal, STRVIEW("vkQueueSubmit failed"));
     }
-    wgpuCommandEncoderRelease(queue->presubmitCache);
-    wgpuCommandBufferRelease(cachebuffer);
-    WGPUCommandEncoderDescriptor cedesc zeroinit;
-    queue->presubmitCache = wgpuDeviceCreateCommandEncoder(queue->device, &cedesc);
+    VkCommandBufferVector_free(&interspersedBuffers);
+    if(cachebuffer){
+        wgpuCommandBufferRelease(cachebuffer);
+        CommandEncoder_rearm(queue->presubmitCache);
+    }
     //VkCommandBufferVector_free(&submittable);
     WGPUCommandBufferVector_free(&submittableWGPU);
     EXIT();
@@ -5003,6 +7044,27 @@ void wgpuSurfaceGetCapabilities(WGPUSurface wgpuSurface, WGPUAdapter adapter, WG
         *capabilities = wgpuSurface->capabilityCache;
         return;
     }
+    if(wgpuSurface->surfaceType == SurfaceImplType_Virtual){
+        static const WGPUTextureFormat virtualFormats[] = {
+            WGPUTextureFormat_BGRA8Unorm, WGPUTextureFormat_RGBA8Unorm,
+            WGPUTextureFormat_BGRA8UnormSrgb, WGPUTextureFormat_RGBA8UnormSrgb,
+            WGPUTextureFormat_RGBA16Float,
+        };
+        static const WGPUPresentMode virtualPresentModes[] = {WGPUPresentMode_Fifo, WGPUPresentMode_Immediate, WGPUPresentMode_Mailbox};
+        static const WGPUCompositeAlphaMode virtualAlphaModes[] = {WGPUCompositeAlphaMode_Opaque};
+        wgpuSurface->capabilityCache = (WGPUSurfaceCapabilities){
+            .usages = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc | WGPUTextureUsage_CopyDst | WGPUTextureUsage_TextureBinding,
+            .formatCount = rg_countof(virtualFormats),
+            .formats = virtualFormats,
+            .presentModeCount = rg_countof(virtualPresentModes),
+            .presentModes = virtualPresentModes,
+            .alphaModeCount = rg_countof(virtualAlphaModes),
+            .alphaModes = virtualAlphaModes,
+        };
+        *capabilities = wgpuSurface->capabilityCache;
+        EXIT();
+        return;
+    }
 
     VkSurfaceKHR surface = wgpuSurface->surface;
     VkSurfaceCapabilitiesKHR scap zeroinit;
@@ -5090,12 +7152,89 @@ void wgpuSurfaceGetCapabilities(WGPUSurface wgpuSurface, WGPUAdapter adapter, WG
 
 
 
+/**
+ * @brief Takes the current swapchain out of the surface without waiting on the device
+ * @details An image that was acquired but never presented has its acquire semaphore consumed by an empty 
+ * submit, so the semaphore can be reused by the next acquire. Queue order places that submit before the 
+ * finalTransitionFence of the current frame.
+ */
+static RetiredSwapchain Surface_detachSwapchain(WGPUSurface surface){
+    WGPUDevice device = surface->device;
+    const uint32_t cacheIndex = device->submittedFrames % framesInFlight;
+    SyncState* syncState = DeviceGetSyncState(device, cacheIndex);
+    if(syncState->acquireImageSemaphoreSignalled){
+        Queue_submitBatch(device->queue, NULL, 0, syncState->acquireImageSemaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_NULL_HANDLE, VK_PIPELINE_STAGE_2_NONE, VK_NULL_HANDLE);
+        syncState->acquireImageSemaphoreSignalled = false;
+    }
+    RetiredSwapchain retired = {
+        .swapchain = surface->swapchain,
+        .imageCount = surface->imagecount,
+        .images = surface->images,
+        .presentSemaphores = surface->presentSemaphores,
+    };
+    surface->swapchain = VK_NULL_HANDLE;
+    surface->imagecount = 0;
+    surface->images = NULL;
+    surface->presentSemaphores = NULL;
+    return retired;
+}
+
+// Creates the offscreen ring of a virtual surface: one texture being rendered plus the queued ones
+static void Surface_configureVirtual(WGPUSurface surface, const WGPUSurfaceConfiguration* config){
+    WGPUDevice device = config->device;
+    surface->device = device;
+    surface->width = config->width;
+    surface->height = config->height;
+    surface->presentWait = 0;
+    surface->imagecount = surface->maxQueuedFrames + 1;
+    surface->activeImageIndex = surface->imagecount - 1;
+    surface->images = (WGPUTexture*)RL_CALLOC(surface->imagecount, sizeof(WGPUTexture));
+    surface->presentSemaphores = NULL;
+    const WGPUTextureDescriptor imageDescriptor = {
+        .label = STRVIEW("VirtualSurfaceImage"),
+        .usage = config->usage | WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+        .dimension = WGPUTextureDimension_2D,
+        .size = {config->width, config->height, 1},
+        .format = config->format,
+        .mipLevelCount = 1,
+        .sampleCount = 1,
+        .viewFormatCount = config->viewFormatCount,
+        .viewFormats = config->viewFormats,
+    };
+    for(uint32_t i = 0;i < surface->imagecount;i++){
+        surface->images[i] = wgpuDeviceCreateTexture(device, &imageDescriptor);
+    }
+}
+
 void wgpuSurfaceConfigure(WGPUSurface surface, const WGPUSurfaceConfiguration* config){
     ENTRY();
-    if(surface->swapchain){
-        wgpuSurfaceUnconfigure(surface);
+    // Reconfiguration hands the old swapchain to the new one instead of idling the device. 
+    // It is destroyed once the frame that last presented from it has retired, see wgpuDeviceTick.
+    RetiredSwapchain retired zeroinit;
+    WGPUDevice retiringDevice = surface->device;
+    if(surface->images){
+        retired = Surface_detachSwapchain(surface);
+        PerframeCache* retiringCache = DeviceGetFIFCache(retiringDevice, retiringDevice->submittedFrames % framesInFlight);
+        RetiredSwapchainVector_push_back(&retiringCache->retiredSwapchains, retired);
     }
     WGPUDevice device = config->device;
+    const WGPUSurfaceFrameLatency* frameLatency = NULL;
+    for(const WGPUChainedStruct* chain = config->nextInChain;chain;chain = chain->next){
+        if(chain->sType == WGPUSType_SurfaceFrameLatency){
+            frameLatency = (const WGPUSurfaceFrameLatency*)chain;
+        }
+    }
+    surface->maxQueuedFrames = framesInFlight;
+    if(frameLatency && frameLatency->maxQueuedFrames != 0){
+        surface->maxQueuedFrames = frameLatency->maxQueuedFrames < framesInFlight ? frameLatency->maxQueuedFrames : framesInFlight;
+    }
+    surface->presentWait = frameLatency && frameLatency->waitForPresent && device->capabilities.presentWait;
+    surface->presentId = 0;
+    if(surface->surfaceType == SurfaceImplType_Virtual){
+        Surface_configureVirtual(surface, config);
+        EXIT();
+        return;
+    }
     VkSurfaceCapabilitiesKHR vkCapabilities = {0};
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device->adapter->physicalDevice, surface->surface, &vkCapabilities);
     VkSwapchainCreateInfoKHR createInfo zeroinit;
@@ -5121,11 +7260,16 @@ void wgpuSurfaceConfigure(WGPUSurface surface, const WGPUSurfaceConfiguration* c
     else{
         correctedHeight = config->height;
     }
+    // One image being rendered plus the queued ones, the default keeps one above the surface minimum
+    uint32_t requestedImageCount = vkCapabilities.minImageCount + 1;
+    if(frameLatency){
+        requestedImageCount = surface->maxQueuedFrames + 1;
+    }
     if(vkCapabilities.maxImageCount == 0){
-        createInfo.minImageCount = vkCapabilities.minImageCount + 1;
+        createInfo.minImageCount = requestedImageCount < vkCapabilities.minImageCount ? vkCapabilities.minImageCount : requestedImageCount;
     }
     else{
-        createInfo.minImageCount = SWAPCHAIN_ICLAMP_TEMP(vkCapabilities.minImageCount + 1, vkCapabilities.minImageCount, vkCapabilities.maxImageCount);
+        createInfo.minImageCount = SWAPCHAIN_ICLAMP_TEMP(requestedImageCount, vkCapabilities.minImageCount, vkCapabilities.maxImageCount);
     }
     #undef SWAPCHAIN_ICLAMP_TEMP
     
@@ -5160,9 +7304,13 @@ void wgpuSurfaceConfigure(WGPUSurface surface, const WGPUSurfaceConfiguration* c
     createInfo.presentMode = toVulkanPresentMode(config->presentMode); 
     createInfo.clipped = VK_TRUE;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    createInfo.oldSwapchain = (retiringDevice == device) ? retired.swapchain : VK_NULL_HANDLE;
     VkResult scCreateResult = device->functions.vkCreateSwapchainKHR(device->device, &createInfo, NULL, &(surface->swapchain));
     if (scCreateResult != VK_SUCCESS) {
         DeviceCallback(device, WGPUErrorType_Internal, STRVIEW("Failed to create swapchain"));
+        surface->swapchain = VK_NULL_HANDLE;
+        EXIT();
+        return;
     } else {
         //TRACELOG(WGPU_LOG_INFO, "wgpuSurfaceConfigure(): Successfully created swap chain");
     }
@@ -5200,7 +7348,7 @@ void wgpuSurfaceConfigure(WGPUSurface surface, const WGPUSurfaceConfiguration* c
 void wgpuSurfaceRelease(WGPUSurface surface){
     ENTRY();
     if(--surface->refCount == 0){
-        if(surface->swapchain){
+        if(surface->images){
             wgpuSurfaceUnconfigure(surface);
 
             //RL_FREE((void*)surface->images);
@@ -5221,7 +7369,7 @@ void wgpuComputePassEncoderDispatchWorkgroups(WGPUComputePassEncoder cpe, uint32
     };
     
 
-    RenderPassCommandGenericVector_push_back(&cpe->bufferedCommands, insert);
+    Device_pushCommand(cpe->device, &cpe->bufferedCommands, &insert);
     EXIT();
 }
 
@@ -5247,8 +7395,7 @@ void wgpuCommandEncoderRelease(WGPUCommandEncoder commandEncoder) {
             WGPUComputePassEncoderSet_for_each(&commandBuffer->referencedCPs, releaseCPSetCallback, NULL);
             WGPURaytracingPassEncoderSet_for_each(&commandBuffer->referencedRTs, releaseRTSetCallback, NULL);
             
-            releaseAllAndClear(&commandBuffer->resourceUsage);
-            // The above performs ResourceUsage_free already!
+            ContainerCache_recycleResourceUsage(&commandEncoder->device->containerCache, &commandBuffer->resourceUsage);
             
 
             WGPURenderPassEncoderSet_free(&commandBuffer->referencedRPs);
@@ -5256,11 +7403,19 @@ void wgpuCommandEncoderRelease(WGPUCommandEncoder commandEncoder) {
             WGPURaytracingPassEncoderSet_free(&commandBuffer->referencedRTs);
         }
         if(commandEncoder->buffer){
-            VkCommandBufferVector_push_back(
-                &DeviceGetFIFCache(commandEncoder->device, commandEncoder->cacheIndex)->commandBuffers,
-                commandEncoder->buffer
-            );
+            PerframeCache* frameCache = DeviceGetFIFCache(commandEncoder->device, commandEncoder->cacheIndex);
+            CommandEncoder_joinSegments(commandEncoder);
+            for(size_t i = 0;i < commandEncoder->segments.size;i++){
+                PerframeCache_returnPrimaryCommandBuffer(frameCache, commandEncoder->segments.data[i].threadSlot);
+            }
+            EncoderSegmentVector_free(&commandEncoder->segments);
+            CommandEncoder_freeQueryWrites(commandEncoder);
+            PerframeCache_unpinCommandPool(frameCache, commandEncoder->threadSlot);
+            PerframeCache_returnPrimaryCommandBuffer(frameCache, commandEncoder->threadSlot);
         }
+        Device_recycleTimestampScopes(commandEncoder->device, &commandEncoder->timestamps);
+        BufferChunkInitMap_free(&commandEncoder->bufferChunkInits);
+        TextureSubresourceInitMap_release(&commandEncoder->textureInits);
     }
     
     RL_FREE(commandEncoder);
@@ -5275,8 +7430,7 @@ void wgpuCommandBufferRelease(WGPUCommandBuffer commandBuffer) {
         WGPUComputePassEncoderSet_for_each(&commandBuffer->referencedCPs, releaseCPSetCallback, NULL);
         WGPURaytracingPassEncoderSet_for_each(&commandBuffer->referencedRTs, releaseRTSetCallback, NULL);
         
-        releaseAllAndClear(&commandBuffer->resourceUsage);
-        // The above performs ResourceUsage_free already!
+        ContainerCache_recycleResourceUsage(&device->containerCache, &commandBuffer->resourceUsage);
     
 
         WGPURenderPassEncoderSet_free(&commandBuffer->referencedRPs);
@@ -5284,8 +7438,15 @@ void wgpuCommandBufferRelease(WGPUCommandBuffer commandBuffer) {
         WGPURaytracingPassEncoderSet_free(&commandBuffer->referencedRTs);
         
         PerframeCache* frameCache = DeviceGetFIFCache(commandBuffer->device, commandBuffer->cacheIndex);
-        device->functions.vkFreeCommandBuffers(device->device, device->fifCache.frameCaches[commandBuffer->cacheIndex].commandPool, 1, &commandBuffer->buffer);
-        //VkCommandBufferVector_push_back(&frameCache->commandBuffers, commandBuffer->buffer);
+        for(size_t i = 0;i < commandBuffer->segments.size;i++){
+            PerframeCache_returnPrimaryCommandBuffer(frameCache, commandBuffer->segments.data[i].threadSlot);
+        }
+        EncoderSegmentVector_free(&commandBuffer->segments);
+        PerframeCache_returnPrimaryCommandBuffer(frameCache, commandBuffer->threadSlot);
+        // Only still owned if the command buffer was never submitted
+        Device_recycleTimestampScopes(device, &commandBuffer->timestamps);
+        BufferChunkInitMap_free(&commandBuffer->bufferChunkInits);
+        TextureSubresourceInitMap_release(&commandBuffer->textureInits);
         if(commandBuffer->label.data){
             WGPUStringFree(commandBuffer->label);
         }
@@ -5302,12 +7463,11 @@ void wgpuRenderPassEncoderAddRef(WGPURenderPassEncoder rpenc) {
 void wgpuRenderPassEncoderRelease(WGPURenderPassEncoder rpenc) {
     ENTRY();
     if (--rpenc->refCount == 0) {
-        releaseAllAndClear(&rpenc->resourceUsage);
+        ContainerCache_recycleResourceUsage(&rpenc->device->containerCache, &rpenc->resourceUsage);
         if(rpenc->frameBuffer){
             rpenc->device->functions.vkDestroyFramebuffer(rpenc->device->device, rpenc->frameBuffer, NULL);
         }
-        ResourceUsage_free(&rpenc->resourceUsage);
-        RenderPassCommandGenericVector_free(&rpenc->bufferedCommands);
+        ContainerCache_recycleCommandStream(&rpenc->device->containerCache, &rpenc->bufferedCommands);
         RL_FREE(rpenc);
     }
     EXIT();
@@ -5406,6 +7566,7 @@ WGPUBindGroupLayout wgpuBindGroupLayoutRelease_withReturn(WGPUBindGroupLayout bg
         }
         device->functions.vkDestroyDescriptorSetLayout(bglayout->device->device, bglayout->layout, NULL);
         RL_FREE((void*)bglayout->entries);
+        RL_FREE(bglayout->arraySizes);
         RL_FREE((void*)bglayout);
         return NULL;
     }
@@ -5446,6 +7607,17 @@ void wgpuBindGroupRelease(WGPUBindGroup dshandle) {
             dshandle->device->functions.vkDestroyDescriptorPool(dshandle->device->device, dshandle->pool, NULL);
         }
         RL_FREE(dshandle->entries);
+        RL_FREE(dshandle->bufferUsages);
+        // Nothing in flight uses the group anymore, so neither do its slots
+        for(uint32_t i = 0;i < dshandle->slotAllocatorCount;i++){
+            BindGroupSlotAllocator* allocator = dshandle->slotAllocators + i;
+            for(uint32_t slot = 0;allocator->contents && slot < allocator->contentEnd;slot++){
+                BindGroupSlotContent_release(allocator->contents + slot);
+            }
+            RL_FREE(allocator->freeSlots);
+            RL_FREE(allocator->contents);
+        }
+        RL_FREE(dshandle->slotAllocators);
 
         // DONT delete them, they are cached
         // vkFreeDescriptorSets(dshandle->device->device, dshandle->pool, 1, &dshandle->set);
@@ -5507,6 +7679,22 @@ void wgpuDeviceRelease(WGPUDevice device){
         wgpuCommandEncoderRelease(device->queue->presubmitCache);
         wgpuCommandBufferRelease(cBuffer);
         FIFCache_destroy(&device->fifCache);
+        ContainerCache_destroy(&device->containerCache);
+        TimestampLabelStatisticsVector_free(&device->timestampStatistics);
+        for(size_t i = 0;i < device->freeTimestampScopes.size;i++){
+            device->functions.vkDestroyQueryPool(device->device, device->freeTimestampScopes.data[i].queryPool, NULL);
+            RL_FREE(device->freeTimestampScopes.data[i].labels);
+        }
+        TimestampScopesVector_free(&device->freeTimestampScopes);
+        if(device->timestampScopesMutex){
+            wgvk_mutex_destroy(device->timestampScopesMutex);
+        }
+        for(size_t i = 0;i < device->mipmapPipelines.size;i++){
+            wgpuComputePipelineRelease(device->mipmapPipelines.data[i].pipeline);
+            wgpuBindGroupLayoutRelease(device->mipmapPipelines.data[i].bindGroupLayout);
+        }
+        MipmapPipelineVector_free(&device->mipmapPipelines);
+        wgvk_mutex_destroy(device->mipmapPipelineMutex);
         {  // Destroy PerframeCaches
             
             FenceCache_Destroy(&device->fenceCache);
@@ -5517,6 +7705,7 @@ void wgpuDeviceRelease(WGPUDevice device){
             wgvkAllocator_destroy(&device->builtinAllocator);
         }
         device->functions.vkDestroyCommandPool(device->device, device->secondaryCommandPool, NULL);
+        wgvk_mutex_destroy(device->secondaryCommandPoolMutex);
         
         wgpuQueueRelease(device->queue);
         wgpuAdapterRelease(device->adapter);
@@ -5954,25 +8143,87 @@ void wgpuTextureRelease(WGPUTexture texture){
             }
         }
         Texture_ViewCache_free(&texture->viewCache);
+        RL_FREE(texture->initializedSubresources);
         RL_FREE(texture);
     }
     EXIT();
 }
+// Destroys the least recently used views of texture that nothing references anymore, until at most WGVK_TEXTURE_VIEW_CACHE_SIZE of them are left
+static void Texture_evictViews(WGPUTexture texture){
+    WGPUDevice device = texture->device;
+    Texture_ViewCache* cache = &texture->viewCache;
+    while(texture->unreferencedViews > WGVK_TEXTURE_VIEW_CACHE_SIZE){
+        Texture_ViewCache_kv_pair* victim = NULL;
+        for(uint64_t i = 0;i < cache->current_capacity;i++){
+            Texture_ViewCache_kv_pair* entry = cache->table + i;
+            if(entry->key.format != VK_FORMAT_UNDEFINED && entry->value->refCount == 0 && (victim == NULL || entry->value->lastUse < victim->value->lastUse)){
+                victim = entry;
+            }
+        }
+        if(victim == NULL){
+            texture->unreferencedViews = 0;
+            return;
+        }
+        device->functions.vkDestroyImageView(device->device, victim->value->view, NULL);
+        RL_FREE(victim->value);
+        Texture_ViewCache_erase(cache, victim);
+        --texture->unreferencedViews;
+        atomic_fetch_add_explicit(&device->viewCacheEvictions, 1, memory_order_relaxed);
+    }
+}
+
 void wgpuTextureViewRelease(WGPUTextureView view){
     ENTRY();
     --view->refCount;
     if(view->refCount == 0){
-        wgpuTextureRelease(view->texture);
-        // This is commented out because views get cached in WGPUTexture
-        // view->texture->device->functions.vkDestroyImageView(view->texture->device->device, view->view, NULL);
-        // RL_FREE(view);
+        // The view stays cached in its texture for the next matching wgpuTextureCreateView
+        WGPUTexture texture = view->texture;
+        view->lastUse = ++texture->viewCacheClock;
+        ++texture->unreferencedViews;
+        Texture_evictViews(texture);
+        wgpuTextureRelease(texture);
     }
     EXIT();
 }
 
+void wgpuCommandEncoderClearBuffer(WGPUCommandEncoder commandEncoder, WGPUBuffer buffer, uint64_t offset, uint64_t size) {
+    ENTRY();
+    if(size == WGPU_WHOLE_SIZE){
+        size = offset < buffer->capacity ? buffer->capacity - offset : 0;
+    }
+    if(!(buffer->usage & WGPUBufferUsage_CopyDst)){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderClearBuffer: buffer requires CopyDst usage"));
+        EXIT();
+        return;
+    }
+    // Compared without forming offset + size, which could wrap around
+    if((offset & 3) || (size & 3) || offset > buffer->capacity || size > buffer->capacity - offset){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderClearBuffer: offset and size must be multiples of 4 and lie within the buffer"));
+        EXIT();
+        return;
+    }
+    if(size == 0){
+        EXIT();
+        return;
+    }
+    ++commandEncoder->encodedCommandCount;
+    CommandEncoder_initializeBufferWrite(commandEncoder, buffer, offset, size);
+    ce_trackBuffer(
+        commandEncoder,
+        buffer,
+        (BufferUsageSnap){
+            .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .access = VK_ACCESS_TRANSFER_WRITE_BIT
+        }
+    );
+    commandEncoder->device->functions.vkCmdFillBuffer(commandEncoder->buffer, buffer->buffer, offset, size, 0);
+    EXIT();
+}
 void wgpuCommandEncoderCopyBufferToBuffer  (WGPUCommandEncoder commandEncoder, WGPUBuffer source, uint64_t sourceOffset, WGPUBuffer destination, uint64_t destinationOffset, uint64_t size){
     ENTRY();
     ++commandEncoder->encodedCommandCount;
+    CommandEncoder_initializeBufferRead(commandEncoder, source, sourceOffset, size);
+    CommandEncoder_initializeBufferWrite(commandEncoder, destination, destinationOffset, size);
     ce_trackBuffer(
         commandEncoder,
         source,
@@ -6018,28 +8269,53 @@ void wgpuCommandEncoderCopyBufferToBuffer  (WGPUCommandEncoder commandEncoder, W
     );
     EXIT();
 }
+// WebGPU addresses depth slices and array layers alike through origin.z and depthOrArrayLayers.
+// Vulkan wants slices of a 3D image in the offset/extent and layers of everything else in the subresource.
+typedef struct TexelCopyRange{
+    uint32_t baseArrayLayer;
+    uint32_t layerCount;
+    int32_t offsetZ;
+    uint32_t extentDepth;
+}TexelCopyRange;
+
+static inline TexelCopyRange Texture_copyRange(WGPUTexture texture, uint32_t originZ, uint32_t depthOrArrayLayers){
+    if(texture->dimension == VK_IMAGE_TYPE_3D){
+        return (TexelCopyRange){0, 1, (int32_t)originZ, depthOrArrayLayers};
+    }
+    return (TexelCopyRange){originZ, depthOrArrayLayers, 0, 1};
+}
+
 void wgpuCommandEncoderCopyBufferToTexture (WGPUCommandEncoder commandEncoder, const WGPUTexelCopyBufferInfo* source, const WGPUTexelCopyTextureInfo* destination, WGPUExtent3D const * copySize){
     ENTRY();
     
     ++commandEncoder->encodedCommandCount;
+    const TexelCopyRange range = Texture_copyRange(destination->texture, destination->origin.z, copySize->depthOrArrayLayers);
+    uint64_t sourceSize = 0;
+    WGPUBool exact = 0;
+    TexelCopyBufferLayout_range(&source->layout, destination->texture, copySize, &sourceSize, &exact);
+    CommandEncoder_initializeBufferRead(commandEncoder, source->buffer, source->layout.offset, sourceSize);
+    CommandEncoder_initializeTextureWrite(commandEncoder, destination->texture, 
+        (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, destination->mipLevel, 1, range.baseArrayLayer, range.layerCount}, 
+        Texture_copyCoversLevel(destination->texture, destination->mipLevel, &destination->origin, copySize)
+    );
     
     const VkBufferImageCopy region = {
-        .bufferOffset = 0,
+        .bufferOffset = source->layout.offset,
         .bufferRowLength = source->layout.bytesPerRow / vkFormatSize(destination->texture->format),
         .bufferImageHeight = source->layout.rowsPerImage,
         .imageSubresource.aspectMask = toVulkanAspectMaskVk(destination->aspect, destination->texture->format),
-        .imageSubresource.mipLevel = 0,
-        .imageSubresource.baseArrayLayer = 0,
-        .imageSubresource.layerCount = 1,
+        .imageSubresource.mipLevel = destination->mipLevel,
+        .imageSubresource.baseArrayLayer = range.baseArrayLayer,
+        .imageSubresource.layerCount = range.layerCount,
         .imageOffset = CLITERAL(VkOffset3D){
             (int32_t)destination->origin.x,
             (int32_t)destination->origin.y,
-            (int32_t)destination->origin.z,
+            range.offsetZ,
         },
         .imageExtent = CLITERAL(VkExtent3D){
             copySize->width,
             copySize->height,
-            copySize->depthOrArrayLayers
+            range.extentDepth
         },
     };
     
@@ -6052,8 +8328,8 @@ void wgpuCommandEncoderCopyBufferToTexture (WGPUCommandEncoder commandEncoder, c
             .aspectMask = destination->aspect,
             .baseMipLevel = destination->mipLevel,
             .levelCount = 1,
-            .baseArrayLayer = destination->origin.z,
-            .layerCount = 1
+            .baseArrayLayer = range.baseArrayLayer,
+            .layerCount = range.layerCount
         }
     });
 
@@ -6063,6 +8339,17 @@ void wgpuCommandEncoderCopyBufferToTexture (WGPUCommandEncoder commandEncoder, c
 void wgpuCommandEncoderCopyTextureToBuffer (WGPUCommandEncoder commandEncoder, const WGPUTexelCopyTextureInfo* source, const WGPUTexelCopyBufferInfo* destination, const WGPUExtent3D* copySize){
     ENTRY();
     ++commandEncoder->encodedCommandCount;
+    const TexelCopyRange range = Texture_copyRange(source->texture, source->origin.z, copySize->depthOrArrayLayers);
+    CommandEncoder_initializeTextureRead(commandEncoder, source->texture, (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, source->mipLevel, 1, range.baseArrayLayer, range.layerCount});
+    uint64_t destinationSize = 0;
+    WGPUBool exact = 0;
+    TexelCopyBufferLayout_range(&destination->layout, source->texture, copySize, &destinationSize, &exact);
+    if(exact){
+        CommandEncoder_initializeBufferWrite(commandEncoder, destination->buffer, destination->layout.offset, destinationSize);
+    }else{
+        // Row and image padding stays unwritten
+        CommandEncoder_initializeBufferRead(commandEncoder, destination->buffer, destination->layout.offset, destinationSize);
+    }
     ce_trackTexture(
         commandEncoder,
         source->texture,
@@ -6073,8 +8360,8 @@ void wgpuCommandEncoderCopyTextureToBuffer (WGPUCommandEncoder commandEncoder, c
             .subresource = {
                 .aspectMask     = toVulkanAspectMaskVk(source->aspect, source->texture->format),
                 .baseMipLevel   = source->mipLevel,
-                .baseArrayLayer = source->origin.z, // ?
-                .layerCount     = 1,
+                .baseArrayLayer = range.baseArrayLayer,
+                .layerCount     = range.layerCount,
                 .levelCount     = 1,
             }
     });
@@ -6086,19 +8373,19 @@ void wgpuCommandEncoderCopyTextureToBuffer (WGPUCommandEncoder commandEncoder, c
         .bufferImageHeight = destination->layout.rowsPerImage,
         .imageSubresource = {
             .aspectMask = toVulkanAspectMaskVk(source->aspect, source->texture->format),
-            .baseArrayLayer = source->origin.z, // ?
+            .baseArrayLayer = range.baseArrayLayer,
             .mipLevel = source->mipLevel,
-            .layerCount = 1,
+            .layerCount = range.layerCount,
         },
         .imageOffset = {
             .x = (int32_t)source->origin.x,
             .y = (int32_t)source->origin.y,
-            .z = (int32_t)source->origin.z
+            .z = range.offsetZ
         },
         .imageExtent = {
             .width  = copySize->width,
             .height = copySize->height,
-            .depth  = copySize->depthOrArrayLayers
+            .depth  = range.extentDepth
         }
     };
     commandEncoder->device->functions.vkCmdCopyImageToBuffer(
@@ -6113,6 +8400,13 @@ void wgpuCommandEncoderCopyTextureToBuffer (WGPUCommandEncoder commandEncoder, c
 void wgpuCommandEncoderCopyTextureToTexture(WGPUCommandEncoder commandEncoder, const WGPUTexelCopyTextureInfo* source, const WGPUTexelCopyTextureInfo* destination, const WGPUExtent3D* copySize){
     ENTRY();
     ++commandEncoder->encodedCommandCount;
+    const TexelCopyRange srcRange = Texture_copyRange(source->texture, source->origin.z, copySize->depthOrArrayLayers);
+    const TexelCopyRange dstRange = Texture_copyRange(destination->texture, destination->origin.z, copySize->depthOrArrayLayers);
+    CommandEncoder_initializeTextureRead(commandEncoder, source->texture, (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, source->mipLevel, 1, srcRange.baseArrayLayer, srcRange.layerCount});
+    CommandEncoder_initializeTextureWrite(commandEncoder, destination->texture, 
+        (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, destination->mipLevel, 1, dstRange.baseArrayLayer, dstRange.layerCount}, 
+        Texture_copyCoversLevel(destination->texture, destination->mipLevel, &destination->origin, copySize)
+    );
     ce_trackTexture(
         commandEncoder,
         source->texture,
@@ -6123,8 +8417,8 @@ void wgpuCommandEncoderCopyTextureToTexture(WGPUCommandEncoder commandEncoder, c
             .subresource = {
                 .aspectMask     = source->aspect,
                 .baseMipLevel   = source->mipLevel,
-                .baseArrayLayer = source->origin.z, // ?
-                .layerCount     = 1,
+                .baseArrayLayer = srcRange.baseArrayLayer,
+                .layerCount     = srcRange.layerCount,
                 .levelCount     = 1,
             }
     });
@@ -6138,31 +8432,33 @@ void wgpuCommandEncoderCopyTextureToTexture(WGPUCommandEncoder commandEncoder, c
             .subresource = {
                 .aspectMask     = destination->aspect,
                 .baseMipLevel   = destination->mipLevel,
-                .baseArrayLayer = destination->origin.z, // ?
-                .layerCount     = 1,
+                .baseArrayLayer = dstRange.baseArrayLayer,
+                .layerCount     = dstRange.layerCount,
                 .levelCount     = 1,
             }
     });
 
+    const int32_t width  = (int32_t)copySize->width;
+    const int32_t height = (int32_t)copySize->height;
     VkImageBlit region = {
         .srcSubresource = {
             .aspectMask = source->aspect,
             .mipLevel = source->mipLevel,
-            .baseArrayLayer = destination->origin.z, // ?
-            .layerCount = 1,
+            .baseArrayLayer = srcRange.baseArrayLayer,
+            .layerCount = srcRange.layerCount,
         },
         .srcOffsets = {
-            {source->origin.x, source->origin.y, source->origin.z},
-            {source->origin.x + copySize->width, source->origin.y + copySize->height, source->origin.z + copySize->depthOrArrayLayers}
+            {(int32_t)source->origin.x,         (int32_t)source->origin.y,          srcRange.offsetZ},
+            {(int32_t)source->origin.x + width, (int32_t)source->origin.y + height, srcRange.offsetZ + (int32_t)srcRange.extentDepth}
         },
         .dstSubresource = {
             .aspectMask = destination->aspect,
             .mipLevel = destination->mipLevel,
-            .baseArrayLayer = destination->origin.z, // ?
-            .layerCount = 1,
+            .baseArrayLayer = dstRange.baseArrayLayer,
+            .layerCount = dstRange.layerCount,
         },
-        .dstOffsets[0] = {destination->origin.x,                   destination->origin.y,                    destination->origin.z},
-        .dstOffsets[1] = {destination->origin.x + copySize->width, destination->origin.y + copySize->height, destination->origin.z + copySize->depthOrArrayLayers}
+        .dstOffsets[0] = {(int32_t)destination->origin.x,         (int32_t)destination->origin.y,          dstRange.offsetZ},
+        .dstOffsets[1] = {(int32_t)destination->origin.x + width, (int32_t)destination->origin.y + height, dstRange.offsetZ + (int32_t)dstRange.extentDepth}
     };
     commandEncoder->device->functions.vkCmdBlitImage(
         commandEncoder->buffer,
@@ -6175,25 +8471,415 @@ void wgpuCommandEncoderCopyTextureToTexture(WGPUCommandEncoder commandEncoder, c
     );
     EXIT();
 }
+
+static void CommandEncoder_mipBarrier(WGPUCommandEncoder encoder, WGPUTexture texture, uint32_t level, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags stage, VkAccessFlags srcAccess, VkAccessFlags dstAccess){
+    const VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture->image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, VK_REMAINING_ARRAY_LAYERS},
+    };
+    encoder->device->functions.vkCmdPipelineBarrier(encoder->buffer, stage, stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+// Levels 1.. are written in sequence, each blitted from its predecessor after that one was turned into a transfer source
+static void CommandEncoder_blitMipmaps(WGPUCommandEncoder encoder, WGPUTexture texture, VkFilter filter){
+    const uint32_t layers = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : texture->depthOrArrayLayers;
+    int32_t width = (int32_t)texture->width, height = (int32_t)texture->height;
+    int32_t depth = texture->dimension == VK_IMAGE_TYPE_3D ? (int32_t)texture->depthOrArrayLayers : 1;
+    for(uint32_t level = 1;level < texture->mipLevels;level++){
+        CommandEncoder_mipBarrier(encoder, texture, level - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+        const int32_t nextWidth = width > 1 ? width / 2 : 1, nextHeight = height > 1 ? height / 2 : 1, nextDepth = depth > 1 ? depth / 2 : 1;
+        const VkImageBlit region = {
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, layers},
+            .srcOffsets = {{0, 0, 0}, {width, height, depth}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layers},
+            .dstOffsets = {{0, 0, 0}, {nextWidth, nextHeight, nextDepth}},
+        };
+        encoder->device->functions.vkCmdBlitImage(
+            encoder->buffer,
+            texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &region,
+            filter
+        );
+        width = nextWidth;
+        height = nextHeight;
+        depth = nextDepth;
+    }
+    CommandEncoder_mipBarrier(encoder, texture, texture->mipLevels - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+}
+
+#if SUPPORT_WGSL == 1
+// WGSL texel format of the storage formats the compute downsample handles, NULL for all others
+static const char* mipmapStorageFormatName(WGPUTextureFormat format){
+    switch(format){
+        case WGPUTextureFormat_RGBA8Unorm:  return "rgba8unorm";
+        case WGPUTextureFormat_RGBA8Snorm:  return "rgba8snorm";
+        case WGPUTextureFormat_RGBA16Float: return "rgba16float";
+        case WGPUTextureFormat_R32Float:    return "r32float";
+        case WGPUTextureFormat_RG32Float:   return "rg32float";
+        case WGPUTextureFormat_RGBA32Float: return "rgba32float";
+        default: return NULL;
+    }
+}
+
+// 2x2 box filter, clamped at the edges of odd sized levels
+static const char mipmapDownsampleSource[] =
+    "@group(0) @binding(0) var source: texture_storage_2d_array<%s, read>;\n"
+    "@group(0) @binding(1) var destination: texture_storage_2d_array<%s, write>;\n"
+    "@compute @workgroup_size(8, 8, 1)\n"
+    "fn main(@builtin(global_invocation_id) id: vec3u) {\n"
+    "    let size = textureDimensions(destination);\n"
+    "    if (id.x >= size.x || id.y >= size.y) {\n"
+    "        return;\n"
+    "    }\n"
+    "    let last = textureDimensions(source) - vec2u(1u);\n"
+    "    let base = id.xy * 2u;\n"
+    "    let sum = textureLoad(source, min(base, last), id.z)\n"
+    "            + textureLoad(source, min(base + vec2u(1u, 0u), last), id.z)\n"
+    "            + textureLoad(source, min(base + vec2u(0u, 1u), last), id.z)\n"
+    "            + textureLoad(source, min(base + vec2u(1u, 1u), last), id.z);\n"
+    "    textureStore(destination, id.xy, id.z, sum * 0.25);\n"
+    "}\n";
+
+static WGPUBool Device_getMipmapPipeline(WGPUDevice device, WGPUTextureFormat format, MipmapPipeline* result){
+    const char* formatName = mipmapStorageFormatName(format);
+    if(formatName == NULL){
+        return 0;
+    }
+    wgvk_mutex_lock(device->mipmapPipelineMutex);
+    for(size_t i = 0;i < device->mipmapPipelines.size;i++){
+        if(device->mipmapPipelines.data[i].format == format){
+            *result = device->mipmapPipelines.data[i];
+            wgvk_mutex_unlock(device->mipmapPipelineMutex);
+            return 1;
+        }
+    }
+    char source[sizeof(mipmapDownsampleSource) + 64];
+    const int sourceLength = snprintf(source, sizeof(source), mipmapDownsampleSource, formatName, formatName);
+    WGPUShaderSourceWGSL wgslSource = {
+        .chain = {.sType = WGPUSType_ShaderSourceWGSL},
+        .code = {source, (size_t)sourceLength},
+    };
+    const WGPUShaderModuleDescriptor moduleDescriptor = {
+        .nextInChain = &wgslSource.chain,
+        .label = STRVIEW("MipmapDownsample"),
+    };
+    WGPUShaderModule module = wgpuDeviceCreateShaderModule(device, &moduleDescriptor);
+    const WGPUBindGroupLayoutEntry layoutEntries[2] = {
+        {
+            .binding = 0,
+            .visibility = WGPUShaderStage_Compute,
+            .storageTexture = {.access = WGPUStorageTextureAccess_ReadOnly, .format = format, .viewDimension = WGPUTextureViewDimension_2DArray},
+        },
+        {
+            .binding = 1,
+            .visibility = WGPUShaderStage_Compute,
+            .storageTexture = {.access = WGPUStorageTextureAccess_WriteOnly, .format = format, .viewDimension = WGPUTextureViewDimension_2DArray},
+        },
+    };
+    const WGPUBindGroupLayoutDescriptor bindGroupLayoutDescriptor = {
+        .label = STRVIEW("MipmapDownsample"),
+        .entryCount = 2,
+        .entries = layoutEntries,
+    };
+    MipmapPipeline insert = {.format = format};
+    insert.bindGroupLayout = wgpuDeviceCreateBindGroupLayout(device, &bindGroupLayoutDescriptor);
+    const WGPUPipelineLayoutDescriptor pipelineLayoutDescriptor = {
+        .label = STRVIEW("MipmapDownsample"),
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts = &insert.bindGroupLayout,
+    };
+    WGPUPipelineLayout pipelineLayout = wgpuDeviceCreatePipelineLayout(device, &pipelineLayoutDescriptor);
+    const WGPUComputePipelineDescriptor pipelineDescriptor = {
+        .label = STRVIEW("MipmapDownsample"),
+        .layout = pipelineLayout,
+        .compute = {
+            .module = module,
+            .entryPoint = STRVIEW("main"),
+        },
+    };
+    insert.pipeline = wgpuDeviceCreateComputePipeline(device, &pipelineDescriptor);
+    // The pipeline holds on to its layout
+    wgpuPipelineLayoutRelease(pipelineLayout);
+    wgpuShaderModuleRelease(module);
+    MipmapPipelineVector_push_back(&device->mipmapPipelines, insert);
+    *result = insert;
+    wgvk_mutex_unlock(device->mipmapPipelineMutex);
+    return 1;
+}
+
+// Runs with the whole texture in VK_IMAGE_LAYOUT_GENERAL, only the level read next has to wait for the previous dispatch
+static void CommandEncoder_downsampleMipmaps(WGPUCommandEncoder encoder, WGPUTexture texture, const MipmapPipeline* pipeline){
+    WGPUDevice device = encoder->device;
+    const WGPUTextureFormat format = fromVulkanPixelFormat(texture->format);
+    device->functions.vkCmdBindPipeline(encoder->buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline->computePipeline);
+    for(uint32_t level = 1;level < texture->mipLevels;level++){
+        if(level > 1){
+            CommandEncoder_mipBarrier(encoder, texture, level - 1, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+        }
+        WGPUTextureViewDescriptor viewDescriptor = {
+            .format = format,
+            .dimension = WGPUTextureViewDimension_2DArray,
+            .baseMipLevel = level - 1,
+            .mipLevelCount = 1,
+            .baseArrayLayer = 0,
+            .arrayLayerCount = texture->depthOrArrayLayers,
+            .aspect = WGPUTextureAspect_All,
+        };
+        WGPUTextureView sourceView = wgpuTextureCreateView(texture, &viewDescriptor);
+        viewDescriptor.baseMipLevel = level;
+        WGPUTextureView destinationView = wgpuTextureCreateView(texture, &viewDescriptor);
+        const WGPUBindGroupEntry entries[2] = {
+            {.binding = 0, .textureView = sourceView},
+            {.binding = 1, .textureView = destinationView},
+        };
+        const WGPUBindGroupDescriptor bindGroupDescriptor = {
+            .layout = pipeline->bindGroupLayout,
+            .entryCount = 2,
+            .entries = entries,
+        };
+        WGPUBindGroup bindGroup = wgpuDeviceCreateBindGroup(device, &bindGroupDescriptor);
+        // Kept alive by the encoder until its command buffer has retired
+        ru_trackBindGroup(&encoder->resourceUsage, bindGroup);
+        device->functions.vkCmdBindDescriptorSets(encoder->buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline->layout->layout, 0, 1, &bindGroup->set, 0, NULL);
+        const uint32_t width = texture->width >> level ? texture->width >> level : 1;
+        const uint32_t height = texture->height >> level ? texture->height >> level : 1;
+        device->functions.vkCmdDispatch(encoder->buffer, (width + 7) / 8, (height + 7) / 8, texture->depthOrArrayLayers);
+        wgpuBindGroupRelease(bindGroup);
+        wgpuTextureViewRelease(destinationView);
+        wgpuTextureViewRelease(sourceView);
+    }
+}
+#endif
+
+void wgpuCommandEncoderGenerateMipmaps(WGPUCommandEncoder commandEncoder, WGPUTexture texture){
+    ENTRY();
+    WGPUDevice device = commandEncoder->device;
+    if(texture->mipLevels < 2){
+        EXIT();
+        return;
+    }
+    if(texture->sampleCount > 1 || isDepthFormatVk(texture->format) || isDepthStencilFormatVk(texture->format)){
+        DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderGenerateMipmaps: texture must be single sampled and have a color format"));
+        EXIT();
+        return;
+    }
+    VkFormatProperties formatProperties zeroinit;
+    vkGetPhysicalDeviceFormatProperties(device->adapter->physicalDevice, texture->format, &formatProperties);
+    const VkFormatFeatureFlags features = formatProperties.optimalTilingFeatures;
+    const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    const VkImageUsageFlags transferUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    const WGPUBool canBlit = (features & blitFeatures) == blitFeatures && (texture->usage & transferUsage) == transferUsage;
+    const VkImageSubresourceRange wholeTexture = {VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+    ImageUsageSnap finalUsage zeroinit;
+
+    CommandEncoder_initializeTextureRead(commandEncoder, texture, (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, VK_REMAINING_ARRAY_LAYERS});
+
+    #if SUPPORT_WGSL == 1
+    MipmapPipeline downsamplePipeline zeroinit;
+    const WGPUBool canDownsample = texture->dimension == VK_IMAGE_TYPE_2D && 
+        (texture->usage & VK_IMAGE_USAGE_STORAGE_BIT) && (features & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT);
+    #endif
+    if(canBlit && (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)){
+        ce_trackTexture(commandEncoder, texture, (ImageUsageSnap){
+            .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .access = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .subresource = wholeTexture,
+        });
+        CommandEncoder_blitMipmaps(commandEncoder, texture, VK_FILTER_LINEAR);
+        finalUsage = (ImageUsageSnap){VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, wholeTexture};
+    }
+    #if SUPPORT_WGSL == 1
+    else if(canDownsample && Device_getMipmapPipeline(device, fromVulkanPixelFormat(texture->format), &downsamplePipeline)){
+        ce_trackTexture(commandEncoder, texture, (ImageUsageSnap){
+            .layout = VK_IMAGE_LAYOUT_GENERAL,
+            .stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            .access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .subresource = wholeTexture,
+        });
+        CommandEncoder_downsampleMipmaps(commandEncoder, texture, &downsamplePipeline);
+        finalUsage = (ImageUsageSnap){VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, wholeTexture};
+    }
+    #endif
+    else if(canBlit){
+        // Integer formats and the like: no filtering, but still no CPU round trip
+        ce_trackTexture(commandEncoder, texture, (ImageUsageSnap){
+            .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+            .access = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .subresource = wholeTexture,
+        });
+        CommandEncoder_blitMipmaps(commandEncoder, texture, VK_FILTER_NEAREST);
+        finalUsage = (ImageUsageSnap){VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, wholeTexture};
+    }
+    else{
+        DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderGenerateMipmaps: the texture's format and usage allow neither blits (CopySrc | CopyDst) nor the compute downsample (StorageBinding)"));
+        EXIT();
+        return;
+    }
+    ++commandEncoder->encodedCommandCount;
+    CommandEncoder_noteTextureContents(commandEncoder, texture, wholeTexture, 1);
+    // The levels were transitioned individually, the tracked state of the whole texture catches up here
+    ImageUsageRecord* record = ImageUsageRecordMap_get(&commandEncoder->resourceUsage.referencedTextures, texture);
+    record->lastLayout = finalUsage.layout;
+    record->lastStage = finalUsage.stage;
+    record->lastAccess = finalUsage.access;
+    record->lastAccessedSubresource = finalUsage.subresource;
+    EXIT();
+}
+// channelBits receives the width of r, g, b and a for integer formats
+static inline WGPUBool isIntegerFormatVk(VkFormat format, WGPUBool* isSigned, uint32_t channelBits[4]){
+    uint32_t bits = 0;
+    switch(format){
+        case VK_FORMAT_R8_SINT: case VK_FORMAT_R8G8_SINT: case VK_FORMAT_R8G8B8A8_SINT: bits = 8; *isSigned = 1; break;
+        case VK_FORMAT_R16_SINT: case VK_FORMAT_R16G16_SINT: case VK_FORMAT_R16G16B16A16_SINT: bits = 16; *isSigned = 1; break;
+        case VK_FORMAT_R32_SINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32B32A32_SINT: bits = 32; *isSigned = 1; break;
+        case VK_FORMAT_R8_UINT: case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8B8A8_UINT: bits = 8; *isSigned = 0; break;
+        case VK_FORMAT_R16_UINT: case VK_FORMAT_R16G16_UINT: case VK_FORMAT_R16G16B16A16_UINT: bits = 16; *isSigned = 0; break;
+        case VK_FORMAT_R32_UINT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32B32A32_UINT: bits = 32; *isSigned = 0; break;
+        case VK_FORMAT_A2B10G10R10_UINT_PACK32:
+            *isSigned = 0;
+            channelBits[0] = channelBits[1] = channelBits[2] = 10;
+            channelBits[3] = 2;
+            return 1;
+        default:
+            return 0;
+    }
+    channelBits[0] = channelBits[1] = channelBits[2] = channelBits[3] = bits;
+    return 1;
+}
+
+void wgpuCommandEncoderClearTexture(WGPUCommandEncoder commandEncoder, WGPUTexture texture, WGPUTextureClearDescriptor const * descriptor){
+    ENTRY();
+    const WGPUTextureClearDescriptor zeroClear = {
+        .aspect = WGPUTextureAspect_All,
+        .mipLevelCount = WGPU_MIP_LEVEL_COUNT_UNDEFINED,
+        .arrayLayerCount = WGPU_ARRAY_LAYER_COUNT_UNDEFINED,
+    };
+    if(descriptor == NULL){
+        descriptor = &zeroClear;
+    }
+    if(!(texture->usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) || texture->sampleCount > 1){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderClearTexture: texture must be single sampled and have CopyDst usage"));
+        EXIT();
+        return;
+    }
+    const uint32_t layers = texture->dimension == VK_IMAGE_TYPE_3D ? 1 : texture->depthOrArrayLayers;
+    const uint32_t baseArrayLayer = texture->dimension == VK_IMAGE_TYPE_3D ? 0 : descriptor->baseArrayLayer;
+    // Bases are checked first so the remaining counts below can't wrap around
+    if(descriptor->baseMipLevel >= texture->mipLevels || baseArrayLayer >= layers){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderClearTexture: subresource range exceeds the texture"));
+        EXIT();
+        return;
+    }
+    const VkImageSubresourceRange range = {
+        .aspectMask = toVulkanAspectMaskVk(descriptor->aspect == WGPUTextureAspect_Undefined ? WGPUTextureAspect_All : descriptor->aspect, texture->format),
+        .baseMipLevel = descriptor->baseMipLevel,
+        .levelCount = descriptor->mipLevelCount == WGPU_MIP_LEVEL_COUNT_UNDEFINED ? texture->mipLevels - descriptor->baseMipLevel : descriptor->mipLevelCount,
+        .baseArrayLayer = baseArrayLayer,
+        .layerCount = (texture->dimension == VK_IMAGE_TYPE_3D || descriptor->arrayLayerCount == WGPU_ARRAY_LAYER_COUNT_UNDEFINED) ? layers - baseArrayLayer : descriptor->arrayLayerCount,
+    };
+    if(range.levelCount == 0 || range.levelCount > texture->mipLevels - range.baseMipLevel || range.layerCount == 0 || range.layerCount > layers - range.baseArrayLayer){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderClearTexture: subresource range exceeds the texture"));
+        EXIT();
+        return;
+    }
+    ++commandEncoder->encodedCommandCount;
+    // Clearing only one aspect of a depth stencil texture leaves the other one to be zeroed first
+    CommandEncoder_initializeTextureWrite(commandEncoder, texture, range, range.aspectMask == toVulkanAspectMaskVk(WGPUTextureAspect_All, texture->format));
+    ce_trackTexture(commandEncoder, texture, (ImageUsageSnap){
+        .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+        .access = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .subresource = range,
+    });
+    if(range.aspectMask & (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT)){
+        const VkClearDepthStencilValue value = {
+            .depth = descriptor->depthClearValue,
+            .stencil = descriptor->stencilClearValue,
+        };
+        commandEncoder->device->functions.vkCmdClearDepthStencilImage(commandEncoder->buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &value, 1, &range);
+    }
+    else{
+        const double components[4] = {descriptor->color.r, descriptor->color.g, descriptor->color.b, descriptor->color.a};
+        VkClearColorValue value zeroinit;
+        WGPUBool isSigned = 0;
+        uint32_t channelBits[4] = {0};
+        const WGPUBool isInteger = isIntegerFormatVk(texture->format, &isSigned, channelBits);
+        for(uint32_t i = 0;i < 4;i++){
+            if(!isInteger){
+                value.float32[i] = (float)components[i];
+                continue;
+            }
+            // Converting an out of range double is undefined, clamp to what the channel holds (NaN clears to 0)
+            const double values = (double)(1ull << channelBits[i]);
+            const double maximum = isSigned ? values / 2.0 - 1.0 : values - 1.0;
+            const double minimum = isSigned ? -values / 2.0 : 0.0;
+            double component = components[i] != components[i] ? 0.0 : components[i];
+            component = component < minimum ? minimum : (component > maximum ? maximum : component);
+            if(isSigned)value.int32[i] = (int32_t)component;
+            else value.uint32[i] = (uint32_t)component;
+        }
+        commandEncoder->device->functions.vkCmdClearColorImage(commandEncoder->buffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &value, 1, &range);
+    }
+    EXIT();
+}
+/**
+ * @brief Tracks a buffer read by indirect draws of the pass, once per pass
+ * @details Deduplicated on the indirect access of the pass's record, a buffer the pass already uses 
+ * in another way still needs the indirect usage and its barrier.
+ */
+static void RenderPassEncoder_trackIndirectBuffer(WGPURenderPassEncoder renderPassEncoder, WGPUBuffer buffer){
+    const BufferUsageSnap indirectUsage = {
+        .access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        .stage = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+    };
+    BufferUsageRecord* record = BufferUsageRecordMap_get(&renderPassEncoder->resourceUsage.referencedBuffers, buffer);
+    if(record && (record->lastAccess & indirectUsage.access)){
+        return;
+    }
+    CommandEncoder_initializeBufferRead(renderPassEncoder->cmdEncoder, buffer, 0, WGPU_WHOLE_SIZE);
+    if(record){
+        record->lastStage |= indirectUsage.stage;
+        record->lastAccess |= indirectUsage.access;
+    }else{
+        ru_trackBuffer(&renderPassEncoder->resourceUsage, buffer, (BufferUsageRecord){
+            .initialStage = indirectUsage.stage,
+            .initialAccess = indirectUsage.access,
+            .lastStage = indirectUsage.stage,
+            .lastAccess = indirectUsage.access,
+        });
+    }
+    ce_trackBuffer(renderPassEncoder->cmdEncoder, buffer, indirectUsage);
+}
+
 void RenderPassEncoder_PushCommand(WGPURenderPassEncoder encoder, const RenderPassCommandGeneric* cmd){
     if(cmd->type == rp_command_type_set_render_pipeline){
         encoder->lastLayout = cmd->setRenderPipeline.pipeline->layout;
     }
-    RenderPassCommandGenericVector_push_back(&encoder->bufferedCommands, *cmd);
+    Device_pushCommand(encoder->device, &encoder->bufferedCommands, cmd);
 }
 
 void ComputePassEncoder_PushCommand(WGPUComputePassEncoder encoder, const RenderPassCommandGeneric* cmd){
     if(cmd->type == cp_command_type_set_compute_pipeline){
         encoder->lastLayout = cmd->setComputePipeline.pipeline->layout;
     }
-    RenderPassCommandGenericVector_push_back(&encoder->bufferedCommands, *cmd);
+    Device_pushCommand(encoder->device, &encoder->bufferedCommands, cmd);
 }
 
 void RaytracingPassEncoder_PushCommand(WGPURaytracingPassEncoder encoder, const RenderPassCommandGeneric* cmd){
     if(cmd->type == rp_command_type_set_raytracing_pipeline){
         encoder->lastLayout = cmd->setRaytracingPipeline.pipeline->layout;
     }
-    RenderPassCommandGenericVector_push_back(&encoder->bufferedCommands, *cmd);
+    Device_pushCommand(encoder->device, &encoder->bufferedCommands, cmd);
 }
 
 
@@ -6250,6 +8936,44 @@ void wgpuRenderPassEncoderSetPipeline(WGPURenderPassEncoder rpe, WGPURenderPipel
     EXIT();
 }
 
+/**
+ * @brief Zeroes what the resources of group still have uninitialized, before the pass that binds it
+ */
+static void CommandEncoder_initializeBindGroup(WGPUCommandEncoder encoder, WGPUBindGroup group){
+    for(uint32_t i = 0;i < group->entryCount;i++){
+        const WGPUBindGroupEntry* entry = &group->entries[i];
+        if(entry->buffer){
+            CommandEncoder_initializeBufferRead(encoder, entry->buffer, entry->offset, entry->size);
+        }
+        if(entry->textureView){
+            CommandEncoder_initializeTextureRead(encoder, entry->textureView->texture, entry->textureView->subresourceRange);
+        }
+    }
+    for(uint32_t a = 0;a < group->slotAllocatorCount;a++){
+        const BindGroupSlotAllocator* allocator = group->slotAllocators + a;
+        for(uint32_t slot = 0;slot < allocator->contentEnd;slot++){
+            const BindGroupSlotContent* content = allocator->contents + slot;
+            if(content->buffer){
+                CommandEncoder_initializeBufferRead(encoder, content->buffer, content->offset, content->size);
+            }
+            if(content->textureView){
+                CommandEncoder_initializeTextureRead(encoder, content->textureView->texture, content->textureView->subresourceRange);
+            }
+        }
+    }
+}
+
+// Barrier for a texture of group as a draw of the pass sees it
+static void RenderPassEncoder_trackGroupTexture(WGPURenderPassEncoder rpe, BarrierBatch* barriers, const WGPUBindGroupLayoutEntry* layoutEntry, WGPUTextureView view){
+    const WGPUBool storage = layoutEntry->storageTexture.access != WGPUStorageTextureAccess_BindingNotUsed;
+    ce_trackTextureViewBatched(rpe->cmdEncoder, barriers, view, (ImageUsageSnap){
+        .layout = storage ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .access = extractVkAccessFlags(layoutEntry),
+        .stage = toVulkanPipelineStageBits(layoutEntry->visibility) | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        .subresource = view->subresourceRange
+    });
+}
+
 void wgpuRenderPassEncoderSetBindGroup(WGPURenderPassEncoder rpe, uint32_t groupIndex, WGPUBindGroup group, size_t dynamicOffsetCount, const uint32_t* dynamicOffsets) {
     ENTRY();
     wgvk_assert(rpe != NULL, "RenderPassEncoderHandle is null");
@@ -6268,36 +8992,41 @@ void wgpuRenderPassEncoderSetBindGroup(WGPURenderPassEncoder rpe, uint32_t group
     
     RenderPassEncoder_PushCommand(rpe, &insert);
     
-    
-    
-
+    // Usages don't change within a pass, a group only needs tracking the first time it is set
+    if(ru_containsBindGroup(&rpe->resourceUsage, group)){
+        EXIT();
+        return;
+    }
+    CommandEncoder_initializeBindGroup(rpe->cmdEncoder, group);
+    BarrierBatch barriers = {0};
+    for(uint32_t i = 0;i < group->bufferUsageCount;i++){
+        ce_trackBufferBatched(rpe->cmdEncoder, &barriers, group->bufferUsages[i].buffer, group->bufferUsages[i].usage);
+    }
     for(uint32_t i = 0;i < group->entryCount;i++){
-
         const WGPUBindGroupEntry* entry = &group->entries[i];
-
-        if(entry->buffer){
-            const VkAccessFlags accessFlags = extractVkAccessFlags(group->layout->entries + i);
-            const VkPipelineStageFlags stage = toVulkanPipelineStageBits(group->layout->entries[i].visibility);
-            ce_trackBuffer(rpe->cmdEncoder, entry->buffer, (BufferUsageSnap){
-                .stage = stage,
-                .access = accessFlags
-            });
-        }
-
         if(entry->textureView){
-            const VkAccessFlags accessFlags = extractVkAccessFlags(group->layout->entries + i);
-            const VkPipelineStageFlags stage = toVulkanPipelineStageBits(group->layout->entries[i].visibility) | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-            
-            //VkImageLayout layout = (extractVkDescriptorType(group->layout->entries + i) == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-            ce_trackTextureView(rpe->cmdEncoder, entry->textureView, (ImageUsageSnap){
-                .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                .access = accessFlags,
-                .stage = stage,
-                .subresource = entry->textureView->subresourceRange
-            });
+            const uint32_t layoutIndex = BindGroupLayout_entryIndex(group->layout, entry->binding, i);
+            if(layoutIndex == group->layout->entryCount)continue;
+            RenderPassEncoder_trackGroupTexture(rpe, &barriers, group->layout->entries + layoutIndex, entry->textureView);
+        }
+    }
+    for(uint32_t a = 0;a < group->slotAllocatorCount;a++){
+        const BindGroupSlotAllocator* allocator = group->slotAllocators + a;
+        const WGPUBindGroupLayoutEntry* layoutEntry = group->layout->entries + allocator->layoutIndex;
+        for(uint32_t slot = 0;slot < allocator->contentEnd;slot++){
+            const BindGroupSlotContent* content = allocator->contents + slot;
+            if(content->buffer){
+                ce_trackBufferBatched(rpe->cmdEncoder, &barriers, content->buffer, (BufferUsageSnap){
+                    .stage  = toVulkanPipelineStageBits(layoutEntry->visibility),
+                    .access = extractVkAccessFlags(layoutEntry),
+                });
+            }
+            if(content->textureView){
+                RenderPassEncoder_trackGroupTexture(rpe, &barriers, layoutEntry, content->textureView);
+            }
         }
     }
+    ce_flushBarriers(rpe->cmdEncoder, &barriers);
     ru_trackBindGroup(&rpe->resourceUsage, group);
     EXIT();
 }
@@ -6329,6 +9058,7 @@ void wgpuComputePassEncoderSetBindGroup(WGPUComputePassEncoder cpe, uint32_t gro
         }
     };
     cpe->bindGroups[groupIndex] = group;
+    CommandEncoder_initializeBindGroup(cpe->cmdEncoder, group);
     
     //for(uint32_t i = 0;i < group->entryCount;i++){
     //    const WGPUBindGroupEntry* entry = &group->entries[i];
@@ -6353,24 +9083,41 @@ WGPUComputePassEncoder wgpuCommandEncoderBeginComputePass(WGPUCommandEncoder com
     ret->refCount = 2;
     WGPUComputePassEncoderSet_add(&commandEncoder->referencedCPs, ret);
 
-    RenderPassCommandGenericVector_init(&ret->bufferedCommands);
+    ContainerCache_acquireResourceUsage(&commandEncoder->device->containerCache, &ret->resourceUsage);
+    ContainerCache_acquireCommandStream(&commandEncoder->device->containerCache, &ret->bufferedCommands);
 
     ret->cmdEncoder = commandEncoder;
     ret->device = commandEncoder->device;
+    if(cpdesc && cpdesc->timestampWrites){
+        ret->timestampWritesPresent = 1;
+        ret->timestampWrites = *cpdesc->timestampWrites;
+        CommandEncoder_markPassTimestampWrites(commandEncoder, cpdesc->timestampWrites);
+    }
+    ret->timestampScope = Device_beginTimestampScope(commandEncoder, cpdesc ? cpdesc->label : (WGPUStringView){0}, "ComputePass");
     return ret;
     EXIT();
 }
 void wgpuComputePassEncoderEnd(WGPUComputePassEncoder commandEncoder){
     ENTRY();
-    recordVkCommands(commandEncoder->cmdEncoder, commandEncoder->device, &commandEncoder->bufferedCommands, NULL);
+    WGPUDevice device = commandEncoder->device;
+    WGPUCommandEncoder encoder = commandEncoder->cmdEncoder;
+    Device_recordTimestampScope(device, encoder->buffer, &encoder->timestamps, commandEncoder->timestampScope, 0);
+    if(commandEncoder->timestampWritesPresent){
+        PassTimestampWrites_record(device, encoder->buffer, &commandEncoder->timestampWrites, 0);
+    }
+    recordVkCommands(encoder, device, &commandEncoder->bufferedCommands, NULL);
+    if(commandEncoder->timestampWritesPresent){
+        PassTimestampWrites_record(device, encoder->buffer, &commandEncoder->timestampWrites, 1);
+    }
+    Device_recordTimestampScope(device, encoder->buffer, &encoder->timestamps, commandEncoder->timestampScope, 1);
     EXIT();
 }
 void wgpuComputePassEncoderRelease(WGPUComputePassEncoder cpenc){
     ENTRY();
     --cpenc->refCount;
     if(cpenc->refCount == 0){
-        releaseAllAndClear(&cpenc->resourceUsage);
-        RenderPassCommandGenericVector_free(&cpenc->bufferedCommands);
+        ContainerCache_recycleResourceUsage(&cpenc->device->containerCache, &cpenc->resourceUsage);
+        ContainerCache_recycleCommandStream(&cpenc->device->containerCache, &cpenc->bufferedCommands);
         RL_FREE(cpenc);
     }
     EXIT();
@@ -6380,7 +9127,8 @@ void wgpuReleaseRaytracingPassEncoder(WGPURaytracingPassEncoder rtenc){
     ENTRY();
     --rtenc->refCount;
     if(rtenc->refCount == 0){
-        releaseAllAndClear(&rtenc->resourceUsage);
+        ContainerCache_recycleResourceUsage(&rtenc->device->containerCache, &rtenc->resourceUsage);
+        ContainerCache_recycleCommandStream(&rtenc->device->containerCache, &rtenc->bufferedCommands);
         RL_FREE(rtenc);
     }
     EXIT();
@@ -6401,7 +9149,8 @@ WGPURaytracingPassEncoder wgpuCommandEncoderBeginRaytracingPass(WGPUCommandEncod
     WGPURaytracingPassEncoder rtenc = RL_CALLOC(1, sizeof(WGPURaytracingPassEncoderImpl));
     rtenc->device = enc->device;
     rtenc->refCount = 2;
-    RenderPassCommandGenericVector_init(&rtenc->bufferedCommands);
+    ContainerCache_acquireResourceUsage(&enc->device->containerCache, &rtenc->resourceUsage);
+    ContainerCache_acquireCommandStream(&enc->device->containerCache, &rtenc->bufferedCommands);
     rtenc->cmdEncoder = enc;
     rtenc->cmdBuffer = enc->buffer;
     EXIT();
@@ -6410,8 +9159,8 @@ WGPURaytracingPassEncoder wgpuCommandEncoderBeginRaytracingPass(WGPUCommandEncod
 
 void wgpuRaytracingPassEncoderEnd(WGPURaytracingPassEncoder rtPassEncoder){
     ENTRY();
-    for(size_t i = 0;i < rtPassEncoder->bufferedCommands.size;i++){
-        const RenderPassCommandGeneric* cmd = &rtPassEncoder->bufferedCommands.data[i];
+    RenderPassCommandStreamReader reader = RenderPassCommandStream_read(&rtPassEncoder->bufferedCommands);
+    for(const RenderPassCommandGeneric* cmd = RenderPassCommandStreamReader_next(&reader);cmd;cmd = RenderPassCommandStreamReader_next(&reader)){
         if(cmd->type == rp_command_type_set_bind_group){
             const RenderPassCommandSetBindGroup* cmdSetBindGroup = &cmd->setBindGroup;
             const WGPUBindGroup       group  = cmdSetBindGroup->group;
@@ -6513,22 +9262,62 @@ void resetFenceAndReleaseBuffers(void* fence_, WGPUCommandBufferVector* cBuffers
     WGPUCommandBufferVector_free(cBuffers);
 }
 
+/**
+ * @brief Blocks until at most maxQueuedFrames - 1 presents of the surface are outstanding, see WGPUSurfaceFrameLatency
+ * @details Without present wait only the GPU side can be bounded, and only below framesInFlight since 
+ * wgpuDeviceTick already waits for the frame framesInFlight presents back.
+ */
+static void Surface_waitForQueuedFrames(WGPUSurface surface){
+    WGPUDevice device = surface->device;
+    if(surface->presentWait){
+        if(surface->presentId >= surface->maxQueuedFrames){
+            const uint64_t waitedId = surface->presentId + 1 - surface->maxQueuedFrames;
+            VkResult waitResult = device->functions.vkWaitForPresentKHR(device->device, surface->swapchain, waitedId, UINT64_MAX);
+            if(waitResult != VK_SUCCESS && waitResult != VK_SUBOPTIMAL_KHR && waitResult != VK_ERROR_OUT_OF_DATE_KHR){
+                fprintf(stderr, "vkWaitForPresentKHR returned %s\n", vkErrorString(waitResult));
+            }
+        }
+    }
+    else if(surface->maxQueuedFrames < framesInFlight && device->submittedFrames >= surface->maxQueuedFrames){
+        PerframeCache* queuedCache = DeviceGetFIFCache(device, (device->submittedFrames - surface->maxQueuedFrames) % framesInFlight);
+        // A fence in the Reset state was never submitted and would block wgpuFenceWait forever
+        if(atomic_load_explicit(&queuedCache->finalTransitionFence->state, memory_order_acquire) != WGPUFenceState_Reset){
+            wgpuFenceWait(queuedCache->finalTransitionFence, UINT64_MAX);
+        }
+    }
+}
+
 void wgpuSurfaceGetCurrentTexture(WGPUSurface surface, WGPUSurfaceTexture* surfaceTexture){
     ENTRY();
     const size_t submittedframes = surface->device->submittedFrames;
     const uint32_t cacheIndex = surface->device->submittedFrames % framesInFlight;
     SyncState* syncState = DeviceGetSyncState(surface->device, cacheIndex);
-    if(surface->swapchain){
-        VkResult acquireResult = surface->device->functions.vkAcquireNextImageKHR(
-            surface->device->device,
-            surface->swapchain,
-            UINT32_MAX,
-            syncState->acquireImageSemaphore,
-            VK_NULL_HANDLE,
-            &surface->activeImageIndex
-        );
-        if(acquireResult == VK_SUCCESS || acquireResult == VK_SUBOPTIMAL_KHR){
-            syncState->acquireImageSemaphoreSignalled = true;
+    if(surface->images){
+        const uint64_t acquireBegin = wgvkNanoTime();
+        Surface_waitForQueuedFrames(surface);
+        VkResult acquireResult = VK_SUCCESS;
+        if(surface->surfaceType == SurfaceImplType_Virtual){
+            // Queue order alone protects the ring, no acquire semaphore is involved
+            surface->activeImageIndex = (surface->activeImageIndex + 1) % surface->imagecount;
+        }
+        else{
+            acquireResult = surface->device->functions.vkAcquireNextImageKHR(
+                surface->device->device,
+                surface->swapchain,
+                UINT32_MAX,
+                syncState->acquireImageSemaphore,
+                VK_NULL_HANDLE,
+                &surface->activeImageIndex
+            );
+            if(acquireResult == VK_SUCCESS || acquireResult == VK_SUBOPTIMAL_KHR){
+                syncState->acquireImageSemaphoreSignalled = true;
+            }
+        }
+        SurfacePacing* pacing = &surface->pacing;
+        pacing->acquireWaitMilliseconds[pacing->nextAcquireSample] = (double)(wgvkNanoTime() - acquireBegin) / 1000000.0;
+        pacing->nextAcquireSample = (pacing->nextAcquireSample + 1) % WGVK_PACING_STATISTICS_WINDOW;
+        if(pacing->acquireSampleCount < WGVK_PACING_STATISTICS_WINDOW){
+            ++pacing->acquireSampleCount;
         }
         switch(acquireResult){
             case VK_ERROR_SURFACE_LOST_KHR:
@@ -6577,13 +9366,16 @@ void wgpuSurfacePresent(WGPUSurface surface){
 
     device->functions.vkBeginCommandBuffer(transitionBuffer, &transitionBufferBeginInfo);
 
+    // Virtual surfaces leave the presented texture ready to be copied out instead of handing it to a presentation engine
+    const WGPUBool virtualSurface = surface->surfaceType == SurfaceImplType_Virtual;
+    const VkImageLayout presentLayout = virtualSurface ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
     VkImageMemoryBarrier finalBarrier = {
         VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         NULL,
-        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-        VK_ACCESS_MEMORY_READ_BIT,
+        VK_ACCESS_MEMORY_WRITE_BIT,
+        virtualSurface ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_MEMORY_READ_BIT,
         surface->images[surface->activeImageIndex]->layout,
-        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        presentLayout,
         surface->device->adapter->queueIndices.graphicsIndex,
         surface->device->adapter->queueIndices.graphicsIndex,
         surface->images[surface->activeImageIndex]->image,
@@ -6593,45 +9385,35 @@ void wgpuSurfacePresent(WGPUSurface surface){
             0, VK_REMAINING_ARRAY_LAYERS
         }
     };
+    // No semaphore chains the earlier submits of this frame anymore, so this barrier has to cover all of them
     device->functions.vkCmdPipelineBarrier(
         transitionBuffer,
-        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        virtualSurface ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
         0,
         0, NULL,
         0, NULL,
         1, &finalBarrier  
     );
-    surface->images[surface->activeImageIndex]->layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    surface->images[surface->activeImageIndex]->layout = presentLayout;
     device->functions.vkEndCommandBuffer(transitionBuffer);
 
-    VkPipelineStageFlags wsmask[2] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSemaphore waitSemaphores[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
-    uint32_t waitSemaphoreCount = 0;
-    if(syncState->submits > 0){
-        waitSemaphores[waitSemaphoreCount++] = syncState->semaphores.data[syncState->submits];
-    }
+    VkSemaphore waitSemaphore = VK_NULL_HANDLE;
     if(syncState->acquireImageSemaphoreSignalled){
-        waitSemaphores[waitSemaphoreCount++] = syncState->acquireImageSemaphore;
+        waitSemaphore = syncState->acquireImageSemaphore;
         syncState->acquireImageSemaphoreSignalled = false;
     }
-    const VkSubmitInfo cbsinfo = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = NULL,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &transitionBuffer,
-        .signalSemaphoreCount = 1,
-        .waitSemaphoreCount = waitSemaphoreCount,
-        .pWaitDstStageMask = wsmask,
-        .pWaitSemaphores = waitSemaphores,
-        .pSignalSemaphores = surface->presentSemaphores + surface->activeImageIndex
-    };
-    
     
     WGPUFence finalTransitionFence = frameCache->finalTransitionFence;
     wgpuFenceAddRef(finalTransitionFence);
     //printf("Submitting %p with fence %p\n", transitionBuffer, finalTransitionFence);
-    device->functions.vkQueueSubmit(surface->device->queue->graphicsQueue, 1, &cbsinfo, finalTransitionFence->fence);
+    Queue_submitBatch(
+        device->queue,
+        &transitionBuffer, 1,
+        waitSemaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        virtualSurface ? VK_NULL_HANDLE : surface->presentSemaphores[surface->activeImageIndex], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        finalTransitionFence->fence
+    );
     
     finalTransitionFence->state = WGPUFenceState_InUse;
     
@@ -6644,22 +9426,151 @@ void wgpuSurfacePresent(WGPUSurface surface){
         WGPUCommandBufferVector_init(cmdBuffers);
     }
 
-    VkPresentInfoKHR presentInfo  = {
-        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = surface->presentSemaphores + surface->activeImageIndex,
-        .swapchainCount = 1,
-        .pSwapchains = &surface->swapchain,
-        .pImageIndices = &surface->activeImageIndex,
-    };
+    const uint64_t presentId = ++surface->presentId;
+    if(!virtualSurface){
+        const VkPresentIdKHR presentIdInfo = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+            .swapchainCount = 1,
+            .pPresentIds = &presentId,
+        };
+        VkPresentInfoKHR presentInfo  = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .pNext = surface->presentWait ? &presentIdInfo : NULL,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = surface->presentSemaphores + surface->activeImageIndex,
+            .swapchainCount = 1,
+            .pSwapchains = &surface->swapchain,
+            .pImageIndices = &surface->activeImageIndex,
+        };
 
-    VkResult presentRes = device->functions.vkQueuePresentKHR(surface->device->queue->presentQueue, &presentInfo);
-    if(presentRes != VK_SUCCESS && presentRes != VK_SUBOPTIMAL_KHR){
-        fprintf(stderr, "vkQueuePresentKHR returned %s\n", vkErrorString(presentRes));
+        VkResult presentRes = device->functions.vkQueuePresentKHR(surface->device->queue->presentQueue, &presentInfo);
+        if(presentRes != VK_SUCCESS && presentRes != VK_SUBOPTIMAL_KHR){
+            fprintf(stderr, "vkQueuePresentKHR returned %s\n", vkErrorString(presentRes));
+        }
+    }
+    SurfacePacing* pacing = &surface->pacing;
+    const uint64_t presentTime = wgvkNanoTime();
+    if(pacing->lastPresentTime != 0){
+        pacing->presentIntervalMilliseconds[pacing->nextPresentSample] = (double)(presentTime - pacing->lastPresentTime) / 1000000.0;
+        pacing->nextPresentSample = (pacing->nextPresentSample + 1) % WGVK_PACING_STATISTICS_WINDOW;
+        if(pacing->presentSampleCount < WGVK_PACING_STATISTICS_WINDOW){
+            ++pacing->presentSampleCount;
+        }
     }
+    pacing->lastPresentTime = presentTime;
     wgpuDeviceTick(surface->device);
     EXIT();
 }
+
+void wgpuDeviceGetTextureViewCacheStatistics(WGPUDevice device, WGPUTextureViewCacheStatistics* statistics){
+    ENTRY();
+    *statistics = (WGPUTextureViewCacheStatistics){
+        .hits = atomic_load_explicit(&device->viewCacheHits, memory_order_relaxed),
+        .misses = atomic_load_explicit(&device->viewCacheMisses, memory_order_relaxed),
+        .evictions = atomic_load_explicit(&device->viewCacheEvictions, memory_order_relaxed),
+    };
+    EXIT();
+}
+
+void wgpuSurfaceGetPacingStatistics(WGPUSurface surface, WGPUSurfacePacingStatistics* statistics){
+    ENTRY();
+    const SurfacePacing* pacing = &surface->pacing;
+    double acquireSum = 0.0, acquireMax = 0.0, intervalSum = 0.0, intervalMax = 0.0;
+    for(uint32_t i = 0;i < pacing->acquireSampleCount;i++){
+        acquireSum += pacing->acquireWaitMilliseconds[i];
+        acquireMax = pacing->acquireWaitMilliseconds[i] > acquireMax ? pacing->acquireWaitMilliseconds[i] : acquireMax;
+    }
+    for(uint32_t i = 0;i < pacing->presentSampleCount;i++){
+        intervalSum += pacing->presentIntervalMilliseconds[i];
+        intervalMax = pacing->presentIntervalMilliseconds[i] > intervalMax ? pacing->presentIntervalMilliseconds[i] : intervalMax;
+    }
+    *statistics = (WGPUSurfacePacingStatistics){
+        .sampleCount = pacing->acquireSampleCount,
+        .averageAcquireWaitMilliseconds = pacing->acquireSampleCount ? acquireSum / pacing->acquireSampleCount : 0.0,
+        .maxAcquireWaitMilliseconds = acquireMax,
+        .averagePresentIntervalMilliseconds = pacing->presentSampleCount ? intervalSum / pacing->presentSampleCount : 0.0,
+        .maxPresentIntervalMilliseconds = intervalMax,
+        .presentWait = surface->presentWait,
+    };
+    EXIT();
+}
+static void Device_addTimestampSample(WGPUDevice device, const char* label, double milliseconds){
+    TimestampLabelStatistics* statistics = NULL;
+    for(size_t i = 0;i < device->timestampStatistics.size;i++){
+        if(strcmp(device->timestampStatistics.data[i].label, label) == 0){
+            statistics = device->timestampStatistics.data + i;
+            break;
+        }
+    }
+    if(statistics == NULL){
+        TimestampLabelStatistics insert zeroinit;
+        memcpy(insert.label, label, WGVK_TIMESTAMP_LABEL_LENGTH);
+        TimestampLabelStatisticsVector_push_back(&device->timestampStatistics, insert);
+        statistics = device->timestampStatistics.data + device->timestampStatistics.size - 1;
+    }
+    statistics->milliseconds[statistics->nextSample] = milliseconds;
+    statistics->nextSample = (statistics->nextSample + 1) % WGVK_TIMESTAMP_STATISTICS_WINDOW;
+    if(statistics->sampleCount < WGVK_TIMESTAMP_STATISTICS_WINDOW){
+        ++statistics->sampleCount;
+    }
+}
+
+/**
+ * @brief Folds the timestamps of the command buffers a retired frame submitted into the device's statistics
+ * @details The frame's fences have been waited for, so the results are read without VK_QUERY_RESULT_WAIT_BIT.
+ * Scopes whose commands never executed report unavailable and are dropped. The query pools go back to the device.
+ */
+static void PerframeCache_collectTimestamps(WGPUDevice device, PerframeCache* pfcache){
+    for(size_t t = 0;t < pfcache->timestamps.size;t++){
+        TimestampScopes* timestamps = pfcache->timestamps.data + t;
+        const uint32_t scopeCount = timestamps->scopeCount < device->timestampScopeCapacity ? timestamps->scopeCount : device->timestampScopeCapacity;
+        if(scopeCount){
+            // Per query: value and availability
+            uint64_t* results = RL_CALLOC(4 * scopeCount, sizeof(uint64_t));
+            device->functions.vkGetQueryPoolResults(
+                device->device,
+                timestamps->queryPool,
+                0, 2 * scopeCount,
+                4 * scopeCount * sizeof(uint64_t), results,
+                2 * sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+            );
+            for(uint32_t i = 0;i < scopeCount;i++){
+                const uint64_t* scope = results + 4 * i;
+                if(scope[1] == 0 || scope[3] == 0 || scope[2] < scope[0])continue;
+                Device_addTimestampSample(device, timestamps->labels[i], (double)(scope[2] - scope[0]) * device->timestampPeriod * 1e-6);
+            }
+            RL_FREE(results);
+        }
+        Device_recycleTimestampScopes(device, timestamps);
+    }
+    TimestampScopesVector_clear(&pfcache->timestamps);
+}
+
+size_t wgpuDeviceGetTimestampStatistics(WGPUDevice device, WGPUTimestampStatistics* statistics, size_t capacity){
+    ENTRY();
+    const size_t labelCount = device->timestampStatistics.size;
+    for(size_t i = 0;i < labelCount && i < capacity;i++){
+        const TimestampLabelStatistics* source = device->timestampStatistics.data + i;
+        double minimum = source->milliseconds[0], maximum = source->milliseconds[0], sum = 0.0;
+        for(uint32_t sample = 0;sample < source->sampleCount;sample++){
+            const double value = source->milliseconds[sample];
+            minimum = value < minimum ? value : minimum;
+            maximum = value > maximum ? value : maximum;
+            sum += value;
+        }
+        statistics[i] = (WGPUTimestampStatistics){
+            .label = {source->label, strlen(source->label)},
+            .minMilliseconds = minimum,
+            .averageMilliseconds = sum / source->sampleCount,
+            .maxMilliseconds = maximum,
+            .sampleCount = source->sampleCount,
+        };
+    }
+    EXIT();
+    return labelCount;
+}
+
 void wgpuDeviceTick(WGPUDevice device){
     ENTRY();
     WGPUQueue queue = device->queue;
@@ -6667,7 +9578,6 @@ void wgpuDeviceTick(WGPUDevice device){
         .label = STRVIEW("PresubmitCache"),
     };
     WGPUCommandBuffer buffer = wgpuCommandEncoderFinish(queue->presubmitCache, &cbd);
-    wgpuCommandEncoderRelease(queue->presubmitCache);
     wgpuCommandBufferRelease(buffer);
     
     {
@@ -6676,18 +9586,17 @@ void wgpuDeviceTick(WGPUDevice device){
         PendingCommandBufferMap* pcmtbf = &frameCachetbf->pendingCommandBuffers;
         SyncState* syncStatetbf = &frameCachetbf->syncState;
 
-        const VkPipelineStageFlags waitmask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-        const uint32_t tsubmits = syncStatetbf->submits;
         WGPUCommandBufferVector* pendingForFTF = PendingCommandBufferMap_get(pcmtbf, frameCachetbf->finalTransitionFence);
         
         if(pendingForFTF == NULL){
-            VkSubmitInfo emptySubmit = {
-                .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-                .waitSemaphoreCount = 1,
-                .pWaitSemaphores = VkSemaphoreVector_get(&syncStatetbf->semaphores, tsubmits),
-                .pWaitDstStageMask = &waitmask
-            };
-            device->functions.vkQueueSubmit(device->queue->graphicsQueue, 1, &emptySubmit, frameCachetbf->finalTransitionFence->fence);
+            // Nothing was presented this frame: an empty batch still signals the final transition fence.
+            // An acquire that was never consumed is waited on here so its semaphore can be reused.
+            VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+            if(syncStatetbf->acquireImageSemaphoreSignalled){
+                waitSemaphore = syncStatetbf->acquireImageSemaphore;
+                syncStatetbf->acquireImageSemaphoreSignalled = false;
+            }
+            Queue_submitBatch(device->queue, NULL, 0, waitSemaphore, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, VK_NULL_HANDLE, VK_PIPELINE_STAGE_2_NONE, frameCachetbf->finalTransitionFence->fence);
             wgpuFenceAddRef(frameCachetbf->finalTransitionFence);
             frameCachetbf->finalTransitionFence->state = WGPUFenceState_InUse;
             WGPUCommandBufferVector insert;
@@ -6751,26 +9660,16 @@ void wgpuDeviceTick(WGPUDevice device){
     WGPUBufferVector_clear(usedBuffers);//(WGPUBufferVector *dest, const WGPUBufferVector *source)
     
 
-    VkCommandPool poolToClear = frameCacheMew->commandPool;
-
-    // This line is currently commented out because they cause an 
-    // issue with CommandEncoders living across wgpuDeviceTick (and wgpuSurfacePresent) calls
-    //
-    // device->functions.vkResetCommandPool(device->device, poolToClear, 0);
-
-    for(size_t i = 0;i < pcmNew->current_capacity;i++){
-        PendingCommandBufferMap_kv_pair* entry_pair = pcmNew->table + i;
-        if(entry_pair->key){
-            const WGPUCommandBufferVector* vector = &entry_pair->value;
-            for(size_t j = 0;j < vector->size;j++){
-                //device->functions.vkFreeCommandBuffers(device->device, poolToClear, 1, &vector->data[j]->buffer);
-            }
-        }
-    }
     PendingCommandBufferMap_clear(pcmNew);
+    PerframeCache_collectTimestamps(device, frameCacheMew);
+    PerframeCache_destroyRetiredSwapchains(device, frameCacheMew);
+    PerframeCache_releaseRetiredSlotContents(frameCacheMew);
+
+    // Every submit of this frame has retired. Pools still referenced by 
+    // CommandEncoders living across wgpuDeviceTick are skipped.
+    PerframeCache_resetCommandPools(device, frameCacheMew);
 
-    WGPUCommandEncoderDescriptor cedesc zeroinit;
-    device->queue->presubmitCache = wgpuDeviceCreateCommandEncoder(device, &cedesc);
+    CommandEncoder_rearm(device->queue->presubmitCache);
     syncStateNew->submits = 0;
     EXIT();
 }
@@ -6815,6 +9714,7 @@ void wgpuRenderPassEncoderSetVertexBuffer(WGPURenderPassEncoder rpe, uint32_t bi
 
     RenderPassEncoder_PushCommand(rpe, &insert);
     
+    CommandEncoder_initializeBufferRead(rpe->cmdEncoder, buffer, offset, size);
     ce_trackBuffer(rpe->cmdEncoder, buffer, (BufferUsageSnap){
         .access =  VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 
         .stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
@@ -6832,9 +9732,66 @@ void wgpuRenderPassEncoderExecuteBundles(WGPURenderPassEncoder renderPassEncoder
                 .renderBundle = bundles[i],
             }
         };
-        RenderPassCommandGenericVector_push_back(&renderPassEncoder->bufferedCommands, insert);
+        Device_pushCommand(renderPassEncoder->device, &renderPassEncoder->bufferedCommands, &insert);
         ru_trackRenderBundle(&renderPassEncoder->resourceUsage, bundles[i]);
     }
+    renderPassEncoder->executesBundles |= (bundleCount > 0);
+    EXIT();
+}
+
+static WGPUBool validateImmediateData(WGPUDevice device, uint32_t offset, const void* data, size_t size){
+    if((offset & 3) || (size & 3) || size > WGVK_MAX_IMMEDIATE_DATA_SIZE || offset > WGVK_MAX_IMMEDIATE_DATA_SIZE - size || (size && data == NULL)){
+        DeviceCallback(device, WGPUErrorType_Validation, STRVIEW("SetImmediateData: offset and size must be multiples of 4 within WGVK_MAX_IMMEDIATE_DATA_SIZE"));
+        return 0;
+    }
+    return size > 0;
+}
+
+void wgpuRenderPassEncoderSetImmediateData(WGPURenderPassEncoder renderPassEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE{
+    ENTRY();
+    if(validateImmediateData(renderPassEncoder->device, offset, data, size)){
+        const RenderPassCommandGeneric insert = {
+            .type = rp_command_type_set_immediate_data,
+            .setImmediateData = {offset, (uint32_t)size, data}
+        };
+        RenderPassEncoder_PushCommand(renderPassEncoder, &insert);
+    }
+    EXIT();
+}
+
+void wgpuComputePassEncoderSetImmediateData(WGPUComputePassEncoder computePassEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE{
+    ENTRY();
+    if(validateImmediateData(computePassEncoder->device, offset, data, size)){
+        const RenderPassCommandGeneric insert = {
+            .type = rp_command_type_set_immediate_data,
+            .setImmediateData = {offset, (uint32_t)size, data}
+        };
+        ComputePassEncoder_PushCommand(computePassEncoder, &insert);
+    }
+    EXIT();
+}
+
+void wgpuRaytracingPassEncoderSetImmediateData(WGPURaytracingPassEncoder raytracingPassEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE{
+    ENTRY();
+    if(validateImmediateData(raytracingPassEncoder->device, offset, data, size)){
+        const RenderPassCommandGeneric insert = {
+            .type = rp_command_type_set_immediate_data,
+            .setImmediateData = {offset, (uint32_t)size, data}
+        };
+        RaytracingPassEncoder_PushCommand(raytracingPassEncoder, &insert);
+    }
+    EXIT();
+}
+
+void wgpuRenderBundleEncoderSetImmediateData(WGPURenderBundleEncoder renderBundleEncoder, uint32_t offset, void const * data, size_t size) WGPU_FUNCTION_ATTRIBUTE{
+    ENTRY();
+    if(validateImmediateData(renderBundleEncoder->device, offset, data, size)){
+        const RenderPassCommandGeneric insert = {
+            .type = rp_command_type_set_immediate_data,
+            .setImmediateData = {offset, (uint32_t)size, data}
+        };
+        Device_pushCommand(renderBundleEncoder->device, &renderBundleEncoder->bufferedCommands, &insert);
+    }
     EXIT();
 }
 
@@ -6849,6 +9806,7 @@ void wgpuRenderPassEncoderDrawIndexedIndirect(WGPURenderPassEncoder renderPassEn
         }
     };
     RenderPassEncoder_PushCommand(renderPassEncoder, &insert);
+    RenderPassEncoder_trackIndirectBuffer(renderPassEncoder, indirectBuffer);
     EXIT();
 }
 void wgpuRenderPassEncoderDrawIndirect           (WGPURenderPassEncoder renderPassEncoder, WGPUBuffer indirectBuffer, uint64_t indirectOffset) WGPU_FUNCTION_ATTRIBUTE{
@@ -6861,6 +9819,7 @@ void wgpuRenderPassEncoderDrawIndirect           (WGPURenderPassEncoder renderPa
         }
     };
     RenderPassEncoder_PushCommand(renderPassEncoder, &insert);
+    RenderPassEncoder_trackIndirectBuffer(renderPassEncoder, indirectBuffer);
     EXIT();
 }
 void wgpuRenderPassEncoderSetBlendConstant       (WGPURenderPassEncoder renderPassEncoder, const WGPUColor* color) WGPU_FUNCTION_ATTRIBUTE{
@@ -6919,6 +9878,7 @@ void wgpuRenderPassEncoderSetIndexBuffer(WGPURenderPassEncoder rpe, WGPUBuffer b
 
     RenderPassEncoder_PushCommand(rpe, &insert);
     
+    CommandEncoder_initializeBufferRead(rpe->cmdEncoder, buffer, offset, size);
     ce_trackBuffer(rpe->cmdEncoder, buffer, (BufferUsageSnap){
         .stage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 
         .access = VK_ACCESS_INDEX_READ_BIT
@@ -7042,6 +10002,26 @@ RGAPI void ru_trackAccelerationStructure(ResourceUsage* resourceUsage, WGPURayTr
         ++accelerationStructure->refCount;
     }
 }
+// The containers' lookups take non-const pointers but don't modify anything
+RGAPI WGPUBool32 ru_containsBuffer(const ResourceUsage* resourceUsage, WGPUBuffer buffer){
+    return BufferUsageRecordMap_get((BufferUsageRecordMap*)&resourceUsage->referencedBuffers, buffer) != NULL;
+}
+RGAPI WGPUBool32 ru_containsTexture(const ResourceUsage* resourceUsage, WGPUTexture texture){
+    return ImageUsageRecordMap_get((ImageUsageRecordMap*)&resourceUsage->referencedTextures, texture) != NULL;
+}
+RGAPI WGPUBool32 ru_containsTextureView(const ResourceUsage* resourceUsage, WGPUTextureView view){
+    return ImageViewUsageSet_contains((ImageViewUsageSet*)&resourceUsage->referencedTextureViews, view);
+}
+RGAPI WGPUBool32 ru_containsBindGroup(const ResourceUsage* resourceUsage, WGPUBindGroup bindGroup){
+    return BindGroupUsageSet_contains((BindGroupUsageSet*)&resourceUsage->referencedBindGroups, bindGroup);
+}
+RGAPI WGPUBool32 ru_containsBindGroupLayout(const ResourceUsage* resourceUsage, WGPUBindGroupLayout bindGroupLayout){
+    return BindGroupLayoutUsageSet_contains((BindGroupLayoutUsageSet*)&resourceUsage->referencedBindGroupLayouts, bindGroupLayout);
+}
+RGAPI WGPUBool32 ru_containsSampler(const ResourceUsage* resourceUsage, WGPUSampler sampler){
+    return SamplerUsageSet_contains((SamplerUsageSet*)&resourceUsage->referencedSamplers, sampler);
+}
+
 typedef enum barrierType{
     bt_no_barrier = 0,
     bt_buffer_barrier = 1,
@@ -7076,11 +10056,12 @@ static OptionalBarrier ru_trackTextureAndEmit(ResourceUsage* resourceUsage, WGPU
             texture->image,
             usage.subresource
         };
+        const VkPipelineStageFlags srcStage = alreadyThere->lastStage;
         alreadyThere->lastStage  = usage.stage;
         alreadyThere->lastAccess = usage.access;
         alreadyThere->lastLayout = usage.layout;
         const OptionalBarrier ret = {
-            .srcStage = alreadyThere->lastStage,
+            .srcStage = srcStage,
             .dstStage = usage.stage,
             .type = bt_image_barrier,
             .imageBarrier = barr
@@ -7126,11 +10107,12 @@ static OptionalBarrier ru_trackTextureViewAndEmit(ResourceUsage* resourceUsage,
             view->texture->image,
             view->subresourceRange
         };
+        const VkPipelineStageFlags srcStage = alreadyThere->lastStage;
         alreadyThere->lastStage  = usage.stage;
         alreadyThere->lastAccess = usage.access;
         alreadyThere->lastLayout = usage.layout;
         const OptionalBarrier ret = {
-            .srcStage = alreadyThere->lastStage,
+            .srcStage = srcStage,
             .dstStage = usage.stage,
             .type = bt_image_barrier,
             .imageBarrier = barr
@@ -7279,6 +10261,82 @@ RGAPI void ce_trackBuffer(WGPUCommandEncoder encoder, WGPUBuffer buffer, BufferU
     ru_trackAndEncodeBuffer(encoder, &encoder->resourceUsage, buffer, usage);
 }
 
+RGAPI void ce_flushBarriers(WGPUCommandEncoder encoder, BarrierBatch* batch){
+    if(batch->memoryBarrierCount + batch->bufferBarrierCount + batch->imageBarrierCount == 0){
+        return;
+    }
+    encoder->device->functions.vkCmdPipelineBarrier(
+        encoder->buffer,
+        batch->srcStage ? batch->srcStage : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        batch->dstStage,
+        0,
+        batch->memoryBarrierCount, &batch->memoryBarrier,
+        batch->bufferBarrierCount, batch->bufferBarriers,
+        batch->imageBarrierCount,  batch->imageBarriers
+    );
+    *batch = (BarrierBatch){0};
+}
+
+static inline WGPUBool rangesOverlap(uint32_t baseA, uint32_t countA, uint32_t baseB, uint32_t countB){
+    // VK_REMAINING_* is ~0u, which is large enough to extend to the end
+    return baseA < (countB > UINT32_MAX - baseB ? UINT32_MAX : baseB + countB) && baseB < (countA > UINT32_MAX - baseA ? UINT32_MAX : baseA + countA);
+}
+
+static inline WGPUBool subresourceRangesOverlap(const VkImageSubresourceRange* a, const VkImageSubresourceRange* b){
+    return (a->aspectMask & b->aspectMask) != 0 && 
+        rangesOverlap(a->baseMipLevel, a->levelCount, b->baseMipLevel, b->levelCount) && 
+        rangesOverlap(a->baseArrayLayer, a->layerCount, b->baseArrayLayer, b->layerCount);
+}
+
+/**
+ * @brief Whether barrier transitions a subresource that an image barrier of batch transitions already
+ * @details Both layout transitions would execute at once in a single vkCmdPipelineBarrier, the batch has to be flushed in between.
+ */
+static WGPUBool barrierBatchOverlaps(const BarrierBatch* batch, const OptionalBarrier* barrier){
+    if(barrier->type != bt_image_barrier)return 0;
+    for(uint32_t i = 0;i < batch->imageBarrierCount;i++){
+        const VkImageMemoryBarrier* batched = batch->imageBarriers + i;
+        if(batched->image == barrier->imageBarrier.image && subresourceRangesOverlap(&batched->subresourceRange, &barrier->imageBarrier.subresourceRange)){
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void barrierBatchAdd(WGPUCommandEncoder encoder, BarrierBatch* batch, OptionalBarrier barrier){
+    if(barrier.type == bt_no_barrier){
+        return;
+    }
+    if(batch->bufferBarrierCount == BARRIER_BATCH_CAPACITY || batch->imageBarrierCount == BARRIER_BATCH_CAPACITY || barrierBatchOverlaps(batch, &barrier)){
+        ce_flushBarriers(encoder, batch);
+    }
+    batch->srcStage |= barrier.srcStage;
+    batch->dstStage |= barrier.dstStage;
+    switch(barrier.type){
+        case bt_buffer_barrier:
+            batch->bufferBarriers[batch->bufferBarrierCount++] = barrier.bufferBarrier;
+        break;
+        case bt_image_barrier:
+            batch->imageBarriers[batch->imageBarrierCount++] = barrier.imageBarrier;
+        break;
+        case bt_memory_barrier:
+            batch->memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            batch->memoryBarrier.srcAccessMask |= barrier.memoryBarrier.srcAccessMask;
+            batch->memoryBarrier.dstAccessMask |= barrier.memoryBarrier.dstAccessMask;
+            batch->memoryBarrierCount = 1;
+        break;
+        default: break;
+    }
+}
+
+RGAPI void ce_trackBufferBatched(WGPUCommandEncoder encoder, BarrierBatch* batch, WGPUBuffer buffer, BufferUsageSnap usage){
+    barrierBatchAdd(encoder, batch, ru_trackBufferAndEmit(&encoder->resourceUsage, buffer, usage));
+}
+
+RGAPI void ce_trackTextureViewBatched(WGPUCommandEncoder encoder, BarrierBatch* batch, WGPUTextureView view, ImageUsageSnap usage){
+    barrierBatchAdd(encoder, batch, ru_trackTextureViewAndEmit(&encoder->resourceUsage, view, usage));
+}
+
 
 static inline void bufferReleaseCallback(void* buffer, BufferUsageRecord* bu_record, void* unused){
     wgpuBufferRelease(buffer);
@@ -7985,11 +11043,6 @@ void wgpuCommandBufferAddRef(WGPUCommandBuffer commandBuffer) {
 }
 
 // Stubs for missing Methods of CommandEncoder
-void wgpuCommandEncoderClearBuffer(WGPUCommandEncoder commandEncoder, WGPUBuffer buffer, uint64_t offset, uint64_t size) {
-    ENTRY();
-
-    EXIT();
-}
 void wgpuCommandEncoderInsertDebugMarker(WGPUCommandEncoder commandEncoder, WGPUStringView markerLabel) {
     ENTRY();
 
@@ -7997,22 +11050,57 @@ void wgpuCommandEncoderInsertDebugMarker(WGPUCommandEncoder commandEncoder, WGPU
 }
 void wgpuCommandEncoderPopDebugGroup(WGPUCommandEncoder commandEncoder) {
     ENTRY();
-
+    if(commandEncoder->debugGroupDepth == 0){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderPopDebugGroup: no debug group to pop"));
+        EXIT();
+        return;
+    }
+    const uint32_t depth = --commandEncoder->debugGroupDepth;
+    if(depth < WGVK_MAX_DEBUG_GROUP_DEPTH){
+        Device_recordTimestampScope(commandEncoder->device, commandEncoder->buffer, &commandEncoder->timestamps, commandEncoder->debugGroupScopes[depth], 1);
+    }
     EXIT();
 }
 void wgpuCommandEncoderPushDebugGroup(WGPUCommandEncoder commandEncoder, WGPUStringView groupLabel) {
     ENTRY();
-
+    // Groups nested deeper than WGVK_MAX_DEBUG_GROUP_DEPTH are counted but not timed
+    const uint32_t depth = commandEncoder->debugGroupDepth++;
+    if(depth < WGVK_MAX_DEBUG_GROUP_DEPTH){
+        const uint32_t scope = Device_beginTimestampScope(commandEncoder, groupLabel, "DebugGroup");
+        commandEncoder->debugGroupScopes[depth] = scope;
+        Device_recordTimestampScope(commandEncoder->device, commandEncoder->buffer, &commandEncoder->timestamps, scope, 0);
+    }
     EXIT();
 }
+/**
+ * @brief Copies query results into destination on the GPU timeline
+ * @details No VK_QUERY_RESULT_WAIT_BIT: an execution dependency on everything recorded before makes the queries 
+ * available by the time the copy runs, so the copy never polls query status. Nothing on the host waits either,
+ * results are read back with wgpuBufferMapAsync.
+ */
 void wgpuCommandEncoderResolveQuerySet(WGPUCommandEncoder commandEncoder, WGPUQuerySet querySet, uint32_t firstQuery, uint32_t queryCount, WGPUBuffer destination, uint64_t destinationOffset) {
     ENTRY();
+    if(firstQuery > querySet->count || queryCount > querySet->count - firstQuery || (destinationOffset & 255) != 0){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderResolveQuerySet: query range out of bounds or destinationOffset not a multiple of 256"));
+        EXIT();
+        return;
+    }
+    const uint64_t resolveSize = (uint64_t)queryCount * sizeof(uint64_t);
+    if(destinationOffset > destination->capacity || resolveSize > destination->capacity - destinationOffset){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderResolveQuerySet: resolved queries don't fit into destination"));
+        EXIT();
+        return;
+    }
     const BufferUsageSnap usage = {
         .access = VK_ACCESS_TRANSFER_WRITE_BIT,
         .stage = VK_PIPELINE_STAGE_TRANSFER_BIT
     };
     ce_trackBuffer(commandEncoder, destination, usage);
     ru_trackQuerySet(&commandEncoder->resourceUsage, querySet);
+    const VkPipelineStageFlags queryStages = querySet->type == WGPUQueryType_Occlusion 
+        ? (VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT) 
+        : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    commandEncoder->device->functions.vkCmdPipelineBarrier(commandEncoder->buffer, queryStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 0, NULL);
     commandEncoder->device->functions.vkCmdCopyQueryPoolResults(
         commandEncoder->buffer,
         querySet->queryPool,
@@ -8020,8 +11108,8 @@ void wgpuCommandEncoderResolveQuerySet(WGPUCommandEncoder commandEncoder, WGPUQu
         queryCount, 
         destination->buffer,
         destinationOffset,
-        8,
-        VK_QUERY_RESULT_WAIT_BIT | VK_QUERY_RESULT_64_BIT
+        sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT
     );
     EXIT();
 }
@@ -8032,7 +11120,12 @@ void wgpuCommandEncoderSetLabel(WGPUCommandEncoder commandEncoder, WGPUStringVie
 }
 void wgpuCommandEncoderWriteTimestamp(WGPUCommandEncoder commandEncoder, WGPUQuerySet querySet, uint32_t queryIndex) {
     ENTRY();
-    ru_trackQuerySet(&commandEncoder->resourceUsage, querySet);
+    if(queryIndex >= querySet->count){
+        DeviceCallback(commandEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuCommandEncoderWriteTimestamp: queryIndex is out of range"));
+        EXIT();
+        return;
+    }
+    CommandEncoder_markQueryWritten(commandEncoder, querySet, queryIndex);
     commandEncoder->device->functions.vkCmdWriteTimestamp(commandEncoder->buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, querySet->queryPool, queryIndex);
     EXIT();
 }
@@ -8053,6 +11146,7 @@ void wgpuComputePassEncoderDispatchWorkgroupsIndirect(WGPUComputePassEncoder com
         }
     };
     ComputePassEncoder_PushCommand(computePassEncoder, &insert);
+    CommandEncoder_initializeBufferRead(computePassEncoder->cmdEncoder, indirectBuffer, indirectOffset, 3 * sizeof(uint32_t));
     EXIT();
 }
 void wgpuComputePassEncoderInsertDebugMarker(WGPUComputePassEncoder computePassEncoder, WGPUStringView markerLabel) {
@@ -8140,8 +11234,10 @@ WGPUFuture wgpuDeviceCreateComputePipelineAsync(WGPUDevice device, WGPUComputePi
 WGPUQuerySet wgpuDeviceCreateQuerySet(WGPUDevice device, const WGPUQuerySetDescriptor* descriptor) {
     ENTRY();
     WGPUQuerySet ret = RL_CALLOC(1, sizeof(WGPUQuerySetImpl));
+    ret->refCount = 1;
     ret->device = device;
     ret->type = descriptor->type;
+    ret->count = descriptor->count;
 
     VkQueryPoolCreateInfo qpci = {
         .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
@@ -8501,7 +11597,7 @@ void wgpuQuerySetDestroy(WGPUQuerySet querySet) {
 uint32_t wgpuQuerySetGetCount(WGPUQuerySet querySet) {
     ENTRY();
     EXIT();
-    return 0;
+    return querySet->count;
 }
 WGPUQueryType wgpuQuerySetGetType(WGPUQuerySet querySet) {
     ENTRY();
@@ -8515,12 +11611,15 @@ void wgpuQuerySetSetLabel(WGPUQuerySet querySet, WGPUStringView label) {
 }
 void wgpuQuerySetAddRef(WGPUQuerySet querySet) {
     ENTRY();
-
+    ++querySet->refCount;
     EXIT();
 }
 void wgpuQuerySetRelease(WGPUQuerySet querySet) {
     ENTRY();
-
+    if(--querySet->refCount == 0){
+        querySet->device->functions.vkDestroyQueryPool(querySet->device->device, querySet->queryPool, NULL);
+        RL_FREE(querySet);
+    }
     EXIT();
 }
 
@@ -8625,12 +11724,27 @@ void wgpuRenderBundleSetLabel(WGPURenderBundle renderBundle, WGPUStringView labe
 }
 void wgpuRenderBundleAddRef(WGPURenderBundle renderBundle) {
     ENTRY();
-
+    ++renderBundle->refCount;
     EXIT();
 }
+static void renderBundleFreeSecondary(DefaultDynamicState key, VkCommandBuffer* buffer, void* device_){
+    (void)key;
+    WGPUDevice device = (WGPUDevice)device_;
+    device->functions.vkFreeCommandBuffers(device->device, device->secondaryCommandPool, 1, buffer);
+}
 void wgpuRenderBundleRelease(WGPURenderBundle renderBundle) {
     ENTRY();
-
+    if(--renderBundle->refCount == 0){
+        // Passes executing the bundle hold a reference until their submission has finished, so none of the secondaries are pending
+        WGPUDevice device = renderBundle->device;
+        wgvk_mutex_lock(device->secondaryCommandPoolMutex);
+        DynamicStateCommandBufferMap_for_each(&renderBundle->encodedCommandBuffers, renderBundleFreeSecondary, device);
+        wgvk_mutex_unlock(device->secondaryCommandPoolMutex);
+        DynamicStateCommandBufferMap_free(&renderBundle->encodedCommandBuffers);
+        RenderPassCommandStream_free(&renderBundle->bufferedCommands);
+        RL_FREE(renderBundle->colorAttachmentFormats);
+        RL_FREE(renderBundle);
+    }
     EXIT();
 }
 
@@ -8659,13 +11773,20 @@ void wgpuRenderBundleEncoderSetLabel(WGPURenderBundleEncoder renderBundleEncoder
 // Stubs for missing Methods of RenderPassEncoder
 void wgpuRenderPassEncoderBeginOcclusionQuery(WGPURenderPassEncoder renderPassEncoder, uint32_t queryIndex) {
     ENTRY();
+    WGPUQuerySet querySet = renderPassEncoder->beginInfo.occlusionQuerySet;
+    if(querySet == NULL || queryIndex >= querySet->count){
+        DeviceCallback(renderPassEncoder->device, WGPUErrorType_Validation, STRVIEW("wgpuRenderPassEncoderBeginOcclusionQuery: pass has no occlusionQuerySet or queryIndex is out of range"));
+        EXIT();
+        return;
+    }
+    CommandEncoder_markQueryWritten(renderPassEncoder->cmdEncoder, querySet, queryIndex);
     RenderPassCommandGeneric insert = {
         .type = rp_command_type_begin_occlusion_query,
         .beginOcclusionQuery = {
             .queryIndex = queryIndex
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderPassEncoder->bufferedCommands, insert);
+    Device_pushCommand(renderPassEncoder->device, &renderPassEncoder->bufferedCommands, &insert);
     EXIT();
 }
 void wgpuRenderPassEncoderEndOcclusionQuery(WGPURenderPassEncoder renderPassEncoder) {
@@ -8673,7 +11794,7 @@ void wgpuRenderPassEncoderEndOcclusionQuery(WGPURenderPassEncoder renderPassEnco
     RenderPassCommandGeneric insert = {
         .type = rp_command_type_end_occlusion_query
     };
-    RenderPassCommandGenericVector_push_back(&renderPassEncoder->bufferedCommands, insert);
+    Device_pushCommand(renderPassEncoder->device, &renderPassEncoder->bufferedCommands, &insert);
     EXIT();
 }
 
@@ -8692,10 +11813,28 @@ void wgpuRenderPassEncoderInsertDebugMarker(WGPURenderPassEncoder renderPassEnco
     };
     memcpy(insert.insertDebugMarker.text, markerLabel.data, length);
     insert.insertDebugMarker.length = length;
-    RenderPassCommandGenericVector_push_back(&renderPassEncoder->bufferedCommands, insert);
+    Device_pushCommand(renderPassEncoder->device, &renderPassEncoder->bufferedCommands, &insert);
     EXIT();
 }
 
+/**
+ * @brief Rejects multi draws the device can't issue as asked
+ * @details Without drawIndirectCount the count buffer could only be ignored, drawing maxDrawCount times. Multi draw
+ * calls are bounded by maxDrawIndirectCount, devices without multiDrawIndirect issue single draws in a loop instead.
+ */
+static WGPUBool RenderPassEncoder_validateMultiDraw(WGPURenderPassEncoder renderPassEncoder, uint32_t maxDrawCount, WGPUBuffer drawCountBuffer, WGPUStringView countBufferMessage, WGPUStringView limitMessage){
+    const WGVKCapabilities* capabilities = &renderPassEncoder->device->capabilities;
+    if(drawCountBuffer && !capabilities->drawIndirectCount){
+        DeviceCallback(renderPassEncoder->device, WGPUErrorType_Validation, countBufferMessage);
+        return 0;
+    }
+    if((drawCountBuffer || capabilities->multiDrawIndirect) && maxDrawCount > capabilities->maxDrawIndirectCount){
+        DeviceCallback(renderPassEncoder->device, WGPUErrorType_Validation, limitMessage);
+        return 0;
+    }
+    return 1;
+}
+
 void wgpuRenderPassEncoderMultiDrawIndexedIndirect(WGPURenderPassEncoder renderPassEncoder, WGPUBuffer indirectBuffer, uint64_t indirectOffset, uint32_t maxDrawCount, WGPU_NULLABLE WGPUBuffer drawCountBuffer, uint64_t drawCountBufferOffset) {
     ENTRY();
     RenderPassCommandGeneric insert = {
@@ -8708,13 +11847,25 @@ void wgpuRenderPassEncoderMultiDrawIndexedIndirect(WGPURenderPassEncoder renderP
             .drawCountBufferOffset = drawCountBufferOffset
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderPassEncoder->bufferedCommands, insert);
+    const WGPUBool valid = RenderPassEncoder_validateMultiDraw(
+        renderPassEncoder, maxDrawCount, drawCountBuffer,
+        STRVIEW("wgpuRenderPassEncoderMultiDrawIndexedIndirect: drawCountBuffer requires drawIndirectCount support"),
+        STRVIEW("wgpuRenderPassEncoderMultiDrawIndexedIndirect: maxDrawCount exceeds the maxDrawIndirectCount limit")
+    );
+    if(!valid){
+        EXIT();
+        return;
+    }
+    Device_pushCommand(renderPassEncoder->device, &renderPassEncoder->bufferedCommands, &insert);
+    RenderPassEncoder_trackIndirectBuffer(renderPassEncoder, indirectBuffer);
+    if(drawCountBuffer){
+        RenderPassEncoder_trackIndirectBuffer(renderPassEncoder, drawCountBuffer);
+    }
     EXIT();
 }
 
 void wgpuRenderPassEncoderMultiDrawIndirect(WGPURenderPassEncoder renderPassEncoder, WGPUBuffer indirectBuffer, uint64_t indirectOffset, uint32_t maxDrawCount, WGPU_NULLABLE WGPUBuffer drawCountBuffer, uint64_t drawCountBufferOffset) {
     ENTRY();
-    // Assumes RenderPassCommandMultiDrawIndirect has fields for all parameters.
     RenderPassCommandGeneric insert = {
         .type = rp_command_type_multi_draw_indirect,
         .multiDrawIndirect = {
@@ -8725,7 +11876,20 @@ void wgpuRenderPassEncoderMultiDrawIndirect(WGPURenderPassEncoder renderPassEnco
             .drawCountBufferOffset = drawCountBufferOffset
         }
     };
-    RenderPassCommandGenericVector_push_back(&renderPassEncoder->bufferedCommands, insert);
+    const WGPUBool valid = RenderPassEncoder_validateMultiDraw(
+        renderPassEncoder, maxDrawCount, drawCountBuffer,
+        STRVIEW("wgpuRenderPassEncoderMultiDrawIndirect: drawCountBuffer requires drawIndirectCount support"),
+        STRVIEW("wgpuRenderPassEncoderMultiDrawIndirect: maxDrawCount exceeds the maxDrawIndirectCount limit")
+    );
+    if(!valid){
+        EXIT();
+        return;
+    }
+    Device_pushCommand(renderPassEncoder->device, &renderPassEncoder->bufferedCommands, &insert);
+    RenderPassEncoder_trackIndirectBuffer(renderPassEncoder, indirectBuffer);
+    if(drawCountBuffer){
+        RenderPassEncoder_trackIndirectBuffer(renderPassEncoder, drawCountBuffer);
+    }
     EXIT();
 }
 
@@ -8812,49 +11976,12 @@ void wgpuSurfaceSetLabel(WGPUSurface surface, WGPUStringView label) {
 }
 void wgpuSurfaceUnconfigure(WGPUSurface surface) {
     ENTRY();
-    WGPUDevice device = surface->device;
-    uint32_t cacheIndex = surface->device->submittedFrames % framesInFlight;
-    PerframeCache* fcache = DeviceGetFIFCache(device, cacheIndex);
-    SyncState* syncState = DeviceGetSyncState(device, cacheIndex);
-
-    device->functions.vkDeviceWaitIdle(device->device);
-    if(syncState->acquireImageSemaphoreSignalled){
-        VkPipelineStageFlags wm = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT_KHR;
-        VkSubmitInfo sinfo = {
-            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-            .pNext = NULL,
-            .pWaitDstStageMask = &wm,
-            .pWaitSemaphores = &syncState->acquireImageSemaphore,
-            .waitSemaphoreCount = 1
-        };
-        device->functions.vkQueueSubmit(surface->device->queue->graphicsQueue, 1, &sinfo, fcache->finalTransitionFence->fence);
-        syncState->acquireImageSemaphoreSignalled = false;
-        device->functions.vkWaitForFences(surface->device->device, 1, &fcache->finalTransitionFence->fence, VK_TRUE, UINT64_MAX);
-        device->functions.vkResetFences(surface->device->device, 1, &fcache->finalTransitionFence->fence);
-    }
-    if(surface->presentSemaphores){
-        for (uint32_t i = 0; i < surface->imagecount; i++) {
-            device->functions.vkDestroySemaphore(surface->device->device, surface->presentSemaphores[i], NULL);
-        }
-        RL_FREE((void*)surface->presentSemaphores);
-        surface->presentSemaphores = NULL;
-    }
-
-    if(surface->swapchain){
-        for(uint32_t i = 0;i < surface->imagecount;i++){
-            WGPUTexture swapchainTexture = surface->images[i];
-            for(size_t j = 0;j < swapchainTexture->viewCache.current_capacity;j++){
-                if(swapchainTexture->viewCache.table[j].key.format != VK_FORMAT_UNDEFINED){
-                    WGPUTextureView cacheEntry = swapchainTexture->viewCache.table[j].value;
-                    device->functions.vkDestroyImageView(cacheEntry->texture->device->device, cacheEntry->view, NULL);
-                }
-
-                //wgpuTextureViewRelease(swapchainTexture->viewCache.table[j].value);
-            }
-        }
-        RL_FREE((void*)surface->images);
-        device->functions.vkDestroySwapchainKHR(device->device, surface->swapchain, NULL);
-        surface->swapchain = NULL;
+    if(surface->images){
+        WGPUDevice device = surface->device;
+        RetiredSwapchain retired = Surface_detachSwapchain(surface);
+        // Explicit teardown, the surface may be destroyed right after this returns
+        device->functions.vkDeviceWaitIdle(device->device);
+        RetiredSwapchain_destroy(device, &retired);
     }
     EXIT();
 }
@@ -9268,6 +12395,78 @@ RGAPI void wgvkAllocator_free(const wgvkAllocation* allocation) {
 #endif
 
 
+_Static_assert(WGVK_MAX_RECORDING_THREADS <= 64, "Thread slots are held in a 64 bit mask");
+
+// Bit i is set while a live thread holds slot i
+static Atomar(uint64_t) wgvk_threadSlotsHeld = 0;
+#if defined(_MSC_VER) && !defined(__clang__)
+static __declspec(thread) uint32_t wgvk_threadSlot = UINT32_MAX;
+static __declspec(thread) bool wgvk_threadSlotOverflowReported = false;
+#else
+static _Thread_local uint32_t wgvk_threadSlot = UINT32_MAX;
+static _Thread_local bool wgvk_threadSlotOverflowReported = false;
+#endif
+
+static void wgvk_releaseThreadSlot(uint32_t slot){
+    atomic_fetch_and_explicit(&wgvk_threadSlotsHeld, ~((uint64_t)1 << slot), memory_order_release);
+}
+
+#if defined(WGVK_OS_WINDOWS)
+static DWORD wgvk_threadSlotFls = FLS_OUT_OF_INDEXES;
+static INIT_ONCE wgvk_threadSlotOnce = INIT_ONCE_STATIC_INIT;
+static void WINAPI wgvk_threadSlotExit(void* value){
+    if(value)wgvk_releaseThreadSlot((uint32_t)((uintptr_t)value - 1));
+}
+static BOOL CALLBACK wgvk_threadSlotInit(PINIT_ONCE once, void* param, void** context){
+    (void)once; (void)param; (void)context;
+    wgvk_threadSlotFls = FlsAlloc(wgvk_threadSlotExit);
+    return TRUE;
+}
+// Makes the slot return to the free ones when the calling thread exits
+static void wgvk_registerThreadSlot(uint32_t slot){
+    InitOnceExecuteOnce(&wgvk_threadSlotOnce, wgvk_threadSlotInit, NULL, NULL);
+    FlsSetValue(wgvk_threadSlotFls, (void*)((uintptr_t)slot + 1));
+}
+#else
+static pthread_key_t wgvk_threadSlotKey;
+static pthread_once_t wgvk_threadSlotOnce = PTHREAD_ONCE_INIT;
+static void wgvk_threadSlotExit(void* value){
+    wgvk_releaseThreadSlot((uint32_t)((uintptr_t)value - 1));
+}
+static void wgvk_threadSlotInit(void){
+    pthread_key_create(&wgvk_threadSlotKey, wgvk_threadSlotExit);
+}
+// Makes the slot return to the free ones when the calling thread exits
+static void wgvk_registerThreadSlot(uint32_t slot){
+    pthread_once(&wgvk_threadSlotOnce, wgvk_threadSlotInit);
+    pthread_setspecific(wgvk_threadSlotKey, (void*)((uintptr_t)slot + 1));
+}
+#endif
+
+uint32_t wgvk_thread_slot(void){
+    if(wgvk_threadSlot != UINT32_MAX){
+        return wgvk_threadSlot;
+    }
+    uint64_t held = atomic_load_explicit(&wgvk_threadSlotsHeld, memory_order_relaxed);
+    for(;;){
+        uint32_t slot = 0;
+        while(slot < WGVK_MAX_RECORDING_THREADS && (held & ((uint64_t)1 << slot)))++slot;
+        if(slot == WGVK_MAX_RECORDING_THREADS){
+            // Not remembered, the thread gets a slot of its own once another one exits
+            if(!wgvk_threadSlotOverflowReported){
+                TRACELOG(WGPU_LOG_WARNING, "More than WGVK_MAX_RECORDING_THREADS (%d) threads record commands, the excess ones share slower command pools", WGVK_MAX_RECORDING_THREADS);
+                wgvk_threadSlotOverflowReported = true;
+            }
+            return WGVK_OVERFLOW_THREAD_SLOT;
+        }
+        if(atomic_compare_exchange_weak_explicit(&wgvk_threadSlotsHeld, &held, held | ((uint64_t)1 << slot), memory_order_acquire, memory_order_relaxed)){
+            wgvk_registerThreadSlot(slot);
+            wgvk_threadSlot = slot;
+            return slot;
+        }
+    }
+}
+
 /**
  * @brief Portable "yield" function
  * 
@@ -9912,7 +13111,7 @@ void wgvk_job_destroy(wgvk_job_t* job) {
 
 
 
-RGAPI void releaseAllAndClear(ResourceUsage* resourceUsage){
+RGAPI void releaseAllReferences(ResourceUsage* resourceUsage){
     BufferUsageRecordMap_for_each(&resourceUsage->referencedBuffers, bufferReleaseCallback, NULL); 
     ImageUsageRecordMap_for_each(&resourceUsage->referencedTextures, textureReleaseCallback, NULL); 
     ImageViewUsageSet_for_each(&resourceUsage->referencedTextureViews, textureViewReleaseCallback, NULL); 
@@ -9923,17 +13122,11 @@ RGAPI void releaseAllAndClear(ResourceUsage* resourceUsage){
     RenderPipelineUsageSet_for_each(&resourceUsage->referencedRenderPipelines, renderPipelineReleaseCallback, NULL);
     RenderBundleUsageSet_for_each(&resourceUsage->referencedRenderBundles, renderBundleReleaseCallback, NULL);
     QuerySetUsageSet_for_each(&resourceUsage->referencedQuerySets, querySetReleaseCallback, NULL);
+}
 
-    BufferUsageRecordMap_free(&resourceUsage->referencedBuffers);
-    ImageUsageRecordMap_free(&resourceUsage->referencedTextures);
-    ImageViewUsageSet_free(&resourceUsage->referencedTextureViews);
-    BindGroupUsageSet_free(&resourceUsage->referencedBindGroups);
-    BindGroupLayoutUsageSet_free(&resourceUsage->referencedBindGroupLayouts);
-    SamplerUsageSet_free(&resourceUsage->referencedSamplers);
-    ComputePipelineUsageSet_free(&resourceUsage->referencedComputePipelines);
-    RenderPipelineUsageSet_free(&resourceUsage->referencedRenderPipelines);
-    RenderBundleUsageSet_free(&resourceUsage->referencedRenderBundles);
-    QuerySetUsageSet_free(&resourceUsage->referencedQuerySets);
+RGAPI void releaseAllAndClear(ResourceUsage* resourceUsage){
+    releaseAllReferences(resourceUsage);
+    ResourceUsage_free(resourceUsage);
 }
 
 